@@ -48,14 +48,18 @@
 #include "fiff_constants.h"
 #include "fiff_coord_trans.h"
 #include "fiff_dir_tree.h"
+#include "fiff_dir_cache.h"
 #include "fiff_dir_entry.h"
 #include "fiff_named_matrix.h"
 #include "fiff_tag.h"
+#include "fiff_tag_view.h"
+#include "fiff_rt_codec.h"
 #include "fiff_types.h"
 #include "fiff_proj.h"
 #include "fiff_ctf_comp.h"
 #include "fiff_info.h"
 #include "fiff_raw_data.h"
+#include "fiff_raw_writer.h"
 #include "fiff_raw_dir.h"
 #include "fiff_stream.h"
 #include "fiff_evoked_set.h"
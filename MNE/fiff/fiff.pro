@@ -73,12 +73,16 @@ win32 {
 SOURCES += fiff.cpp \
 #    fiff_parser.cpp \
     fiff_tag.cpp \
+    fiff_tag_view.cpp \
+    fiff_rt_codec.cpp \
     fiff_dir_tree.cpp \
+    fiff_dir_cache.cpp \
     fiff_coord_trans.cpp \
     fiff_ch_info.cpp \
     fiff_proj.cpp \
     fiff_named_matrix.cpp \
     fiff_raw_data.cpp \
+    fiff_raw_writer.cpp \
     fiff_ctf_comp.cpp \
     fiff_id.cpp \
     fiff_info.cpp \
@@ -99,7 +103,10 @@ HEADERS += fiff.h \
     fiff_id.h \
     fiff_constants.h \
     fiff_tag.h \
+    fiff_tag_view.h \
+    fiff_rt_codec.h \
     fiff_dir_tree.h \
+    fiff_dir_cache.h \
     fiff_coord_trans.h \
     fiff_ch_info.h \
     fiff_proj.h \
@@ -107,6 +114,7 @@ HEADERS += fiff.h \
     fiff_ctf_comp.h \
     fiff_info.h \
     fiff_raw_data.h \
+    fiff_raw_writer.h \
     fiff_dir_entry.h \
     fiff_raw_dir.h \
     fiff_dig_point.h \
@@ -0,0 +1,240 @@
+//=============================================================================================================
+/**
+* @file     fiff_dir_cache.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the FiffDirCache Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_dir_cache.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+/**
+* Cached directory of one file together with the state of the file it was built from
+*/
+struct FiffDirCacheEntry
+{
+    qint64 size;                /**< File size */
+    QDateTime modified;         /**< Last modification time */
+    FiffId fileId;              /**< File id of the first tag */
+    QList<FiffDirEntry> dir;    /**< Tag directory */
+    FiffDirTree tree;           /**< Directory tree */
+};
+
+QMutex s_qMutex;
+QHash<QString, FiffDirCacheEntry> s_qHashEntries;
+QList<QString> s_qListRecent;   /**< Cached paths, least recently used first */
+bool s_bEnabled = true;
+qint32 s_iCapacity = 32;
+qint64 s_iHits = 0;
+qint64 s_iMisses = 0;
+
+
+//*************************************************************************************************************
+
+bool sameId(const FiffId& p_idA, const FiffId& p_idB)
+{
+    return p_idA.version == p_idB.version
+            && p_idA.machid[0] == p_idB.machid[0] && p_idA.machid[1] == p_idB.machid[1]
+            && p_idA.time.secs == p_idB.time.secs && p_idA.time.usecs == p_idB.time.usecs;
+}
+
+
+//*************************************************************************************************************
+
+void evict()
+{
+    while(s_qListRecent.size() > s_iCapacity)
+        s_qHashEntries.remove(s_qListRecent.takeFirst());
+}
+
+} // NAMESPACE
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+bool FiffDirCache::lookup(const QFile& p_qFile, const FiffId& p_fileId, QList<FiffDirEntry>& p_Dir, FiffDirTree& p_Tree)
+{
+    QFileInfo t_fileInfo(p_qFile);
+    QString t_sPath = t_fileInfo.absoluteFilePath();
+
+    QMutexLocker locker(&s_qMutex);
+    if(!s_bEnabled)
+        return false;
+
+    QHash<QString, FiffDirCacheEntry>::ConstIterator it = s_qHashEntries.constFind(t_sPath);
+    if(it == s_qHashEntries.constEnd())
+    {
+        ++s_iMisses;
+        return false;
+    }
+
+    if(it->size != t_fileInfo.size() || it->modified != t_fileInfo.lastModified() || !sameId(it->fileId, p_fileId))
+    {
+        //
+        //   The file was rewritten since it was cached
+        //
+        s_qHashEntries.remove(t_sPath);
+        s_qListRecent.removeOne(t_sPath);
+        ++s_iMisses;
+        return false;
+    }
+
+    p_Dir = it->dir;
+    p_Tree = it->tree;
+
+    s_qListRecent.removeOne(t_sPath);
+    s_qListRecent.append(t_sPath);
+    ++s_iHits;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffDirCache::insert(const QFile& p_qFile, const FiffId& p_fileId, const QList<FiffDirEntry>& p_Dir, const FiffDirTree& p_Tree)
+{
+    QFileInfo t_fileInfo(p_qFile);
+    QString t_sPath = t_fileInfo.absoluteFilePath();
+
+    FiffDirCacheEntry t_entry;
+    t_entry.size = t_fileInfo.size();
+    t_entry.modified = t_fileInfo.lastModified();
+    t_entry.fileId = p_fileId;
+    t_entry.dir = p_Dir;
+    t_entry.tree = p_Tree;
+
+    QMutexLocker locker(&s_qMutex);
+    if(!s_bEnabled || s_iCapacity <= 0)
+        return;
+
+    s_qHashEntries.insert(t_sPath, t_entry);
+    s_qListRecent.removeOne(t_sPath);
+    s_qListRecent.append(t_sPath);
+    evict();
+}
+
+
+//*************************************************************************************************************
+
+void FiffDirCache::clear()
+{
+    QMutexLocker locker(&s_qMutex);
+    s_qHashEntries.clear();
+    s_qListRecent.clear();
+}
+
+
+//*************************************************************************************************************
+
+void FiffDirCache::setEnabled(bool p_bEnabled)
+{
+    QMutexLocker locker(&s_qMutex);
+    s_bEnabled = p_bEnabled;
+    if(!s_bEnabled)
+    {
+        s_qHashEntries.clear();
+        s_qListRecent.clear();
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool FiffDirCache::isEnabled()
+{
+    QMutexLocker locker(&s_qMutex);
+    return s_bEnabled;
+}
+
+
+//*************************************************************************************************************
+
+void FiffDirCache::setCapacity(qint32 p_iMaxFiles)
+{
+    QMutexLocker locker(&s_qMutex);
+    s_iCapacity = p_iMaxFiles > 0 ? p_iMaxFiles : 0;
+    evict();
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffDirCache::hits()
+{
+    QMutexLocker locker(&s_qMutex);
+    return s_iHits;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffDirCache::misses()
+{
+    QMutexLocker locker(&s_qMutex);
+    return s_iMisses;
+}
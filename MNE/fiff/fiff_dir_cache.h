@@ -0,0 +1,153 @@
+//=============================================================================================================
+/**
+* @file     fiff_dir_cache.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffDirCache class declaration.
+*
+*/
+
+#ifndef FIFF_DIR_CACHE_H
+#define FIFF_DIR_CACHE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_dir_entry.h"
+#include "fiff_dir_tree.h"
+#include "fiff_id.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QFile>
+#include <QList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+
+//=============================================================================================================
+/**
+* Process-wide cache of the tag directories and directory trees built by FiffStream::open. Entries are keyed by
+* the absolute file path and are only returned while size, modification time and file id of the file are
+* unchanged, so reopening a file costs the two leading tag reads instead of a directory read or a scan of all
+* tag headers plus the tree construction. The least recently used file is dropped when the cache is full.
+*
+* @brief Directory index cache of opened fiff files
+*/
+class FIFFSHARED_EXPORT FiffDirCache
+{
+public:
+    //=========================================================================================================
+    /**
+    * Looks up the directory and the directory tree of a file.
+    *
+    * @param[in] p_qFile    The opened file
+    * @param[in] p_fileId   The file id read from the first tag of the file
+    * @param[out] p_Dir     The cached tag directory
+    * @param[out] p_Tree    The cached directory tree
+    *
+    * @return true if a valid entry was found, false otherwise
+    */
+    static bool lookup(const QFile& p_qFile, const FiffId& p_fileId, QList<FiffDirEntry>& p_Dir, FiffDirTree& p_Tree);
+
+    //=========================================================================================================
+    /**
+    * Stores the directory and the directory tree of a file.
+    *
+    * @param[in] p_qFile    The opened file
+    * @param[in] p_fileId   The file id read from the first tag of the file
+    * @param[in] p_Dir      The tag directory
+    * @param[in] p_Tree     The directory tree
+    */
+    static void insert(const QFile& p_qFile, const FiffId& p_fileId, const QList<FiffDirEntry>& p_Dir, const FiffDirTree& p_Tree);
+
+    //=========================================================================================================
+    /**
+    * Removes all entries.
+    */
+    static void clear();
+
+    //=========================================================================================================
+    /**
+    * Enables or disables the cache; disabling drops all entries. The cache is enabled by default.
+    *
+    * @param[in] p_bEnabled     Whether FiffStream::open uses the cache
+    */
+    static void setEnabled(bool p_bEnabled);
+
+    //=========================================================================================================
+    /**
+    * Returns whether the cache is enabled.
+    *
+    * @return true if enabled, false otherwise
+    */
+    static bool isEnabled();
+
+    //=========================================================================================================
+    /**
+    * Sets the maximal number of cached files (default 32).
+    *
+    * @param[in] p_iMaxFiles    Maximal number of cached files
+    */
+    static void setCapacity(qint32 p_iMaxFiles);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of lookups which were answered from the cache.
+    *
+    * @return the number of cache hits
+    */
+    static qint64 hits();
+
+    //=========================================================================================================
+    /**
+    * Returns the number of lookups which were not answered from the cache.
+    *
+    * @return the number of cache misses
+    */
+    static qint64 misses();
+};
+
+} // NAMESPACE
+
+#endif // FIFF_DIR_CACHE_H
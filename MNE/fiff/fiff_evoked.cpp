@@ -41,6 +41,7 @@
 #include "fiff_evoked.h"
 #include "fiff_stream.h"
 #include "fiff_tag.h"
+#include "fiff_tag_view.h"
 
 #include <utils/mnemath.h>
 
@@ -178,6 +179,10 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
     if(!t_pStream->open(t_Tree, t_Dir))
         return false;
     //
+    //   Map the file when possible -> epoch data are decoded straight from the mapped file
+    //
+    t_pStream->map_file();
+    //
     //   Read the measurement info
     //
     FiffInfo info;
@@ -260,7 +265,29 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         return false;
     }
 
-    FiffDirTree my_evoked = evoked_node[setno.toInt()];
+    //
+    //   Read the data set, the tags are not needed anymore afterwards
+    //
+    bool t_bRead = FiffEvoked::read_evoked_node(t_pStream.data(), info, evoked_node[setno.toInt()], p_FiffEvoked);
+    if(t_pStream->is_mapped())
+        t_pStream->unmap_file();
+    if(!t_bRead)
+        return false;
+
+    p_FiffEvoked.finish_read(baseline, proj);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffEvoked::read_evoked_node(FiffStream* p_pStream, const FiffInfo& p_info, const FiffDirTree& p_EvokedNode, FiffEvoked& p_FiffEvoked)
+{
+    p_FiffEvoked.clear();
+
+    FiffInfo info = p_info;
+    const FiffDirTree& my_evoked = p_EvokedNode;
 
     //
     //   Identify the aspects
@@ -270,6 +297,12 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
     if(aspects.size() > 1)
         printf("\tMultiple (%d) aspects found. Taking first one.\n", aspects.size());
 
+    if(aspects.size() == 0)
+    {
+        qWarning("Could not find an aspect in the evoked data");
+        return false;
+    }
+
     FiffDirTree my_aspect = aspects[0];
 
     //
@@ -289,27 +322,27 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         switch (kind)
         {
             case FIFF_COMMENT:
-                FiffTag::read_tag(t_pStream.data(),t_pTag,pos);
+                FiffTag::read_tag(p_pStream,t_pTag,pos);
                 comment = t_pTag->toString();
                 break;
             case FIFF_FIRST_SAMPLE:
-                FiffTag::read_tag(t_pStream.data(),t_pTag,pos);
+                FiffTag::read_tag(p_pStream,t_pTag,pos);
                 first = *t_pTag->toInt();
                 break;
             case FIFF_LAST_SAMPLE:
-                FiffTag::read_tag(t_pStream.data(),t_pTag,pos);
+                FiffTag::read_tag(p_pStream,t_pTag,pos);
                 last = *t_pTag->toInt();
                 break;
             case FIFF_NCHAN:
-                FiffTag::read_tag(t_pStream.data(),t_pTag,pos);
+                FiffTag::read_tag(p_pStream,t_pTag,pos);
                 nchan = *t_pTag->toInt();
                 break;
             case FIFF_SFREQ:
-                FiffTag::read_tag(t_pStream.data(),t_pTag,pos);
+                FiffTag::read_tag(p_pStream,t_pTag,pos);
                 sfreq = *t_pTag->toFloat();
                 break;
             case FIFF_CH_INFO:
-                FiffTag::read_tag(t_pStream.data(), t_pTag, pos);
+                FiffTag::read_tag(p_pStream, t_pTag, pos);
                 chs.append( t_pTag->toChInfo() );
                 break;
         }
@@ -349,7 +382,9 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
     //
     fiff_int_t aspect_kind = -1;
     fiff_int_t nave = -1;
+    bool mapped = p_pStream->is_mapped();
     QList<FiffTag> epoch;
+    QList<FiffTagView> epoch_views;
     for (k = 0; k < my_aspect.nent; ++k)
     {
         kind = my_aspect.dir[k].kind;
@@ -358,20 +393,33 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         switch (kind)
         {
             case FIFF_COMMENT:
-                FiffTag::read_tag(t_pStream.data(), t_pTag, pos);
+                FiffTag::read_tag(p_pStream, t_pTag, pos);
                 comment = t_pTag->toString();
                 break;
             case FIFF_ASPECT_KIND:
-                FiffTag::read_tag(t_pStream.data(), t_pTag, pos);
+                FiffTag::read_tag(p_pStream, t_pTag, pos);
                 aspect_kind = *t_pTag->toInt();
                 break;
             case FIFF_NAVE:
-                FiffTag::read_tag(t_pStream.data(), t_pTag, pos);
+                FiffTag::read_tag(p_pStream, t_pTag, pos);
                 nave = *t_pTag->toInt();
                 break;
             case FIFF_EPOCH:
-                FiffTag::read_tag(t_pStream.data(), t_pTag, pos);
-                epoch.append(FiffTag(t_pTag.data()));
+                if(mapped)
+                {
+                    FiffTagView t_TagView;
+                    if(!p_pStream->read_tag_view(pos, t_TagView))
+                    {
+                        qWarning("Could not read the epoch tag.");
+                        return false;
+                    }
+                    epoch_views.append(t_TagView);
+                }
+                else
+                {
+                    FiffTag::read_tag(p_pStream, t_pTag, pos);
+                    epoch.append(FiffTag(t_pTag.data()));
+                }
                 break;
         }
     }
@@ -379,14 +427,23 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         nave = 1;
     printf("\t\tnave = %d - aspect type = %d\n", nave, aspect_kind);
 
-    qint32 nepoch = epoch.size();
+    qint32 nepoch = mapped ? epoch_views.size() : epoch.size();
     MatrixXd all_data;
     if (nepoch == 1)
     {
         //
         //   Only one epoch
         //
-        all_data = epoch[0].toFloatMatrix().cast<double>();
+        if (mapped)
+        {
+            if(!epoch_views[0].toFloatMatrix(all_data))
+            {
+                qWarning("Could not read the epoch data.");
+                return false;
+            }
+        }
+        else
+            all_data = epoch[0].toFloatMatrix().cast<double>();
         all_data.transposeInPlace();
         //
         //   May need a transpose if the number of channels is one
@@ -399,13 +456,32 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         //
         //   Put the old style epochs together
         //
-        all_data = epoch[0].toFloatMatrix().cast<double>();
+        if (mapped)
+        {
+            if(!epoch_views[0].toFloatMatrix(all_data))
+            {
+                qWarning("Could not read the epoch data.");
+                return false;
+            }
+        }
+        else
+            all_data = epoch[0].toFloatMatrix().cast<double>();
         all_data.transposeInPlace();
         qint32 oldsize;
+        MatrixXd tmp;
         for (k = 1; k < nepoch; ++k)
         {
             oldsize = all_data.rows();
-            MatrixXd tmp = epoch[k].toFloatMatrix().cast<double>();
+            if (mapped)
+            {
+                if(!epoch_views[k].toFloatMatrix(tmp))
+                {
+                    qWarning("Could not read the epoch data.");
+                    return false;
+                }
+            }
+            else
+                tmp = epoch[k].toFloatMatrix().cast<double>();
             tmp.transposeInPlace();
             all_data.conservativeResize(oldsize+tmp.rows(), all_data.cols());
             all_data.block(oldsize, 0, tmp.rows(), tmp.cols()) = tmp;
@@ -417,6 +493,30 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         return false;
     }
 
+    RowVectorXf times = RowVectorXf(last-first+1);
+    for (k = 0; k < times.size(); ++k)
+        times[k] = ((float)(first+k)) / info.sfreq;
+
+    // Put it all together, the data are calibrated by finish_read
+    p_FiffEvoked.info = info;
+    p_FiffEvoked.nave = nave;
+    p_FiffEvoked.aspect_kind = aspect_kind;
+    p_FiffEvoked.first = first;
+    p_FiffEvoked.last = last;
+    p_FiffEvoked.comment = comment;
+    p_FiffEvoked.times = times;
+    p_FiffEvoked.data = all_data;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffEvoked::finish_read(QPair<QVariant,QVariant> baseline, bool proj)
+{
+    qint32 k;
+
     //
     //   Calibrate
     //
@@ -428,11 +528,7 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
     SparseMatrix<double> cals(info.nchan, info.nchan);
     cals.setFromTriplets(tripletList.begin(), tripletList.end());
 
-    all_data = cals * all_data;
-
-    RowVectorXf times = RowVectorXf(last-first+1);
-    for (k = 0; k < times.size(); ++k)
-        times[k] = ((float)(first+k)) / info.sfreq;
+    data = cals * data;
 
     //
     // Set up projection
@@ -440,7 +536,7 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
     if(info.projs.size() == 0 || !proj)
     {
         printf("\tNo projector specified for these data.\n");
-        p_FiffEvoked.proj = MatrixXd();
+        this->proj = MatrixXd();
     }
     else
     {
@@ -450,38 +546,26 @@ bool FiffEvoked::read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant
         if(nproj == 0)
         {
             printf("\tThe projection vectors do not apply to these channels\n");
-            p_FiffEvoked.proj = MatrixXd();
+            this->proj = MatrixXd();
         }
         else
         {
             printf("\tCreated an SSP operator (subspace dimension = %d)\n", nproj);
-            p_FiffEvoked.proj = projection;
+            this->proj = projection;
         }
 
         //   The projection items have been activated
         FiffProj::activate_projs(info.projs);
     }
 
-    if(p_FiffEvoked.proj.rows() > 0)
+    if(this->proj.rows() > 0)
     {
         printf("\tSSP projectors applied...\n");
-        all_data = p_FiffEvoked.proj * all_data;
+        data = this->proj * data;
     }
 
     // Run baseline correction
-    all_data = MNEMath::rescale(all_data, times, baseline, QString("mean"));
-
-    // Put it all together
-    p_FiffEvoked.info = info;
-    p_FiffEvoked.nave = nave;
-    p_FiffEvoked.aspect_kind = aspect_kind;
-    p_FiffEvoked.first = first;
-    p_FiffEvoked.last = last;
-    p_FiffEvoked.comment = comment;
-    p_FiffEvoked.times = times;
-    p_FiffEvoked.data = all_data;
-
-    return true;
+    data = MNEMath::rescale(data, times, baseline, QString("mean"));
 }
 
 
@@ -82,6 +82,15 @@ namespace FIFFLIB
 using namespace Eigen;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class FiffStream;
+class FiffDirTree;
+
+
 //=============================================================================================================
 /**
 * NEW PYTHON LIKE Fiff evoked
@@ -197,6 +206,31 @@ public:
     */
     static bool read(QIODevice& p_IODevice, FiffEvoked& p_FiffEvoked, QVariant setno = 0, QPair<QVariant,QVariant> baseline = defaultVariantPair, bool proj = true, fiff_int_t p_aspect_kind = FIFFV_ASPECT_AVERAGE);
 
+    //=========================================================================================================
+    /**
+    * Reads one evoked data set from an opened stream, without parsing the directory tree and the measurement
+    * info again. The data are left uncalibrated; finish_read completes them. Used by FiffEvokedSet::read to
+    * read all data sets of a file with a single open.
+    *
+    * @param[in] p_pStream      The opened stream; when mapped, it has to stay mapped during the call
+    * @param[in] p_info         The measurement info, as read by FiffStream::read_meas_info
+    * @param[in] p_EvokedNode   The FIFFB_EVOKED block of the data set
+    * @param[out] p_FiffEvoked  The read evoked data
+    *
+    * @return true if successful, false otherwise
+    */
+    static bool read_evoked_node(FiffStream* p_pStream, const FiffInfo& p_info, const FiffDirTree& p_EvokedNode, FiffEvoked& p_FiffEvoked);
+
+    //=========================================================================================================
+    /**
+    * Calibrates the data read by read_evoked_node, applies the SSP projectors and the baseline correction.
+    * Does not access the stream, so several data sets can be finished concurrently.
+    *
+    * @param[in] baseline       The time interval to apply rescaling / baseline correction, see read
+    * @param[in] proj           Apply SSP projection vectors (optional, default = true)
+    */
+    void finish_read(QPair<QVariant,QVariant> baseline = defaultVariantPair, bool proj = true);
+
     //=========================================================================================================
     /**
     * Set a new fiff measurement info
@@ -40,6 +40,16 @@
 
 #include "fiff_evoked_set.h"
 #include "fiff_tag.h"
+#include "fiff_stream.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QRunnable>
+#include <QSemaphore>
 
 
 //*************************************************************************************************************
@@ -59,6 +69,45 @@ using namespace FIFFLIB;
 using namespace Eigen;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// FINISH TASK
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+/**
+* Calibrates, projects and baseline corrects one read evoked data set. Releases its slot when done.
+*/
+class FiffEvokedFinishTask : public QRunnable
+{
+public:
+    FiffEvokedFinishTask(FiffEvoked& p_FiffEvoked, const QPair<QVariant,QVariant>& p_Baseline, bool p_bProj, QSemaphore& p_Done)
+    : m_FiffEvoked(p_FiffEvoked)
+    , m_Baseline(p_Baseline)
+    , m_bProj(p_bProj)
+    , m_Done(p_Done)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        m_FiffEvoked.finish_read(m_Baseline, m_bProj);
+        m_Done.release();
+    }
+
+private:
+    FiffEvoked& m_FiffEvoked;
+    QPair<QVariant,QVariant> m_Baseline;
+    bool m_bProj;
+    QSemaphore& m_Done;
+};
+
+} // NAMESPACE
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -163,7 +212,7 @@ FiffEvokedSet FiffEvokedSet::pick_channels(const QStringList& include, const QSt
 
 //*************************************************************************************************************
 
-bool FiffEvokedSet::read(QIODevice& p_IODevice, FiffEvokedSet& p_FiffEvokedSet, QPair<QVariant,QVariant> baseline, bool proj)
+bool FiffEvokedSet::read(QIODevice& p_IODevice, FiffEvokedSet& p_FiffEvokedSet, QPair<QVariant,QVariant> baseline, bool proj, QThreadPool* p_pThreadPool)
 {
     p_FiffEvokedSet.clear();
 
@@ -180,6 +229,10 @@ bool FiffEvokedSet::read(QIODevice& p_IODevice, FiffEvokedSet& p_FiffEvokedSet,
     if(!t_pStream->open(t_Tree, t_Dir))
         return false;
     //
+    //   Map the file when possible -> epoch data are decoded straight from the mapped file
+    //
+    t_pStream->map_file();
+    //
     //   Read the measurement info
     //
     FiffDirTree meas;
@@ -210,14 +263,42 @@ bool FiffEvokedSet::read(QIODevice& p_IODevice, FiffEvokedSet& p_FiffEvokedSet,
         t = QString("None found, must use integer");
     printf("\tFound %d datasets\n", evoked_node.size());
 
-    for(qint32 i = 0; i < comments.size(); ++i)
+    //
+    //   The tree and the measurement info are parsed once, all data sets are read from this open stream
+    //
+    QList<FiffEvoked> t_qListEvoked;
+    for(qint32 i = 0; i < evoked_node.size(); ++i)
     {
-        QFile t_file(p_FiffEvokedSet.info.filename);
-        printf(">> Processing %s <<\n", comments[i].toLatin1().constData());
+        if(i < comments.size())
+            printf(">> Processing %s <<\n", comments[i].toLatin1().constData());
         FiffEvoked t_FiffEvoked;
-        if(FiffEvoked::read(t_file, t_FiffEvoked, i, baseline, proj))
-            p_FiffEvokedSet.evoked.push_back(t_FiffEvoked);
+        if(FiffEvoked::read_evoked_node(t_pStream.data(), p_FiffEvokedSet.info, evoked_node[i], t_FiffEvoked))
+            t_qListEvoked.append(t_FiffEvoked);
+    }
+    if(t_pStream->is_mapped())
+        t_pStream->unmap_file();
+
+    //
+    //   Calibration, projection and baseline correction do not access the file -> finish the data sets in parallel.
+    //   A set is only handed to the pool when an idle thread takes it right away, otherwise and for the last set
+    //   it is finished here; waiting can thus not deadlock when read is itself called from a task of the pool
+    //
+    if(!p_pThreadPool)
+        p_pThreadPool = QThreadPool::globalInstance();
+
+    QSemaphore t_done;
+    for(qint32 i = 0; i < t_qListEvoked.size(); ++i)
+    {
+        FiffEvokedFinishTask* t_pTask = new FiffEvokedFinishTask(t_qListEvoked[i], baseline, proj, t_done);
+        if(i == t_qListEvoked.size()-1 || !p_pThreadPool->tryStart(t_pTask))
+        {
+            t_pTask->run();
+            delete t_pTask;
+        }
     }
+    t_done.acquire(t_qListEvoked.size());
+
+    p_FiffEvokedSet.evoked = t_qListEvoked;
 
     return true;
 
@@ -56,6 +56,7 @@
 #include <QList>
 #include <QSharedPointer>
 #include <QStringList>
+#include <QThreadPool>
 
 
 //*************************************************************************************************************
@@ -152,7 +153,8 @@ public:
     *
     * Wrapper for the FiffEvokedDataSet::read_evoked static function
     *
-    * Read one evoked data set
+    * Read all evoked data sets. The file is opened and its directory tree and measurement info are parsed once,
+    * the data sets are then finished on the thread pool.
     *
     * @param[in] p_IODevice         An fiff IO device like a fiff QFile or QTCPSocket
     * @param[out] p_FiffEvokedSet   The read evoked data set
@@ -161,10 +163,12 @@ public:
     *                               None then b is set to the end of the interval. If baseline is equal ot (None, None) all the time interval is used.
     *                               If None, no correction is applied.
     * @param[in] proj           Apply SSP projection vectors (optional, default = true)
+    * @param[in] p_pThreadPool  thread pool whose idle threads help finishing the data sets; defaults to
+    *                           QThreadPool::globalInstance() (optional)
     *
     * @return true when successful, false otherwise
     */
-    static bool read(QIODevice& p_IODevice, FiffEvokedSet& p_FiffEvokedSet, QPair<QVariant,QVariant> baseline = defaultVariantPair, bool proj = true);
+    static bool read(QIODevice& p_IODevice, FiffEvokedSet& p_FiffEvokedSet, QPair<QVariant,QVariant> baseline = defaultVariantPair, bool proj = true, QThreadPool* p_pThreadPool = NULL);
 
 public:
     FiffInfo             info;   /**< FIFF measurement information */
@@ -40,9 +40,22 @@
 
 #include "fiff_raw_data.h"
 #include "fiff_tag.h"
+#include "fiff_tag_view.h"
 #include "fiff_stream.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QVector>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -51,6 +64,76 @@
 using namespace FIFFLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DECODE TASK
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+/**
+* Part of a raw data buffer which belongs to one segment of FiffRawData::read_raw_segments
+*/
+struct FiffRawPick
+{
+    qint32 segment;     /**< Index of the segment */
+    qint32 first_pick;  /**< First sample within the buffer */
+    qint32 picksamp;    /**< Number of samples */
+    qint32 dest;        /**< First column within the segment */
+};
+
+
+/**
+* Decodes one read ahead raw data buffer into all segments it overlaps. Releases its read-ahead slot when done.
+*/
+class FiffRawDecodeTask : public QRunnable
+{
+public:
+    FiffRawDecodeTask(const FiffRawData* p_pRaw, const QList<FiffRawPick>& p_Picks, const RowVectorXi& p_Sel, const SparseMatrix<double>& p_Mult, const RowVectorXd& p_SelCals, const QVector<MatrixXd*>& p_Outputs, QSemaphore& p_InFlight, QAtomicInt& p_Failed)
+    : m_pRaw(p_pRaw)
+    , m_Picks(p_Picks)
+    , m_Sel(p_Sel)
+    , m_Mult(p_Mult)
+    , m_SelCals(p_SelCals)
+    , m_Outputs(p_Outputs)
+    , m_InFlight(p_InFlight)
+    , m_Failed(p_Failed)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        for(qint32 p = 0; p < m_Picks.size(); ++p)
+        {
+            const FiffRawPick& pick = m_Picks[p];
+            if(!m_pRaw->decode_buffer(m_TagView, pick.first_pick, pick.picksamp, m_Sel, m_Mult, m_SelCals, *m_Outputs[pick.segment], pick.dest))
+            {
+                m_Failed.fetchAndStoreOrdered(1);
+                break;
+            }
+        }
+        m_InFlight.release();
+    }
+
+    FiffTagView m_TagView;  /**< View on the buffer, set by the reading thread */
+    QByteArray m_Staging;   /**< Payload storage if the stream is not mapped */
+
+private:
+    const FiffRawData* m_pRaw;
+    QList<FiffRawPick> m_Picks;
+    const RowVectorXi& m_Sel;
+    const SparseMatrix<double>& m_Mult;
+    const RowVectorXd& m_SelCals;
+    const QVector<MatrixXd*>& m_Outputs;
+    QSemaphore& m_InFlight;
+    QAtomicInt& m_Failed;
+};
+
+} // NAMESPACE
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -120,11 +203,6 @@ void FiffRawData::clear()
 
 bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel)
 {
-    bool projAvailable = true;
-
-    if (this->proj.size() == 0)
-        projAvailable = false;
-
     if(from == -1)
         from = this->first_samp;
     if(to == -1)
@@ -146,98 +224,20 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
     //
     //  Initialize the data and calibration vector
     //
-    qint32 nchan = this->info.nchan;
     qint32 dest  = 0;//1;
-    qint32 i, k, r;
-
-    typedef Eigen::Triplet<double> T;
-    std::vector<T> tripletList;
-    tripletList.reserve(nchan);
-    for(i = 0; i < nchan; ++i)
-        tripletList.push_back(T(i, i, this->cals[i]));
-
-    SparseMatrix<double> cal(nchan, nchan);
-    cal.setFromTriplets(tripletList.begin(), tripletList.end());
-//    cal.makeCompressed();
+    qint32 i, k;
 
-    MatrixXd mult_full;
-    //
     if (sel.size() == 0)
-    {
-        data = MatrixXd(nchan, to-from+1);
-//            data->setZero();
-        if (projAvailable || this->comp.kind != -1)
-        {
-            if (!projAvailable)
-                mult_full = this->comp.data->data*cal;
-            else if (this->comp.kind == -1)
-                mult_full = this->proj*cal;
-            else
-                mult_full = this->proj*this->comp.data->data*cal;
-        }
-    }
+        data = MatrixXd(this->info.nchan, to-from+1);
     else
-    {
         data = MatrixXd(sel.size(),to-from+1);
-//            data->setZero();
-
-        MatrixXd selVect(sel.size(), nchan);
-
-        selVect.setZero();
-
-        if (!projAvailable && this->comp.kind == -1)
-        {
-            tripletList.clear();
-            tripletList.reserve(sel.size());
-            for(i = 0; i < sel.size(); ++i)
-                tripletList.push_back(T(i, i, this->cals[sel[i]]));
-            cal = SparseMatrix<double>(sel.size(), sel.size());
-            cal.setFromTriplets(tripletList.begin(), tripletList.end());
-        }
-        else
-        {
-            if (!projAvailable)
-            {
-                qDebug() << "This has to be debugged! #1";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->comp.data->data.block(sel[i],0,1,nchan);
-                mult_full = selVect*cal;
-            }
-            else if (this->comp.kind == -1)
-            {
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
+//    data->setZero();
 
-                mult_full = selVect*cal;
-            }
-            else
-            {
-                qDebug() << "This has to be debugged! #3";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
-
-                mult_full = selVect*this->comp.data->data*cal;
-            }
-        }
-    }
+    SparseMatrix<double> mult;
+    RowVectorXd selCals;
+    this->setup_decoding(sel, mult, selCals);
 
     bool do_debug = false;
-    //
-    // Make mult sparse
-    //
-    tripletList.clear();
-    tripletList.reserve(mult_full.rows()*mult_full.cols());
-    for(i = 0; i < mult_full.rows(); ++i)
-        for(k = 0; k < mult_full.cols(); ++k)
-            if(mult_full(i,k) != 0)
-                tripletList.push_back(T(i, k, mult_full(i,k)));
-
-    SparseMatrix<double> mult(mult_full.rows(),mult_full.cols());
-    if(tripletList.size() > 0)
-        mult.setFromTriplets(tripletList.begin(), tripletList.end());
-//    mult.makeCompressed();
-
-    //
 
     FiffStream::SPtr fid;
     if (!this->file->device()->isOpen())
@@ -253,167 +253,101 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
         fid = this->file;
     }
 
-    MatrixXd one;
-    bool doing_whole;
+    //
+    //  Buffers are decoded through tag views: zero-copy when the stream is mapped, otherwise via a staging
+    //  buffer which is allocated once for the whole segment
+    //
+    QByteArray t_Staging;
+    FiffTagView t_TagView;
     fiff_int_t first_pick, last_pick, picksamp;
-    for(k = 0; k < this->rawdir.size(); ++k)
+    //
+    //  Seek directly to the first buffer overlapping the requested range
+    //
+    for(k = this->find_raw_dir(from); k < this->rawdir.size(); ++k)
     {
-        FiffRawDir thisRawDir = this->rawdir[k];
+        const FiffRawDir& thisRawDir = this->rawdir[k];
         //
-        //  Do we need this buffer
+        //  The picking logic is a bit complicated
         //
-        if (thisRawDir.last > from)
+        if (to >= thisRawDir.last && from <= thisRawDir.first)
         {
-            if (thisRawDir.ent.kind == -1)
-            {
-                //
-                //  Take the easy route: skip is translated to zeros
-                //
-                if(do_debug)
-                    printf("S");
-                doing_whole = false;
-                if (sel.cols() <= 0)
-                    one.resize(nchan,thisRawDir.nsamp);
-                else
-                    one.resize(sel.cols(),thisRawDir.nsamp);
-
-                one.setZero();
-            }
-            else
-            {
-                FiffTag::SPtr t_pTag;
-                FiffTag::read_tag(fid.data(), t_pTag, thisRawDir.ent.pos);
-                //
-                //   Depending on the state of the projection and selection
-                //   we proceed a little bit differently
-                //
-                if (mult.cols() == 0)
-                {
-                    if (sel.cols() == 0)
-                    {
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_INT)
-                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else
-                            printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
-                    }
-                    else
-                    {
-
-                        //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
-                        MatrixXd newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
-
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_INT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else
-                        {
-                            printf("Data Storage Format not known jet [2]!! Type: %d\n", t_pTag->type);
-                        }
-
-                        one = cal*newData;
-                    }
-                }
-                else
-                {
-                    if (t_pTag->type == FIFFT_DAU_PACK16)
-                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_INT)
-                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_FLOAT)
-                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else
-                        printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
-                }
-            }
             //
-            //  The picking logic is a bit complicated
+            //  We need the whole buffer
             //
-            if (to >= thisRawDir.last && from <= thisRawDir.first)
+            first_pick = 0;//1;
+            last_pick  = thisRawDir.nsamp - 1;
+            if (do_debug)
+                printf("W");
+        }
+        else if (from > thisRawDir.first)
+        {
+            first_pick = from - thisRawDir.first;// + 1;
+            if(to < thisRawDir.last)
             {
                 //
-                //  We need the whole buffer
+                //  Something from the middle
                 //
-                first_pick = 0;//1;
-                last_pick  = thisRawDir.nsamp - 1;
-                if (do_debug)
-                    printf("W");
-            }
-            else if (from > thisRawDir.first)
-            {
-                first_pick = from - thisRawDir.first;// + 1;
-                if(to < thisRawDir.last)
-                {
-                    //
-                    //  Something from the middle
-                    //
 //                    qDebug() << "This needs to be debugged!";
-                    last_pick = thisRawDir.nsamp + to - thisRawDir.last - 1;//is this alright?
-                    if (do_debug)
-                        printf("M");
-                }
-                else
-                {
-                    //
-                    //  From the middle to the end
-                    //
-                    last_pick = thisRawDir.nsamp - 1;
-                    if (do_debug)
-                        printf("E");
-                }
+                last_pick = thisRawDir.nsamp + to - thisRawDir.last - 1;//is this alright?
+                if (do_debug)
+                    printf("M");
             }
             else
             {
                 //
-                //  From the beginning to the middle
+                //  From the middle to the end
                 //
-                first_pick = 0;//1;
-                last_pick  = to - thisRawDir.first;// + 1;
+                last_pick = thisRawDir.nsamp - 1;
                 if (do_debug)
-                    printf("B");
+                    printf("E");
             }
+        }
+        else
+        {
             //
-            //  Now we are ready to pick
+            //  From the beginning to the middle
             //
-            picksamp = last_pick - first_pick + 1;
+            first_pick = 0;//1;
+            last_pick  = to - thisRawDir.first;// + 1;
+            if (do_debug)
+                printf("B");
+        }
+        //
+        //  Now we are ready to pick
+        //
+        picksamp = last_pick - first_pick + 1;
+
+        if(do_debug)
+        {
+            qDebug() << "first_pick: " << first_pick;
+            qDebug() << "last_pick: " << last_pick;
+            qDebug() << "picksamp: " << picksamp;
+        }
 
-            if(do_debug)
+        if (picksamp > 0)
+        {
+            if (thisRawDir.ent.kind == -1)
             {
-                qDebug() << "first_pick: " << first_pick;
-                qDebug() << "last_pick: " << last_pick;
-                qDebug() << "picksamp: " << picksamp;
+                //
+                //  Take the easy route: skip is translated to zeros
+                //
+                if(do_debug)
+                    printf("S");
+                data.block(0,dest,data.rows(),picksamp).setZero();
             }
-
-            if (picksamp > 0)
+            else
             {
-//                    for(r = 0; r < data->rows(); ++r)
-//                        for(c = 0; c < picksamp; ++c)
-//                            (*data)(r,dest + c) = one(r,first_pick + c);
-                data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
+                if (!fid->read_tag_view(thisRawDir.ent.pos, t_TagView, &t_Staging))
+                {
+                    printf("Could not read data buffer at %d\n", thisRawDir.ent.pos);
+                    return false;
+                }
 
-                dest += picksamp;
+                if (!this->decode_buffer(t_TagView, first_pick, picksamp, sel, mult, selCals, data, dest))
+                    return false;
             }
+
+            dest += picksamp;
         }
         //
         //  Done?
@@ -436,6 +370,174 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
 }
 
 
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_segments(QList<MatrixXd>& data, const QList<QPair<fiff_int_t,fiff_int_t> >& windows, const RowVectorXi& sel, qint32 p_iReadAhead, QThreadPool* p_pThreadPool)
+{
+    data.clear();
+    if(windows.size() == 0)
+        return true;
+
+    if(p_iReadAhead < 1)
+        p_iReadAhead = 1;
+    if(!p_pThreadPool)
+        p_pThreadPool = QThreadPool::globalInstance();
+
+    qint32 nrow = sel.size() == 0 ? this->info.nchan : sel.size();
+    qint32 w, k;
+
+    //
+    //  Clip the windows and collect for each needed buffer the picks of all windows -> every buffer is read once,
+    //  even if windows overlap
+    //
+    QMap<qint32, QList<FiffRawPick> > picks;
+    for(w = 0; w < windows.size(); ++w)
+    {
+        fiff_int_t from = windows[w].first;
+        fiff_int_t to = windows[w].second;
+        if(from < this->first_samp)
+            from = this->first_samp;
+        if(to > this->last_samp)
+            to = this->last_samp;
+        if(from > to)
+        {
+            printf("No data in range %d ... %d\n", windows[w].first, windows[w].second);
+            data.clear();
+            return false;
+        }
+
+        data.append(MatrixXd(nrow, to-from+1));
+
+        qint32 dest = 0;
+        for(k = this->find_raw_dir(from); k < this->rawdir.size(); ++k)
+        {
+            const FiffRawDir& thisRawDir = this->rawdir[k];
+            FiffRawPick pick;
+            pick.segment    = w;
+            pick.first_pick = qMax(from, thisRawDir.first) - thisRawDir.first;
+            pick.picksamp   = qMin(to, thisRawDir.last) - thisRawDir.first - pick.first_pick + 1;
+            pick.dest       = dest;
+            if(pick.picksamp > 0)
+            {
+                picks[k].append(pick);
+                dest += pick.picksamp;
+            }
+            if (thisRawDir.last >= to)
+                break;
+        }
+    }
+
+    //
+    //  Fix the output locations before any decoder runs; the decoders write disjoint column blocks
+    //
+    QVector<MatrixXd*> outputs(data.size());
+    for(w = 0; w < data.size(); ++w)
+        outputs[w] = &data[w];
+
+    SparseMatrix<double> mult;
+    RowVectorXd selCals;
+    this->setup_decoding(sel, mult, selCals);
+
+    if (!this->file->device()->isOpen() && !this->file->device()->open(QIODevice::ReadOnly))
+    {
+        printf("Cannot open file %s\n",this->info.filename.toUtf8().constData());
+        data.clear();
+        return false;
+    }
+
+    printf("Reading %d segments from %d buffers...", windows.size(), picks.size());
+
+    //
+    //  This thread does the I/O in file order and keeps at most p_iReadAhead payloads in flight,
+    //  decoding is fanned out to idle threads of the pool
+    //
+    QSemaphore inFlight(p_iReadAhead);
+    QAtomicInt failed(0);
+    bool ok = true;
+
+    QMap<qint32, QList<FiffRawPick> >::ConstIterator it;
+    for(it = picks.constBegin(); it != picks.constEnd(); ++it)
+    {
+        const FiffRawDir& thisRawDir = this->rawdir[it.key()];
+        const QList<FiffRawPick>& bufPicks = it.value();
+
+        if(thisRawDir.ent.kind == -1)
+        {
+            for(qint32 p = 0; p < bufPicks.size(); ++p)
+                outputs[bufPicks[p].segment]->block(0, bufPicks[p].dest, nrow, bufPicks[p].picksamp).setZero();
+            continue;
+        }
+
+        inFlight.acquire();
+        if(failed.loadAcquire())
+        {
+            inFlight.release();
+            ok = false;
+            break;
+        }
+
+        FiffRawDecodeTask* task = new FiffRawDecodeTask(this, bufPicks, sel, mult, selCals, outputs, inFlight, failed);
+        if(!this->file->read_tag_view(thisRawDir.ent.pos, task->m_TagView, &task->m_Staging))
+        {
+            printf("Could not read data buffer at %d\n", thisRawDir.ent.pos);
+            delete task;
+            inFlight.release();
+            ok = false;
+            break;
+        }
+
+        //
+        //  A buffer is only handed to the pool when an idle thread takes it right away, otherwise and for the last
+        //  buffer it is decoded here; waiting can thus not deadlock when this is itself called from a task of the pool
+        //
+        QMap<qint32, QList<FiffRawPick> >::ConstIterator next = it;
+        ++next;
+        if(next == picks.constEnd() || !p_pThreadPool->tryStart(task))
+        {
+            task->run();
+            delete task;
+        }
+    }
+
+    //
+    //  Wait until all decoders are done
+    //
+    inFlight.acquire(p_iReadAhead);
+    inFlight.release(p_iReadAhead);
+
+    if(!ok || failed.loadAcquire())
+    {
+        printf(" [failed]\n");
+        data.clear();
+        return false;
+    }
+
+    printf(" [done]\n");
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+qint32 FiffRawData::find_raw_dir(fiff_int_t p_iSample) const
+{
+    //
+    //  rawdir is sorted and contiguous -> binary search for the first buffer with last >= p_iSample
+    //
+    qint32 lo = 0;
+    qint32 hi = this->rawdir.size();
+    while(lo < hi)
+    {
+        qint32 mid = lo + (hi - lo) / 2;
+        if(this->rawdir[mid].last < p_iSample)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
 //*************************************************************************************************************
 
 bool FiffRawData::read_raw_segment_times(MatrixXd& data, MatrixXd& times, float from, float to, const RowVectorXi& sel)
@@ -450,3 +552,124 @@ bool FiffRawData::read_raw_segment_times(MatrixXd& data, MatrixXd& times, float
     //
     return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
 }
+
+
+//*************************************************************************************************************
+
+void FiffRawData::setup_decoding(const RowVectorXi& sel, SparseMatrix<double>& mult, RowVectorXd& selCals) const
+{
+    bool projAvailable = this->proj.size() != 0;
+    qint32 nchan = this->info.nchan;
+    qint32 i, k;
+
+    //
+    //  The calibration is fused into the buffer decoding (FiffTagView::toCalibratedMatrix),
+    //  hence the projection/compensation matrix is set up without it
+    //
+    MatrixXd mult_full;
+    selCals = RowVectorXd();
+    //
+    if (sel.size() == 0)
+    {
+        if (projAvailable || this->comp.kind != -1)
+        {
+            if (!projAvailable)
+                mult_full = this->comp.data->data;
+            else if (this->comp.kind == -1)
+                mult_full = this->proj;
+            else
+                mult_full = this->proj*this->comp.data->data;
+        }
+    }
+    else
+    {
+        if (!projAvailable && this->comp.kind == -1)
+        {
+            selCals.resize(sel.size());
+            for(i = 0; i < sel.size(); ++i)
+                selCals[i] = this->cals[sel[i]];
+        }
+        else
+        {
+            MatrixXd selVect(sel.size(), nchan);
+
+            if (!projAvailable)
+            {
+                qDebug() << "This has to be debugged! #1";
+                for( i = 0; i  < sel.size(); ++i)
+                    selVect.row(i) = this->comp.data->data.row(sel[i]);
+                mult_full = selVect;
+            }
+            else if (this->comp.kind == -1)
+            {
+                for( i = 0; i  < sel.size(); ++i)
+                    selVect.row(i) = this->proj.row(sel[i]);
+
+                mult_full = selVect;
+            }
+            else
+            {
+                qDebug() << "This has to be debugged! #3";
+                for( i = 0; i  < sel.size(); ++i)
+                    selVect.row(i) = this->proj.row(sel[i]);
+
+                mult_full = selVect*this->comp.data->data;
+            }
+        }
+    }
+
+    //
+    // Make mult sparse
+    //
+    typedef Eigen::Triplet<double> T;
+    std::vector<T> tripletList;
+    tripletList.reserve(mult_full.rows()*mult_full.cols());
+    for(i = 0; i < mult_full.rows(); ++i)
+        for(k = 0; k < mult_full.cols(); ++k)
+            if(mult_full(i,k) != 0)
+                tripletList.push_back(T(i, k, mult_full(i,k)));
+
+    mult = SparseMatrix<double>(mult_full.rows(),mult_full.cols());
+    if(tripletList.size() > 0)
+        mult.setFromTriplets(tripletList.begin(), tripletList.end());
+//    mult.makeCompressed();
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawData::decode_buffer(const FiffTagView& p_TagView, qint32 first_pick, qint32 picksamp, const RowVectorXi& sel, const SparseMatrix<double>& mult, const RowVectorXd& selCals, MatrixXd& data, qint32 dest) const
+{
+    //
+    //   Depending on the state of the projection and selection
+    //   we proceed a little bit differently
+    //
+    if (mult.cols() == 0)
+    {
+        //
+        //  Decode and calibrate the picked samples straight into the output;
+        //  with a selection only the selected rows of the payload are touched
+        //
+        bool decoded = sel.cols() == 0 ?
+                    p_TagView.toCalibratedMatrix(this->cals, first_pick, picksamp, data, dest) :
+                    p_TagView.toCalibratedMatrix(this->info.nchan, sel, selCals, first_pick, picksamp, data, dest);
+        if (!decoded)
+        {
+            printf("Data Storage Format not known jet [1]!! Type: %d\n", p_TagView.type);
+            return false;
+        }
+    }
+    else
+    {
+        MatrixXd one(this->info.nchan, picksamp);
+        if (!p_TagView.toCalibratedMatrix(this->cals, first_pick, picksamp, one))
+        {
+            printf("Data Storage Format not known jet [2]!! Type: %d\n", p_TagView.type);
+            return false;
+        }
+
+        data.block(0,dest,data.rows(),picksamp) = mult*one;
+    }
+
+    return true;
+}
@@ -63,7 +63,9 @@
 
 #include <QFile>
 #include <QList>
+#include <QPair>
 #include <QSharedPointer>
+#include <QThreadPool>
 
 
 //*************************************************************************************************************
@@ -75,6 +77,8 @@ namespace FIFFLIB
 {
 
 class FiffRawData;
+class FiffTagView;
+class FiffRawDecodeTask;
 
 
 //*************************************************************************************************************
@@ -174,6 +178,58 @@ public:
     */
     bool read_raw_segment_times(MatrixXd& data, MatrixXd& times, float from, float to, const RowVectorXi& sel = defaultRowVectorXi);
 
+    //=========================================================================================================
+    /**
+    * Looks up the raw directory entry which holds the given sample. The entries of rawdir are stored in
+    * ascending sample order and do not overlap, so the lookup is a binary search on first/last, i.e.
+    * O(log n) in the number of buffers.
+    *
+    * @param[in] p_iSample  the sample to look for
+    *
+    * @return index of the first buffer with last >= p_iSample; rawdir.size() if the sample is beyond the data
+    */
+    qint32 find_raw_dir(fiff_int_t p_iSample) const;
+
+    //=========================================================================================================
+    /**
+    * Reads several raw data segments (e.g. epochs) in one go. The calling thread reads the needed buffers in
+    * file order, each buffer only once even when windows overlap, and keeps up to p_iReadAhead buffers in
+    * flight while their decoding (swap, convert, calibrate, project) runs on a thread pool.
+    *
+    * @param[out] data          returns one data matrix (channels x samples) per window
+    * @param[in] windows        first and last sample of each segment
+    * @param[in] sel            channel selection vector (optional)
+    * @param[in] p_iReadAhead   maximal number of buffers read ahead of the decoding (optional)
+    * @param[in] p_pThreadPool  thread pool whose idle threads help decoding; defaults to
+    *                           QThreadPool::globalInstance() (optional)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool read_raw_segments(QList<MatrixXd>& data, const QList<QPair<fiff_int_t,fiff_int_t> >& windows, const RowVectorXi& sel = defaultRowVectorXi, qint32 p_iReadAhead = 8, QThreadPool* p_pThreadPool = NULL);
+
+private:
+    friend class FiffRawDecodeTask;
+
+    //=========================================================================================================
+    /**
+    * Sets up the projection/compensation operator and the calibration of the selected channels as needed
+    * by decode_buffer.
+    *
+    * @param[in] sel        channel selection vector
+    * @param[out] mult      projection/compensation operator, empty if none is active
+    * @param[out] selCals   calibration factors of the selected channels, empty if not needed
+    */
+    void setup_decoding(const RowVectorXi& sel, SparseMatrix<double>& mult, RowVectorXd& selCals) const;
+
+    //=========================================================================================================
+    /**
+    * Decodes picksamp samples starting at first_pick of a raw data buffer into data, starting at column dest.
+    * Only reads the members, so it can run on several threads at once.
+    *
+    * @return true if succeeded, false if the buffer type is not supported
+    */
+    bool decode_buffer(const FiffTagView& p_TagView, qint32 first_pick, qint32 picksamp, const RowVectorXi& sel, const SparseMatrix<double>& mult, const RowVectorXd& selCals, MatrixXd& data, qint32 dest) const;
+
 public:
     FiffStream::SPtr file;      /**< replaces fid */
     FiffInfo info;              /**< Fiff measurement information */
@@ -0,0 +1,341 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_writer.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the FiffRawWriter Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_raw_writer.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
+#include <QFile>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// SYSTEM INCLUDES
+//=============================================================================================================
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawWriter::FiffRawWriter(qint32 p_iNumBuffers, QObject *parent)
+: QThread(parent)
+, m_pIODevice(NULL)
+, m_qVecSlots(p_iNumBuffers > 1 ? p_iNumBuffers : 2)
+, m_iHead(0)
+, m_iQueued(0)
+, m_bOpen(false)
+, m_bError(false)
+, m_bWriting(false)
+, m_iSyncInterval(0)
+, m_iBuffersWritten(0)
+, m_iStalls(0)
+, m_iMaxStallNs(0)
+, m_iTotalStallNs(0)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+FiffRawWriter::~FiffRawWriter()
+{
+    close();
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawWriter::open(QIODevice &p_IODevice, const FiffInfo& info, qint32 p_iNumSamples, MatrixXi sel, fiff_int_t p_iFirstSample)
+{
+    if(m_bOpen)
+    {
+        printf("FiffRawWriter: close the current file first.\n");
+        return false;
+    }
+
+    MatrixXd cals;
+    m_pStream = FiffStream::start_writing_raw(p_IODevice, info, cals, sel);
+    if(!m_pStream)
+        return false;
+
+    if(p_iFirstSample > 0)
+        m_pStream->write_int(FIFF_FIRST_SAMPLE, &p_iFirstSample);
+
+    m_pIODevice = &p_IODevice;
+    m_vecCals = cals;
+
+    //
+    //  Preallocate all slots, write() only copies into them
+    //
+    for(qint32 i = 0; i < m_qVecSlots.size(); ++i)
+        m_qVecSlots[i].resize(m_vecCals.cols(), p_iNumSamples);
+
+    m_iHead = 0;
+    m_iQueued = 0;
+    m_bError = false;
+    m_iBuffersWritten = 0;
+    m_iStalls = 0;
+    m_iMaxStallNs = 0;
+    m_iTotalStallNs = 0;
+
+    m_bOpen = true;
+    QThread::start();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawWriter::write(const MatrixXd& buf)
+{
+    if(buf.rows() != m_vecCals.cols())
+    {
+        printf("FiffRawWriter: buffer and calibration sizes do not match\n");
+        return false;
+    }
+
+    m_qMutex.lock();
+
+    if(m_iQueued == m_qVecSlots.size() && m_bOpen && !m_bError)
+    {
+        QElapsedTimer t_timer;
+        t_timer.start();
+
+        while(m_iQueued == m_qVecSlots.size() && m_bOpen && !m_bError)
+            m_qSlotFree.wait(&m_qMutex);
+
+        qint64 t_iStallNs = t_timer.nsecsElapsed();
+        ++m_iStalls;
+        m_iTotalStallNs += t_iStallNs;
+        if(t_iStallNs > m_iMaxStallNs)
+            m_iMaxStallNs = t_iStallNs;
+    }
+
+    if(!m_bOpen || m_bError)
+    {
+        m_qMutex.unlock();
+        return false;
+    }
+
+    qint32 t_iSlot = (m_iHead + m_iQueued) % m_qVecSlots.size();
+    m_bWriting = true;
+    m_qMutex.unlock();
+
+    //
+    //  The slot is owned by the producer until it is queued; a buffer of the preallocated size is copied
+    //  without allocation
+    //
+    m_qVecSlots[t_iSlot] = buf;
+
+    //
+    //  close() waits for this copy, so the writer thread is still running and drains the slot
+    //
+    m_qMutex.lock();
+    ++m_iQueued;
+    m_bWriting = false;
+    m_qSlotQueued.wakeAll();
+    m_qWriteDone.wakeAll();
+    m_qMutex.unlock();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawWriter::close()
+{
+    m_qMutex.lock();
+    if(!m_bOpen)
+    {
+        m_qMutex.unlock();
+        return false;
+    }
+    // a buffer being copied by write() is queued before the writer thread is told to stop
+    while(m_bWriting)
+        m_qWriteDone.wait(&m_qMutex);
+    m_bOpen = false;
+    m_qSlotQueued.wakeAll();
+    m_qSlotFree.wakeAll();
+    m_qMutex.unlock();
+
+    // the writer thread drains the queue before it returns
+    QThread::wait();
+
+    m_pStream->finish_writing_raw();
+    sync();
+
+    bool t_bSuccess = !m_bError && m_pStream->status() == QDataStream::Ok;
+
+    m_pStream.clear();
+    m_pIODevice = NULL;
+
+    return t_bSuccess;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::setSyncInterval(qint32 p_iBuffers)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_iSyncInterval = p_iBuffers > 0 ? p_iBuffers : 0;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffRawWriter::buffersWritten()
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iBuffersWritten;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffRawWriter::stalls()
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iStalls;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffRawWriter::maxStallNs()
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iMaxStallNs;
+}
+
+
+//*************************************************************************************************************
+
+qint64 FiffRawWriter::totalStallNs()
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iTotalStallNs;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::run()
+{
+    while(true)
+    {
+        m_qMutex.lock();
+        while(m_iQueued == 0 && m_bOpen)
+            m_qSlotQueued.wait(&m_qMutex);
+
+        if(m_iQueued == 0)
+        {
+            // closed and drained
+            m_qMutex.unlock();
+            break;
+        }
+
+        qint32 t_iSlot = m_iHead;
+        qint32 t_iSyncInterval = m_iSyncInterval;
+        m_qMutex.unlock();
+
+        bool t_bSuccess = m_pStream->write_raw_buffer(m_qVecSlots[t_iSlot], m_vecCals) && m_pStream->status() == QDataStream::Ok;
+
+        m_qMutex.lock();
+        ++m_iBuffersWritten;
+        bool t_bSync = t_iSyncInterval > 0 && m_iBuffersWritten % t_iSyncInterval == 0;
+        m_qMutex.unlock();
+
+        if(t_bSync)
+            sync();
+
+        m_qMutex.lock();
+        if(!t_bSuccess)
+        {
+            printf("FiffRawWriter: writing raw buffer failed\n");
+            m_bError = true;
+        }
+        m_iHead = (m_iHead + 1) % m_qVecSlots.size();
+        --m_iQueued;
+        m_qSlotFree.wakeAll();
+        m_qMutex.unlock();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawWriter::sync()
+{
+    QFile* t_pFile = qobject_cast<QFile*>(m_pIODevice);
+    if(!t_pFile)
+        return;
+
+    t_pFile->flush();
+#ifdef Q_OS_WIN
+    _commit(t_pFile->handle());
+#else
+    fsync(t_pFile->handle());
+#endif
+}
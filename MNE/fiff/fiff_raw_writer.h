@@ -0,0 +1,231 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_writer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffRawWriter class declaration.
+*
+*/
+
+#ifndef FIFF_RAW_WRITER_H
+#define FIFF_RAW_WRITER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_info.h"
+#include "fiff_stream.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Writes raw buffers to a fiff file on a dedicated writer thread, so a slow disk does not stall the acquisition.
+* Buffers are copied into a fixed set of preallocated slots; the producer only waits when all slots are still
+* queued for writing. Such waits are measured and can be queried as back pressure statistics.
+*
+* @brief Asynchronous fiff raw data writer
+*/
+class FIFFSHARED_EXPORT FiffRawWriter : public QThread
+{
+    Q_OBJECT
+public:
+    typedef QSharedPointer<FiffRawWriter> SPtr;               /**< Shared pointer type for FiffRawWriter. */
+    typedef QSharedPointer<const FiffRawWriter> ConstSPtr;    /**< Const shared pointer type for FiffRawWriter. */
+
+    //=========================================================================================================
+    /**
+    * Creates the asynchronous raw writer.
+    *
+    * @param[in] p_iNumBuffers  Number of preallocated buffer slots; 2 for double, 3 for triple buffering
+    * @param[in] parent         Parent QObject (optional)
+    */
+    explicit FiffRawWriter(qint32 p_iNumBuffers = 3, QObject *parent = 0);
+
+    //=========================================================================================================
+    /**
+    * Destroys the writer; an open file is finished first.
+    */
+    ~FiffRawWriter();
+
+    //=========================================================================================================
+    /**
+    * Writes the measurement info via FiffStream::start_writing_raw, preallocates the slots and starts the
+    * writer thread.
+    *
+    * @param[in] p_IODevice     The IO device to write to, has to stay valid until close()
+    * @param[in] info           The measurement info
+    * @param[in] p_iNumSamples  Samples per buffer, used to preallocate the slots
+    * @param[in] sel            Which channels will be included in the output file (optional)
+    * @param[in] p_iFirstSample First sample of the recording; written as FIFF_FIRST_SAMPLE if > 0 (optional)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool open(QIODevice &p_IODevice, const FiffInfo& info, qint32 p_iNumSamples, MatrixXi sel = defaultMatrixXi, fiff_int_t p_iFirstSample = 0);
+
+    //=========================================================================================================
+    /**
+    * Queues a calibrated raw buffer, as returned by FiffRawData::read_raw_segment, for writing. The buffer is
+    * copied; the call only blocks while all slots are queued. Only a single producer thread may call write();
+    * close() may be called from another thread and waits for a copy in progress, so that buffer is written.
+    *
+    * @param[in] buf    The buffer to write, rows have to match the selected channels
+    *
+    * @return true if queued, false if the writer is not open, the size does not match or writing failed
+    */
+    bool write(const MatrixXd& buf);
+
+    //=========================================================================================================
+    /**
+    * Writes all queued buffers, stops the writer thread and finishes the file via
+    * FiffStream::finish_writing_raw.
+    *
+    * @return true if all buffers were written successfully, false otherwise
+    */
+    bool close();
+
+    //=========================================================================================================
+    /**
+    * Sets how often the file is flushed to the disk (fsync). 0, the default, leaves this to the system.
+    *
+    * @param[in] p_iBuffers     Number of buffers written between two syncs
+    */
+    void setSyncInterval(qint32 p_iBuffers);
+
+    //=========================================================================================================
+    /**
+    * Number of buffers written so far.
+    *
+    * @return the number of written buffers
+    */
+    qint64 buffersWritten();
+
+    //=========================================================================================================
+    /**
+    * Number of write() calls which had to wait for a free slot.
+    *
+    * @return the number of stalls
+    */
+    qint64 stalls();
+
+    //=========================================================================================================
+    /**
+    * Longest time a write() call waited for a free slot.
+    *
+    * @return the worst-case stall in nanoseconds
+    */
+    qint64 maxStallNs();
+
+    //=========================================================================================================
+    /**
+    * Accumulated time write() calls waited for a free slot.
+    *
+    * @return the total stall time in nanoseconds
+    */
+    qint64 totalStallNs();
+
+protected:
+    //=========================================================================================================
+    /**
+    * Writes the queued slots in order. Pure virtual method inherited by QThread.
+    */
+    virtual void run();
+
+private:
+    //=========================================================================================================
+    /**
+    * Flushes the IO device and, for files, the operating system cache.
+    */
+    void sync();
+
+    QIODevice*          m_pIODevice;        /**< The device written to. */
+    FiffStream::SPtr    m_pStream;          /**< The stream, used by the writer thread while open. */
+    RowVectorXd         m_vecCals;          /**< Calibration factors of the selected channels. */
+
+    QVector<MatrixXd>   m_qVecSlots;        /**< Preallocated buffer slots. */
+    qint32              m_iHead;            /**< Slot to be written next. */
+    qint32              m_iQueued;          /**< Number of queued slots. */
+
+    QMutex              m_qMutex;           /**< Guards the slot queue, state and statistics. */
+    QWaitCondition      m_qSlotQueued;      /**< Wakes the writer thread. */
+    QWaitCondition      m_qSlotFree;        /**< Wakes a producer waiting for a slot. */
+    bool                m_bOpen;            /**< Whether a file is open. */
+    bool                m_bError;           /**< Whether writing failed. */
+    bool                m_bWriting;         /**< Whether write() is copying into a slot outside the lock. */
+    QWaitCondition      m_qWriteDone;       /**< Wakes close() waiting for a copy in progress. */
+
+    qint32              m_iSyncInterval;    /**< Buffers between two syncs, 0 to disable. */
+    qint64              m_iBuffersWritten;  /**< Number of written buffers. */
+    qint64              m_iStalls;          /**< Number of producer waits. */
+    qint64              m_iMaxStallNs;      /**< Longest producer wait. */
+    qint64              m_iTotalStallNs;    /**< Accumulated producer wait. */
+};
+
+} // NAMESPACE
+
+#endif // FIFF_RAW_WRITER_H
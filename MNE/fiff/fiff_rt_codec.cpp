@@ -0,0 +1,475 @@
+//=============================================================================================================
+/**
+* @file     fiff_rt_codec.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+* @brief    Implementation of the FiffRtCodec Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_rt_codec.h"
+#include "fiff_constants.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static const qint32 TAG_HEADER_SIZE = 16;      /**< kind, type, size and next -> 4 * fiff_int_t */
+static const qint32 PAYLOAD_HEADER_SIZE = 16;  /**< method, nchan, nsamp and npicks -> 4 * fiff_int_t */
+static const qint32 RICE_K_BITS = 5;           /**< Bits of the per channel Rice parameter */
+static const qint32 RICE_MAX_K = 16;           /**< Largest Rice parameter */
+static const qint32 RICE_ESCAPE = 16;          /**< Unary length which escapes to a raw value */
+static const qint32 RICE_RAW_BITS = 17;        /**< Bits of an escaped zigzag coded difference of two shorts */
+static const qint32 MAX_EXPANSION = 4096;      /**< Largest number of decoded samples, including unpicked ones, per payload byte */
+
+static inline void putInt(uchar*& p_pDst, qint32 p_iVal)
+{
+    qToBigEndian<qint32>(p_iVal, p_pDst);
+    p_pDst += 4;
+}
+
+static inline void putFloat(uchar*& p_pDst, float p_fVal)
+{
+    quint32 t_iVal;
+    memcpy(&t_iVal, &p_fVal, sizeof(float));
+    qToBigEndian<quint32>(t_iVal, p_pDst);
+    p_pDst += 4;
+}
+
+static inline qint32 getInt(const uchar*& p_pSrc)
+{
+    qint32 t_iVal = qFromBigEndian<qint32>(p_pSrc);
+    p_pSrc += 4;
+    return t_iVal;
+}
+
+static inline float getFloat(const uchar*& p_pSrc)
+{
+    quint32 t_iVal = qFromBigEndian<quint32>(p_pSrc);
+    float t_fVal;
+    memcpy(&t_fVal, &t_iVal, sizeof(float));
+    p_pSrc += 4;
+    return t_fVal;
+}
+
+//=============================================================================================================
+/**
+* MSB first bit writer; the destination has to be large enough.
+*/
+class RiceWriter
+{
+public:
+    RiceWriter(uchar* p_pDst) : m_pDst(p_pDst), m_iBits(0), m_iNumBits(0) {}
+
+    inline void put(quint32 p_iVal, qint32 p_iNumBits)
+    {
+        m_iBits = (m_iBits << p_iNumBits) | (p_iVal & ((1ull << p_iNumBits) - 1));
+        m_iNumBits += p_iNumBits;
+        while(m_iNumBits >= 8)
+        {
+            m_iNumBits -= 8;
+            *m_pDst++ = (uchar)(m_iBits >> m_iNumBits);
+        }
+    }
+
+    inline void putValue(quint32 p_iVal, qint32 p_iK)
+    {
+        quint32 t_iQ = p_iVal >> p_iK;
+        if(t_iQ < (quint32)RICE_ESCAPE)
+        {
+            //unary quotient, terminating zero and remainder in one go (at most 15 + 1 + 16 bits)
+            quint32 t_iRem = p_iVal & ((1u << p_iK) - 1);
+            put((((1u << t_iQ) - 1) << (p_iK + 1)) | t_iRem, t_iQ + 1 + p_iK);
+        }
+        else
+        {
+            put((1u << RICE_ESCAPE) - 1, RICE_ESCAPE);
+            put(p_iVal, RICE_RAW_BITS);
+        }
+    }
+
+    inline uchar* finish()
+    {
+        if(m_iNumBits > 0)
+            *m_pDst++ = (uchar)(m_iBits << (8 - m_iNumBits));
+        m_iNumBits = 0;
+        return m_pDst;
+    }
+
+private:
+    uchar*  m_pDst;
+    quint64 m_iBits;
+    qint32  m_iNumBits;
+};
+
+//=============================================================================================================
+/**
+* MSB first bit reader with bounds checking.
+*/
+class RiceReader
+{
+public:
+    RiceReader(const uchar* p_pSrc, const uchar* p_pEnd) : m_pSrc(p_pSrc), m_pEnd(p_pEnd), m_iBits(0), m_iNumBits(0) {}
+
+    inline bool get(qint32 p_iNumBits, quint32& p_iVal)
+    {
+        while(m_iNumBits < p_iNumBits)
+        {
+            if(m_pSrc >= m_pEnd)
+                return false;
+            m_iBits = (m_iBits << 8) | *m_pSrc++;
+            m_iNumBits += 8;
+        }
+        m_iNumBits -= p_iNumBits;
+        p_iVal = (quint32)(m_iBits >> m_iNumBits) & (quint32)((1ull << p_iNumBits) - 1);
+        return true;
+    }
+
+    inline bool getValue(qint32 p_iK, quint32& p_iVal)
+    {
+        quint32 t_iQ = 0;
+        while(t_iQ < (quint32)RICE_ESCAPE)
+        {
+            if(m_iNumBits == 0)
+            {
+                if(m_pSrc >= m_pEnd)
+                    return false;
+                m_iBits = *m_pSrc++;
+                m_iNumBits = 8;
+            }
+            --m_iNumBits;
+            if(((m_iBits >> m_iNumBits) & 1) == 0)
+                break;
+            ++t_iQ;
+        }
+        if(t_iQ == (quint32)RICE_ESCAPE)
+            return get(RICE_RAW_BITS, p_iVal);
+
+        quint32 t_iR;
+        if(!get(p_iK, t_iR))
+            return false;
+        p_iVal = (t_iQ << p_iK) | t_iR;
+        return true;
+    }
+
+private:
+    const uchar*    m_pSrc;
+    const uchar*    m_pEnd;
+    quint64         m_iBits;
+    qint32          m_iNumBits;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+bool FiffRtCodec::parseMethod(const QString& p_sName, Method& p_method)
+{
+    if(p_sName.compare("float", Qt::CaseInsensitive) == 0)
+        p_method = Float;
+    else if(p_sName.compare("int16", Qt::CaseInsensitive) == 0)
+        p_method = Int16;
+    else if(p_sName.compare("delta", Qt::CaseInsensitive) == 0)
+        p_method = DeltaRice;
+    else
+        return false;
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRtCodec::encode(const MatrixXf& p_matData, Method p_method, const RowVectorXi& p_vecPicks, QByteArray& p_blockTag)
+{
+    qint32 nchan = (qint32)p_matData.rows();
+    qint32 nsamp = (qint32)p_matData.cols();
+
+    //
+    // Valid picks; all channels if none is valid
+    //
+    RowVectorXi picks(p_vecPicks.size());
+    qint32 npicks = 0;
+    for(qint32 i = 0; i < p_vecPicks.size(); ++i)
+        if(p_vecPicks[i] >= 0 && p_vecPicks[i] < nchan)
+            picks[npicks++] = p_vecPicks[i];
+
+    uchar* t_pDst;
+
+    if(npicks == 0 && p_method == Float)
+    {
+        //
+        // Full buffer as written by FiffStream::write_float
+        //
+        p_blockTag.resize(TAG_HEADER_SIZE + nchan*nsamp*4);
+        t_pDst = (uchar*)p_blockTag.data();
+        putInt(t_pDst, FIFF_DATA_BUFFER);
+        putInt(t_pDst, FIFFT_FLOAT);
+        putInt(t_pDst, nchan*nsamp*4);
+        putInt(t_pDst, FIFFV_NEXT_SEQ);
+        const float* t_pData = p_matData.data();
+        for(qint32 i = 0; i < nchan*nsamp; ++i)
+            putFloat(t_pDst, t_pData[i]);
+        return;
+    }
+
+    if(npicks == 0)
+    {
+        picks = RowVectorXi::LinSpaced(nchan, 0, nchan-1);
+        npicks = nchan;
+    }
+
+    //
+    // Per channel scale of the 16 bit methods
+    //
+    VectorXf scales = VectorXf::Ones(npicks);
+    if(p_method != Float)
+        for(qint32 i = 0; i < npicks; ++i)
+            scales[i] = nsamp > 0 ? p_matData.row(picks[i]).cwiseAbs().maxCoeff() / 32767.0f : 0.0f;
+
+    qint32 t_iSampleBytes;
+    switch(p_method)
+    {
+        case Float:     t_iSampleBytes = npicks*nsamp*4; break;
+        case Int16:     t_iSampleBytes = npicks*nsamp*2; break;
+        default:        t_iSampleBytes = (npicks*(RICE_K_BITS + nsamp*(RICE_ESCAPE + RICE_RAW_BITS)) + 7)/8; //worst case
+    }
+
+    qint32 t_iHeaderBytes = TAG_HEADER_SIZE + PAYLOAD_HEADER_SIZE + npicks*8;
+    p_blockTag.resize(t_iHeaderBytes + t_iSampleBytes);
+    t_pDst = (uchar*)p_blockTag.data() + TAG_HEADER_SIZE;
+
+    putInt(t_pDst, p_method);
+    putInt(t_pDst, nchan);
+    putInt(t_pDst, nsamp);
+    putInt(t_pDst, npicks);
+    for(qint32 i = 0; i < npicks; ++i)
+        putInt(t_pDst, picks[i]);
+    for(qint32 i = 0; i < npicks; ++i)
+        putFloat(t_pDst, scales[i]);
+
+    if(p_method == Float)
+    {
+        for(qint32 j = 0; j < nsamp; ++j)
+            for(qint32 i = 0; i < npicks; ++i)
+                putFloat(t_pDst, p_matData(picks[i], j));
+    }
+    else if(p_method == Int16)
+    {
+        VectorXf inv(npicks);
+        for(qint32 i = 0; i < npicks; ++i)
+            inv[i] = scales[i] > 0 ? 1.0f/scales[i] : 0.0f;
+
+        for(qint32 j = 0; j < nsamp; ++j)
+        {
+            for(qint32 i = 0; i < npicks; ++i)
+            {
+                qToBigEndian<qint16>((qint16)qRound(p_matData(picks[i], j)*inv[i]), t_pDst);
+                t_pDst += 2;
+            }
+        }
+    }
+    else
+    {
+        RiceWriter t_writer(t_pDst);
+        std::vector<quint32> t_vecZigZag(nsamp);
+        for(qint32 i = 0; i < npicks; ++i)
+        {
+            float inv = scales[i] > 0 ? 1.0f/scales[i] : 0.0f;
+
+            //
+            // Zigzag coded first order differences of the quantized samples
+            //
+            qint32 t_iPrev = 0;
+            quint64 t_iSum = 0;
+            for(qint32 j = 0; j < nsamp; ++j)
+            {
+                qint32 t_iVal = (qint16)qRound(p_matData(picks[i], j)*inv);
+                qint32 t_iDiff = t_iVal - t_iPrev;
+                t_iPrev = t_iVal;
+                t_vecZigZag[j] = (quint32)((t_iDiff << 1) ^ (t_iDiff >> 31));
+                t_iSum += t_vecZigZag[j];
+            }
+
+            //
+            // Rice parameter: largest k with 2^k not above the mean
+            //
+            qint32 k = 0;
+            while(k < RICE_MAX_K && ((quint64)nsamp << (k+1)) <= t_iSum)
+                ++k;
+
+            t_writer.put(k, RICE_K_BITS);
+            for(qint32 j = 0; j < nsamp; ++j)
+                t_writer.putValue(t_vecZigZag[j], k);
+        }
+        t_pDst = t_writer.finish();
+        p_blockTag.resize((qint32)(t_pDst - (uchar*)p_blockTag.data()));
+    }
+
+    t_pDst = (uchar*)p_blockTag.data();
+    putInt(t_pDst, FIFF_MNE_RT_DATA_BUFFER);
+    putInt(t_pDst, FIFFT_BYTE);
+    putInt(t_pDst, p_blockTag.size() - TAG_HEADER_SIZE);
+    putInt(t_pDst, FIFFV_NEXT_SEQ);
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRtCodec::decode(const char* p_pData, qint32 p_iSize, MatrixXf& p_matData)
+{
+    if(p_iSize < PAYLOAD_HEADER_SIZE)
+        return false;
+
+    const uchar* t_pSrc = (const uchar*)p_pData;
+    const uchar* t_pEnd = t_pSrc + p_iSize;
+
+    qint32 method = getInt(t_pSrc);
+    qint32 nchan = getInt(t_pSrc);
+    qint32 nsamp = getInt(t_pSrc);
+    qint32 npicks = getInt(t_pSrc);
+
+    if(method < Float || method > DeltaRice || nchan <= 0 || nsamp < 0 || npicks <= 0 || npicks > nchan)
+    {
+        printf("Error in FiffRtCodec::decode: invalid buffer header.\n");
+        return false;
+    }
+
+    //
+    // Sizes in 64 bit; a Rice coded sample takes at least its terminating bit
+    //
+    quint64 t_iSampleBits;
+    switch(method)
+    {
+        case Float:     t_iSampleBits = (quint64)npicks*nsamp*32; break;
+        case Int16:     t_iSampleBits = (quint64)npicks*nsamp*16; break;
+        default:        t_iSampleBits = (quint64)npicks*(RICE_K_BITS + (quint64)nsamp);
+    }
+    if((quint64)(t_pEnd - t_pSrc) < (quint64)npicks*8 + (t_iSampleBits + 7)/8)
+    {
+        printf("Error in FiffRtCodec::decode: buffer is truncated.\n");
+        return false;
+    }
+
+    if((quint64)nchan*nsamp > (quint64)p_iSize*MAX_EXPANSION)
+    {
+        printf("Error in FiffRtCodec::decode: %d x %d buffer exceeds its payload size.\n", nchan, nsamp);
+        return false;
+    }
+
+    RowVectorXi picks(npicks);
+    for(qint32 i = 0; i < npicks; ++i)
+    {
+        picks[i] = getInt(t_pSrc);
+        if(picks[i] < 0 || picks[i] >= nchan)
+        {
+            printf("Error in FiffRtCodec::decode: invalid channel %d.\n", picks[i]);
+            return false;
+        }
+    }
+    VectorXf scales(npicks);
+    for(qint32 i = 0; i < npicks; ++i)
+        scales[i] = getFloat(t_pSrc);
+
+    p_matData = MatrixXf::Zero(nchan, nsamp);
+
+    if(method == Float)
+    {
+        for(qint32 j = 0; j < nsamp; ++j)
+            for(qint32 i = 0; i < npicks; ++i)
+                p_matData(picks[i], j) = getFloat(t_pSrc);
+    }
+    else if(method == Int16)
+    {
+        for(qint32 j = 0; j < nsamp; ++j)
+        {
+            for(qint32 i = 0; i < npicks; ++i)
+            {
+                p_matData(picks[i], j) = qFromBigEndian<qint16>(t_pSrc) * scales[i];
+                t_pSrc += 2;
+            }
+        }
+    }
+    else
+    {
+        RiceReader t_reader(t_pSrc, t_pEnd);
+        for(qint32 i = 0; i < npicks; ++i)
+        {
+            quint32 k, t_iZigZag;
+            if(!t_reader.get(RICE_K_BITS, k) || k > (quint32)RICE_MAX_K)
+                return false;
+
+            qint32 t_iVal = 0;
+            for(qint32 j = 0; j < nsamp; ++j)
+            {
+                if(!t_reader.getValue(k, t_iZigZag))
+                {
+                    printf("Error in FiffRtCodec::decode: buffer is truncated.\n");
+                    return false;
+                }
+                t_iVal += (qint32)(t_iZigZag >> 1) ^ -(qint32)(t_iZigZag & 1);
+                p_matData(picks[i], j) = t_iVal * scales[i];
+            }
+        }
+    }
+
+    return true;
+}
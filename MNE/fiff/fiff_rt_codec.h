@@ -0,0 +1,145 @@
+//=============================================================================================================
+/**
+* @file     fiff_rt_codec.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+* @brief    FiffRtCodec class declaration.
+*
+*/
+
+#ifndef FIFF_RT_CODEC_H
+#define FIFF_RT_CODEC_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QByteArray>
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Encodes raw buffers for the real-time data port and decodes them again. Full precision buffers of all
+* channels are sent as FIFF_DATA_BUFFER tags exactly as FiffStream::write_float does; reduced precision and
+* channel subsets use a FIFF_MNE_RT_DATA_BUFFER tag whose payload describes itself (big endian):
+*
+*   method, nchan, nsamp, npicks (fiff_int_t each), picks (npicks x fiff_int_t), scales (npicks x float),
+*   followed by the samples of the picked channels:
+*   Float       npicks x nsamp floats
+*   Int16       npicks x nsamp shorts, sample = short * scale of its channel (cf. FIFFT_DAU_PACK16)
+*   DeltaRice   the Int16 samples of each channel as first order differences, Rice coded with a per channel
+*               parameter; lossless with respect to Int16
+*
+* @brief Real-time raw buffer encoding
+*/
+class FIFFSHARED_EXPORT FiffRtCodec
+{
+public:
+    //=========================================================================================================
+    /**
+    * Sample encodings
+    */
+    enum Method
+    {
+        Float = 0,      /**< 32 bit float, lossless */
+        Int16 = 1,      /**< 16 bit with per channel scale */
+        DeltaRice = 2   /**< 16 bit with per channel scale, delta and Rice coded */
+    };
+
+    //=========================================================================================================
+    /**
+    * Parses the method name ("float", "int16" or "delta").
+    *
+    * @param[in] p_sName    the method name
+    * @param[out] p_method  the parsed method
+    *
+    * @return true if the name is known
+    */
+    static bool parseMethod(const QString& p_sName, Method& p_method);
+
+    //=========================================================================================================
+    /**
+    * Encodes a raw buffer into a complete tag (header and payload).
+    *
+    * @param[in] p_matData      the raw buffer, channels x samples
+    * @param[in] p_method       the sample encoding
+    * @param[in] p_vecPicks     the channels to send; an empty vector sends all channels
+    * @param[out] p_blockTag    the encoded tag
+    */
+    static void encode(const MatrixXf& p_matData, Method p_method, const RowVectorXi& p_vecPicks, QByteArray& p_blockTag);
+
+    //=========================================================================================================
+    /**
+    * Decodes the payload of a FIFF_MNE_RT_DATA_BUFFER tag. Channels which were not picked are zero.
+    *
+    * @param[in] p_pData    the payload in stream byte order
+    * @param[in] p_iSize    the payload size in bytes
+    * @param[out] p_matData the decoded raw buffer, nchan x nsamp
+    *
+    * @return true if the payload was decoded successfully
+    */
+    static bool decode(const char* p_pData, qint32 p_iSize, MatrixXf& p_matData);
+};
+
+} // NAMESPACE
+
+#endif // FIFF_RT_CODEC_H
@@ -40,7 +40,9 @@
 
 #include "fiff_stream.h"
 #include "fiff_tag.h"
+#include "fiff_tag_view.h"
 #include "fiff_dir_tree.h"
+#include "fiff_dir_cache.h"
 #include "fiff_ctf_comp.h"
 #include "fiff_info.h"
 #include "fiff_info_base.h"
@@ -56,6 +58,7 @@
 //=============================================================================================================
 
 #include <QFile>
+#include <QtEndian>
 
 
 //*************************************************************************************************************
@@ -67,13 +70,77 @@ using namespace FIFFLIB;
 using namespace UTILSLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static const qint32 TAG_HEADER_SIZE = 16; /**< kind, type, size and next -> 4 * fiff_int_t */
+
+/**
+* Stores p_iNel values of type T big endian at p_pDst, W being the unsigned integer of the same width. A plain
+* swap loop without a per-element device write, which the compiler vectorizes.
+*/
+template<typename T, typename W> static inline void copyToBigEndian(const T* p_pSrc, qint64 p_iNel, uchar* p_pDst)
+{
+    W t_iWord;
+    for(qint64 i = 0; i < p_iNel; ++i)
+    {
+        memcpy(&t_iWord, p_pSrc + i, sizeof(W));
+        qToBigEndian<W>(t_iWord, p_pDst + i*sizeof(W));
+    }
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
+FiffStreamMapWatcher::FiffStreamMapWatcher(FiffStream* p_pStream)
+: QObject()
+, m_pStream(p_pStream)
+, m_pFile(NULL)
+{
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamMapWatcher::watch(QFile* p_pFile)
+{
+    release();
+
+    m_pFile = p_pFile;
+    connect(m_pFile, SIGNAL(aboutToClose()), this, SLOT(deviceAboutToClose()));
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamMapWatcher::release()
+{
+    if(m_pFile)
+        disconnect(m_pFile, SIGNAL(aboutToClose()), this, SLOT(deviceAboutToClose()));
+    m_pFile = NULL;
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamMapWatcher::deviceAboutToClose()
+{
+    m_pStream->unmap_file();
+}
+
+
+//*************************************************************************************************************
+
 FiffStream::FiffStream(QIODevice *p_pIODevice)
 : QDataStream(p_pIODevice)
+, m_pMappedData(NULL)
+, m_pMapWatcher(NULL)
+, m_iMappedSize(0)
 {
     this->setFloatingPointPrecision(QDataStream::SinglePrecision);
     this->setByteOrder(QDataStream::BigEndian);
@@ -85,6 +152,9 @@ FiffStream::FiffStream(QIODevice *p_pIODevice)
 
 FiffStream::FiffStream(QByteArray * a, QIODevice::OpenMode mode)
 : QDataStream(a, mode)
+, m_pMappedData(NULL)
+, m_pMapWatcher(NULL)
+, m_iMappedSize(0)
 {
     this->setFloatingPointPrecision(QDataStream::SinglePrecision);
     this->setByteOrder(QDataStream::BigEndian);
@@ -104,6 +174,9 @@ FiffStream::~FiffStream()
 //        printf("DEBUG: Closing FiffStream %s.\n\n", this->streamName().toUtf8().constData());
 //        this->device()->close();
 //    }
+
+    if(m_pMapWatcher)
+        delete m_pMapWatcher;
 }
 
 
@@ -196,6 +269,47 @@ bool FiffStream::get_evoked_entries(const QList<FiffDirTree> &evoked_node, QStri
 }
 
 
+//*************************************************************************************************************
+
+bool FiffStream::is_mapped() const
+{
+    return m_pMappedData != NULL && this->device() && this->device()->isOpen();
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStream::map_file()
+{
+    if(this->is_mapped())
+        return true;
+
+    QFile* t_pFile = qobject_cast<QFile*>(this->device());
+    if(!t_pFile)
+        return false;
+
+    if(!t_pFile->isOpen() && !t_pFile->open(QIODevice::ReadOnly))
+    {
+        printf("Cannot open %s\n", t_pFile->fileName().toUtf8().constData());
+        return false;
+    }
+
+    m_iMappedSize = t_pFile->size();
+    m_pMappedData = m_iMappedSize > 0 ? t_pFile->map(0, m_iMappedSize) : NULL;
+    if(!m_pMappedData)
+    {
+        m_iMappedSize = 0;
+        return false;
+    }
+
+    if(!m_pMapWatcher)
+        m_pMapWatcher = new FiffStreamMapWatcher(this);
+    m_pMapWatcher->watch(t_pFile);
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 bool FiffStream::open(FiffDirTree& p_Tree, QList<FiffDirEntry>& p_Dir)
@@ -209,7 +323,7 @@ bool FiffStream::open(FiffDirTree& p_Tree, QList<FiffDirEntry>& p_Dir)
     }
 
     FiffTag::SPtr t_pTag;
-    FiffTag::read_tag_info(this, t_pTag);
+    FiffTag::read_tag(this, t_pTag);
 
     if (t_pTag->kind != FIFF_FILE_ID)
     {
@@ -227,6 +341,7 @@ bool FiffStream::open(FiffDirTree& p_Tree, QList<FiffDirEntry>& p_Dir)
         printf("Fiff::open: file does not start with a file id tag");//consider throw
         return false;
     }
+    FiffId t_fileId = t_pTag->toFiffID();
 
     FiffTag::read_tag(this, t_pTag);
 
@@ -236,6 +351,17 @@ bool FiffStream::open(FiffDirTree& p_Tree, QList<FiffDirEntry>& p_Dir)
         return false;
     }
 
+    //
+    //   Reuse the directory of a previous open of the unchanged file
+    //
+    QFile* t_pFile = qobject_cast<QFile*>(this->device());
+    if (t_pFile && FiffDirCache::lookup(*t_pFile, t_fileId, p_Dir, p_Tree))
+    {
+        printf("\nUsing cached tag directory for %s\n", t_sFileName.toUtf8().constData());
+        this->device()->seek(0);
+        return true;
+    }
+
     //
     //   Read or create the directory tree
     //
@@ -270,6 +396,9 @@ bool FiffStream::open(FiffDirTree& p_Tree, QList<FiffDirEntry>& p_Dir)
 
     FiffDirTree::make_dir_tree(this, p_Dir, p_Tree);
 
+    if (t_pFile)
+        FiffDirCache::insert(*t_pFile, t_fileId, p_Dir, p_Tree);
+
     printf("[done]\n");
 
     //
@@ -1299,6 +1428,43 @@ QList<FiffProj> FiffStream::read_proj(const FiffDirTree& p_Node)
 
 //*************************************************************************************************************
 
+bool FiffStream::read_tag_view(qint64 pos, FiffTagView& p_TagView, QByteArray* p_pStaging)
+{
+    p_TagView = FiffTagView();
+    if(pos < 0)
+        return false;
+
+    if(this->is_mapped())
+    {
+        if(pos >= m_iMappedSize)
+            return false;
+        return p_TagView.setTag(m_pMappedData + pos, m_iMappedSize - pos);
+    }
+
+    if(!p_pStaging || !this->device()->seek(pos))
+        return false;
+
+    //
+    // Read header and payload as they are, i.e. without swapping
+    //
+    const qint32 t_iHeaderSize = 16;
+    p_pStaging->resize(t_iHeaderSize);
+    if(this->readRawData(p_pStaging->data(), t_iHeaderSize) != t_iHeaderSize)
+        return false;
+
+    qint32 size = qFromBigEndian<qint32>((const uchar*)p_pStaging->constData() + 8);
+    if(size < 0)
+        return false;
+
+    p_pStaging->resize(t_iHeaderSize + size);
+    if(size > 0 && this->readRawData(p_pStaging->data() + t_iHeaderSize, size) != size)
+        return false;
+
+    return p_TagView.setTag((const uchar*)p_pStaging->constData(), p_pStaging->size());
+}
+
+
+//*************************************************************************************************************
 bool FiffStream::setup_read_raw(QIODevice &p_IODevice, FiffRawData& data, bool allow_maxshield)
 {
     //
@@ -1711,6 +1877,22 @@ QString FiffStream::streamName()
 }
 
 
+//*************************************************************************************************************
+
+void FiffStream::unmap_file()
+{
+    QFile* t_pFile = qobject_cast<QFile*>(this->device());
+    if(t_pFile && m_pMappedData && t_pFile->isOpen())
+        t_pFile->unmap(m_pMappedData);
+
+    m_pMappedData = NULL;
+    m_iMappedSize = 0;
+
+    if(m_pMapWatcher)
+        m_pMapWatcher->release();
+}
+
+
 //*************************************************************************************************************
 
 void FiffStream::write_ch_info(FiffChInfo* ch)
@@ -1972,15 +2154,9 @@ void FiffStream::write_double(fiff_int_t kind, const double* data, fiff_int_t ne
 {
     qint32 datasize = nel * 8;
 
-    *this << (qint32)kind;
-    *this << (qint32)FIFFT_DOUBLE;
-    *this << (qint32)datasize;
-    *this << (qint32)FIFFV_NEXT_SEQ;
-
-//    this->setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-    for(qint32 i = 0; i < nel; ++i)
-        *this << data[i];
+    uchar* t_pData = begin_tag(kind, FIFFT_DOUBLE, datasize);
+    copyToBigEndian<double, quint64>(data, nel, t_pData);
+    end_tag();
 }
 
 
@@ -1990,15 +2166,9 @@ void FiffStream::write_float(fiff_int_t kind, const float* data, fiff_int_t nel)
 {
     qint32 datasize = nel * 4;
 
-    *this << (qint32)kind;
-    *this << (qint32)FIFFT_FLOAT;
-    *this << (qint32)datasize;
-    *this << (qint32)FIFFV_NEXT_SEQ;
-
-//    this->setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-    for(qint32 i = 0; i < nel; ++i)
-        *this << data[i];
+    uchar* t_pData = begin_tag(kind, FIFFT_FLOAT, datasize);
+    copyToBigEndian<float, quint32>(data, nel, t_pData);
+    end_tag();
 }
 
 
@@ -2013,22 +2183,16 @@ void FiffStream::write_float_matrix(fiff_int_t kind, const MatrixXf& mat)
 
     fiff_int_t datasize = 4*numel + 4*3;
 
-    *this << (qint32)kind;
-    *this << (qint32)FIFFT_MATRIX_FLOAT;
-    *this << (qint32)datasize;
-    *this << (qint32)FIFFV_NEXT_SEQ;
-
-    qint32 i;
-    for(i = 0; i < numel; ++i)
-        *this << mat.data()[i];
+    uchar* t_pData = begin_tag(kind, FIFFT_MATRIX_FLOAT, datasize);
+    copyToBigEndian<float, quint32>(mat.data(), numel, t_pData);
 
     qint32 dims[3];
     dims[0] = mat.cols();
     dims[1] = mat.rows();
     dims[2] = 2;
 
-    for(i = 0; i < 3; ++i)
-        *this << dims[i];
+    copyToBigEndian<qint32, quint32>(dims, 3, t_pData + 4*numel);
+    end_tag();
 }
 
 
@@ -2338,13 +2502,9 @@ void FiffStream::write_int(fiff_int_t kind, const fiff_int_t* data, fiff_int_t n
 {
     fiff_int_t datasize = nel * 4;
 
-    *this << (qint32)kind;
-    *this << (qint32)FIFFT_INT;
-    *this << (qint32)datasize;
-    *this << (qint32)FIFFV_NEXT_SEQ;
-
-    for(qint32 i = 0; i < nel; ++i)
-        *this << data[i];
+    uchar* t_pData = begin_tag(kind, FIFFT_INT, datasize);
+    copyToBigEndian<qint32, quint32>(data, nel, t_pData);
+    end_tag();
 }
 
 
@@ -2359,22 +2519,16 @@ void FiffStream::write_int_matrix(fiff_int_t kind, const MatrixXi& mat)
 
     fiff_int_t datasize = 4*numel + 4*3;
 
-    *this << (qint32)kind;
-    *this << (qint32)FIFFT_MATRIX_INT;
-    *this << (qint32)datasize;
-    *this << (qint32)FIFFV_NEXT_SEQ;
-
-    qint32 i;
-    for(i = 0; i < numel; ++i)
-        *this << mat.data()[i];
+    uchar* t_pData = begin_tag(kind, FIFFT_MATRIX_INT, datasize);
+    copyToBigEndian<qint32, quint32>(mat.data(), numel, t_pData);
 
     qint32 dims[3];
     dims[0] = mat.cols();
     dims[1] = mat.rows();
     dims[2] = 2;
 
-    for(i = 0; i < 3; ++i)
-        *this << dims[i];
+    copyToBigEndian<qint32, quint32>(dims, 3, t_pData + 4*numel);
+    end_tag();
 }
 
 
@@ -2445,17 +2599,24 @@ bool FiffStream::write_raw_buffer(const MatrixXd& buf, const RowVectorXd& cals)
         return false;
     }
 
-    typedef Eigen::Triplet<double> T;
-    std::vector<T> tripletList;
-    tripletList.reserve(cals.cols());
-    for(qint32 i = 0; i < cals.cols(); ++i)
-        tripletList.push_back(T(i, i, 1.0/cals[i]));
+    const qint32 nchan = buf.rows();
+    const qint32 nsamp = buf.cols();
 
-    SparseMatrix<double> inv_calsMat(cals.cols(), cals.cols());
-    inv_calsMat.setFromTriplets(tripletList.begin(), tripletList.end());
+    //
+    //  Each sample is calibrated and converted by Eigen into a small column, which is swapped straight into
+    //  the tag
+    //
+    VectorXd t_vecInvCals = cals.transpose().cwiseInverse();
+    VectorXf t_vecColumn(nchan);
+
+    uchar* t_pData = begin_tag(FIFF_DATA_BUFFER, FIFFT_FLOAT, 4*nchan*nsamp);
+    for(qint32 j = 0; j < nsamp; ++j)
+    {
+        t_vecColumn = buf.col(j).cwiseProduct(t_vecInvCals).cast<float>();
+        copyToBigEndian<float, quint32>(t_vecColumn.data(), nchan, t_pData + (qint64)4*j*nchan);
+    }
+    end_tag();
 
-    MatrixXf tmp = (inv_calsMat*buf).cast<float>();
-    this->write_float(FIFF_DATA_BUFFER,tmp.data(),tmp.rows()*tmp.cols());
     return true;
 }
 
@@ -2487,3 +2648,27 @@ void FiffStream::write_rt_command(fiff_int_t command, const QString& data)
 
     this->writeRawData(data.toUtf8().constData(),datasize);
 }
+
+
+//*************************************************************************************************************
+
+uchar* FiffStream::begin_tag(fiff_int_t kind, fiff_int_t type, fiff_int_t datasize)
+{
+    m_baTagStaging.resize(TAG_HEADER_SIZE + datasize);
+
+    uchar* t_pTag = (uchar*)m_baTagStaging.data();
+    qToBigEndian<qint32>(kind, t_pTag);
+    qToBigEndian<qint32>(type, t_pTag + 4);
+    qToBigEndian<qint32>(datasize, t_pTag + 8);
+    qToBigEndian<qint32>(FIFFV_NEXT_SEQ, t_pTag + 12);
+
+    return t_pTag + TAG_HEADER_SIZE;
+}
+
+
+//*************************************************************************************************************
+
+void FiffStream::end_tag()
+{
+    this->writeRawData(m_baTagStaging.constData(), m_baTagStaging.size());
+}
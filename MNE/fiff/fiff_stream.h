@@ -81,6 +81,7 @@
 #include <QFile>
 #include <QIODevice>
 #include <QList>
+#include <QObject>
 #include <QSharedPointer>
 #include <QString>
 #include <QStringList>
@@ -101,6 +102,7 @@ namespace FIFFLIB
 
 class FiffStream;
 class FiffTag;
+class FiffTagView;
 class FiffCtfComp;
 class FiffRawData;
 class FiffInfo;
@@ -119,6 +121,53 @@ static FiffId defaultFiffId;
 using namespace Eigen;
 
 
+//=============================================================================================================
+/**
+* Releases the memory mapping of a FiffStream as soon as the mapped file is about to be closed, so that a
+* reopened file is never read through a stale mapping.
+*
+* @brief Watches the mapped file of a FiffStream
+**/
+
+class FiffStreamMapWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    //=========================================================================================================
+    /**
+    * Constructs a watcher for the given stream.
+    *
+    * @param[in] p_pStream  The stream whose mapping is released
+    */
+    explicit FiffStreamMapWatcher(FiffStream* p_pStream);
+
+    //=========================================================================================================
+    /**
+    * Watches the given file instead of the previously watched one.
+    *
+    * @param[in] p_pFile    The mapped file
+    */
+    void watch(QFile* p_pFile);
+
+    //=========================================================================================================
+    /**
+    * Stops watching the file.
+    */
+    void release();
+
+private slots:
+    //=========================================================================================================
+    /**
+    * Releases the mapping of the stream; connected to QIODevice::aboutToClose of the watched file.
+    */
+    void deviceAboutToClose();
+
+private:
+    FiffStream* m_pStream;  /**< The stream whose mapping is released. */
+    QFile*      m_pFile;    /**< The watched file, NULL if none. */
+};
+
+
 //=============================================================================================================
 /**
 * FiffStream provides an interface for reading from and writing to fiff files
@@ -196,6 +245,24 @@ public:
     */
     bool get_evoked_entries(const QList<FiffDirTree> &evoked_node, QStringList &comments, QList<fiff_int_t> &aspect_kinds, QString &t);
 
+    //=========================================================================================================
+    /**
+    * True if the underlying file is memory mapped, i.e. if tags can be accessed through read_tag_view.
+    *
+    * @return true if the stream is memory mapped
+    */
+    bool is_mapped() const;
+
+    //=========================================================================================================
+    /**
+    * Maps the whole underlying file read-only into memory. The device is opened when it is not open yet.
+    * The mapping is released by unmap_file or when the device gets closed.
+    * Works only for QFile devices; sockets and buffers keep using the regular stream reads.
+    *
+    * @return true if the file is mapped, false otherwise
+    */
+    bool map_file();
+
     //=========================================================================================================
     /**
     * QFile::open
@@ -328,6 +395,22 @@ public:
     */
     QList<FiffProj> read_proj(const FiffDirTree& p_Node);
 
+    //=========================================================================================================
+    /**
+    * Zero-copy counterpart of FiffTag::read_tag: sets up a view of the tag located at pos inside the mapped
+    * file. No memory is allocated and the payload is not swapped (see FiffTagView).
+    * If the stream is not mapped and a staging buffer is provided, the raw tag is read into the staging buffer
+    * and the view points there. Reusing the staging buffer across calls avoids a per-tag allocation, but it
+    * invalidates the previous view; a view into the mapping stays valid until the file is unmapped.
+    *
+    * @param[in] pos            position of the tag inside the fif file
+    * @param[out] p_TagView     the tag view
+    * @param[in] p_pStaging     staging buffer for unmapped streams (optional)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool read_tag_view(qint64 pos, FiffTagView& p_TagView, QByteArray* p_pStaging = NULL);
+
     //=========================================================================================================
     /**
     * fiff_setup_read_raw
@@ -411,6 +494,12 @@ public:
     */
     QString streamName();
 
+    //=========================================================================================================
+    /**
+    * Releases the memory mapping established by map_file. Tag views become invalid.
+    */
+    void unmap_file();
+
     //=========================================================================================================
     /**
     * fiff_write_ch_info
@@ -633,7 +722,8 @@ public:
     *
     * ### MNE toolbox root function ###
     *
-    * Writes a raw buffer.
+    * Writes a raw buffer. Calibration, conversion to float and byte swapping are done in one pass per sample
+    * straight into the tag staging buffer.
     *
     * @param[in] buf        the buffer to write
     * @param[in] cals       calibration factors
@@ -663,6 +753,30 @@ public:
     * @param[in] data       The string data to write
     */
     void write_rt_command(fiff_int_t command, const QString& data);
+
+private:
+    //=========================================================================================================
+    /**
+    * Starts a tag in the staging buffer: stores the big endian tag header and reserves the payload.
+    *
+    * @param[in] kind       The tag kind
+    * @param[in] type       The tag type
+    * @param[in] datasize   The payload size in bytes
+    *
+    * @return pointer to the payload in the staging buffer, to be filled big endian
+    */
+    uchar* begin_tag(fiff_int_t kind, fiff_int_t type, fiff_int_t datasize);
+
+    //=========================================================================================================
+    /**
+    * Writes the tag started by begin_tag with a single device write.
+    */
+    void end_tag();
+
+    uchar*  m_pMappedData;  /**< Start of the memory mapped file, NULL if not mapped. */
+    FiffStreamMapWatcher* m_pMapWatcher;   /**< Releases the mapping when the file gets closed, NULL until mapped. */
+    qint64  m_iMappedSize;  /**< Size of the mapped region in bytes. */
+    QByteArray m_baTagStaging;  /**< Reused staging buffer of the tag being written. */
 };
 
 } // NAMESPACE
@@ -0,0 +1,361 @@
+//=============================================================================================================
+/**
+* @file     fiff_tag_view.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the FiffTagView Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_tag_view.h"
+#include "fiff_constants.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <string.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static const qint64 TAG_HEADER_SIZE = 16; /**< kind, type, size and next -> 4 * fiff_int_t */
+
+static inline float floatFromBigEndian(const uchar* p_pSrc)
+{
+    quint32 t_iVal = qFromBigEndian<quint32>(p_pSrc);
+    float t_fVal;
+    memcpy(&t_fVal, &t_iVal, sizeof(float));
+    return t_fVal;
+}
+
+template<typename T> static inline T valueFromBigEndian(const uchar* p_pSrc)
+{
+    return qFromBigEndian<T>(p_pSrc);
+}
+
+template<> inline float valueFromBigEndian<float>(const uchar* p_pSrc)
+{
+    return floatFromBigEndian(p_pSrc);
+}
+
+
+//*************************************************************************************************************
+/**
+* Decodes p_iNSamp columns of a big endian nchan x nsamp buffer of type T. The swap loop runs over one sample
+* (all channels) into a small, cache resident column which is then converted and calibrated by Eigen's
+* vectorized coefficient-wise product straight into the destination.
+*/
+template<typename T> static void decodeCalibrated(const uchar* p_pSrc, const RowVectorXd& p_vecCals, qint32 p_iNSamp, double* p_pDst)
+{
+    const qint32 nchan = p_vecCals.size();
+    const qint64 stride = (qint64)nchan*sizeof(T);
+    Matrix<T, Dynamic, 1> t_vecColumn(nchan);
+    T* t_pColumn = t_vecColumn.data();
+
+    for(qint32 j = 0; j < p_iNSamp; ++j)
+    {
+        const uchar* t_pSrc = p_pSrc + j*stride;
+        for(qint32 c = 0; c < nchan; ++c)
+            t_pColumn[c] = valueFromBigEndian<T>(t_pSrc + c*sizeof(T));
+
+        Map<VectorXd>(p_pDst + (qint64)j*nchan, nchan) = t_vecColumn.template cast<double>().cwiseProduct(p_vecCals.transpose());
+    }
+}
+
+
+//*************************************************************************************************************
+/**
+* Gathering counterpart of decodeCalibrated: reads only the selected channels of each sample.
+*/
+template<typename T> static void decodeCalibratedGather(const uchar* p_pSrc, qint32 p_iNChan, const RowVectorXi& p_vecSel, const RowVectorXd& p_vecSelCals, qint32 p_iNSamp, double* p_pDst)
+{
+    const qint32 nsel = p_vecSel.size();
+    const qint64 stride = (qint64)p_iNChan*sizeof(T);
+    const int* t_pSel = p_vecSel.data();
+    Matrix<T, Dynamic, 1> t_vecColumn(nsel);
+    T* t_pColumn = t_vecColumn.data();
+
+    for(qint32 j = 0; j < p_iNSamp; ++j)
+    {
+        const uchar* t_pSrc = p_pSrc + j*stride;
+        for(qint32 r = 0; r < nsel; ++r)
+            t_pColumn[r] = valueFromBigEndian<T>(t_pSrc + t_pSel[r]*sizeof(T));
+
+        Map<VectorXd>(p_pDst + (qint64)j*nsel, nsel) = t_vecColumn.template cast<double>().cwiseProduct(p_vecSelCals.transpose());
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffTagView::FiffTagView()
+: kind(-1)
+, type(-1)
+, size(0)
+, next(0)
+, data(NULL)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+FiffTagView::~FiffTagView()
+{
+
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::setTag(const uchar* p_pTag, qint64 p_iAvail)
+{
+    data = NULL;
+    if(p_pTag == NULL || p_iAvail < TAG_HEADER_SIZE)
+        return false;
+
+    kind = qFromBigEndian<qint32>(p_pTag);
+    type = qFromBigEndian<qint32>(p_pTag + 4);
+    size = qFromBigEndian<qint32>(p_pTag + 8);
+    next = qFromBigEndian<qint32>(p_pTag + 12);
+
+    if(size < 0 || TAG_HEADER_SIZE + size > p_iAvail)
+        return false;
+
+    data = p_pTag + TAG_HEADER_SIZE;
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::isMatrix() const
+{
+    return (type & FIFFTS_FS_MASK) == FIFFTS_FS_MATRIX;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::getMatrixDimensions(qint32& p_ndim, QVector<qint32>& p_Dims) const
+{
+    p_Dims.clear();
+    p_ndim = 0;
+    if(!this->isMatrix() || data == NULL || size < 4 || (type & FIFFTS_MC_MASK) != FIFFTS_MC_DENSE)
+        return false;
+
+    //
+    // The number of dimensions is stored last, preceded by the dimensions themselves
+    //
+    p_ndim = qFromBigEndian<qint32>(data + size - 4);
+    if(p_ndim <= 0 || size < 4*(p_ndim+1))
+        return false;
+
+    for(qint32 i = p_ndim+1; i > 1; --i)
+        p_Dims.append(qFromBigEndian<qint32>(data + size - i*4));
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::toDoubleMatrix(MatrixXd& p_Mat, qint32 p_iRows, qint32 p_iCols) const
+{
+    if(data == NULL)
+        return false;
+
+    qint64 numel = (qint64)p_iRows*p_iCols;
+    p_Mat.resize(p_iRows, p_iCols);
+    double* t_pDst = p_Mat.data();
+    qint64 i;
+
+    switch(type)
+    {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            if(size < numel*2)
+                return false;
+            for(i = 0; i < numel; ++i)
+                t_pDst[i] = qFromBigEndian<qint16>(data + 2*i);
+            return true;
+        case FIFFT_INT:
+            if(size < numel*4)
+                return false;
+            for(i = 0; i < numel; ++i)
+                t_pDst[i] = qFromBigEndian<qint32>(data + 4*i);
+            return true;
+        case FIFFT_FLOAT:
+            if(size < numel*4)
+                return false;
+            for(i = 0; i < numel; ++i)
+                t_pDst[i] = floatFromBigEndian(data + 4*i);
+            return true;
+        default:
+            printf("FiffTagView: Data storage format not known yet!! Type: %d\n", type);
+            return false;
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::toFloatMatrix(MatrixXd& p_Mat) const
+{
+    if((type & FIFFTS_BASE_MASK) != FIFFT_FLOAT)
+        return false;
+
+    qint32 ndim;
+    QVector<qint32> dims;
+    if(!this->getMatrixDimensions(ndim, dims))
+        return false;
+
+    if (ndim != 2)
+    {
+        printf("Only two-dimensional matrices are supported at this time");
+        return false;
+    }
+
+    qint64 numel = (qint64)dims[0]*dims[1];
+    if(size < 4*(numel + 3))
+        return false;
+
+    p_Mat.resize(dims[0], dims[1]);
+    double* t_pDst = p_Mat.data();
+    for(qint64 i = 0; i < numel; ++i)
+        t_pDst[i] = floatFromBigEndian(data + 4*i);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::toCalibratedMatrix(const RowVectorXd& p_vecCals, qint32 p_iFirst, qint32 p_iNSamp, MatrixXd& p_Dst, qint32 p_iDstCol) const
+{
+    const qint32 nchan = p_vecCals.size();
+    if(data == NULL || p_Dst.rows() != nchan || p_iDstCol + p_iNSamp > p_Dst.cols() || p_iFirst < 0)
+        return false;
+
+    double* t_pDst = p_Dst.data() + (qint64)p_iDstCol*nchan;
+
+    switch(type)
+    {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            if(size < (qint64)(p_iFirst + p_iNSamp)*nchan*2)
+                return false;
+            decodeCalibrated<qint16>(data + (qint64)p_iFirst*nchan*2, p_vecCals, p_iNSamp, t_pDst);
+            return true;
+        case FIFFT_INT:
+            if(size < (qint64)(p_iFirst + p_iNSamp)*nchan*4)
+                return false;
+            decodeCalibrated<qint32>(data + (qint64)p_iFirst*nchan*4, p_vecCals, p_iNSamp, t_pDst);
+            return true;
+        case FIFFT_FLOAT:
+            if(size < (qint64)(p_iFirst + p_iNSamp)*nchan*4)
+                return false;
+            decodeCalibrated<float>(data + (qint64)p_iFirst*nchan*4, p_vecCals, p_iNSamp, t_pDst);
+            return true;
+        default:
+            printf("FiffTagView: Data storage format not known yet!! Type: %d\n", type);
+            return false;
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool FiffTagView::toCalibratedMatrix(qint32 p_iNChan, const RowVectorXi& p_vecSel, const RowVectorXd& p_vecSelCals, qint32 p_iFirst, qint32 p_iNSamp, MatrixXd& p_Dst, qint32 p_iDstCol) const
+{
+    const qint32 nsel = p_vecSel.size();
+    if(data == NULL || nsel != p_vecSelCals.size() || p_Dst.rows() != nsel || p_iDstCol + p_iNSamp > p_Dst.cols() || p_iFirst < 0)
+        return false;
+
+    for(qint32 r = 0; r < nsel; ++r)
+        if(p_vecSel[r] < 0 || p_vecSel[r] >= p_iNChan)
+            return false;
+
+    double* t_pDst = p_Dst.data() + (qint64)p_iDstCol*nsel;
+
+    switch(type)
+    {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            if(size < (qint64)(p_iFirst + p_iNSamp)*p_iNChan*2)
+                return false;
+            decodeCalibratedGather<qint16>(data + (qint64)p_iFirst*p_iNChan*2, p_iNChan, p_vecSel, p_vecSelCals, p_iNSamp, t_pDst);
+            return true;
+        case FIFFT_INT:
+            if(size < (qint64)(p_iFirst + p_iNSamp)*p_iNChan*4)
+                return false;
+            decodeCalibratedGather<qint32>(data + (qint64)p_iFirst*p_iNChan*4, p_iNChan, p_vecSel, p_vecSelCals, p_iNSamp, t_pDst);
+            return true;
+        case FIFFT_FLOAT:
+            if(size < (qint64)(p_iFirst + p_iNSamp)*p_iNChan*4)
+                return false;
+            decodeCalibratedGather<float>(data + (qint64)p_iFirst*p_iNChan*4, p_iNChan, p_vecSel, p_vecSelCals, p_iNSamp, t_pDst);
+            return true;
+        default:
+            printf("FiffTagView: Data storage format not known yet!! Type: %d\n", type);
+            return false;
+    }
+}
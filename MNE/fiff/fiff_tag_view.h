@@ -0,0 +1,228 @@
+//=============================================================================================================
+/**
+* @file     fiff_tag_view.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffTagView class declaration.
+*
+*/
+
+#ifndef FIFF_TAG_VIEW_H
+#define FIFF_TAG_VIEW_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* A tag view is the zero-copy counterpart of FiffTag. It does not own any data, it points into a memory mapped
+* fiff file (see FiffStream::map_file) or, when the file is not mapped, into the staging buffer passed to
+* FiffStream::read_tag_view. The payload stays in file byte order (big endian); swapping is done while
+* converting it into the consumer's data type. A view into the mapping is valid until the file is unmapped, a
+* view into the staging buffer only until the next read_tag_view call with that buffer.
+*
+* @brief Zero-copy view of a FIFF tag in a memory mapped file or a staging buffer
+*/
+class FIFFSHARED_EXPORT FiffTagView
+{
+public:
+    typedef QSharedPointer<FiffTagView> SPtr;            /**< Shared pointer type for FiffTagView. */
+    typedef QSharedPointer<const FiffTagView> ConstSPtr; /**< Const shared pointer type for FiffTagView. */
+
+    //=========================================================================================================
+    /**
+    * Default constructor, creates an empty view.
+    */
+    FiffTagView();
+
+    //=========================================================================================================
+    /**
+    * Destroys the tag view. The viewed data are not touched.
+    */
+    ~FiffTagView();
+
+    //=========================================================================================================
+    /**
+    * Parses the tag header located at p_pTag and sets the view to the following payload.
+    *
+    * @param[in] p_pTag     pointer to the tag header (big endian)
+    * @param[in] p_iAvail   number of bytes available starting at p_pTag
+    *
+    * @return true if the complete tag lies within the available bytes, false otherwise
+    */
+    bool setTag(const uchar* p_pTag, qint64 p_iAvail);
+
+    //=========================================================================================================
+    /**
+    * True if the view does not point to any data.
+    *
+    * @return true if view is empty
+    */
+    inline bool isEmpty() const;
+
+    //=========================================================================================================
+    /**
+    * Provides information if tag contains a matrix
+    *
+    * @return true if tag contains a matrix
+    */
+    bool isMatrix() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the dimensions of a dense matrix tag
+    *
+    * @param[out] p_ndim    number of dimensions
+    * @param[out] p_Dims    vector containing the size of each dimension
+    *
+    * @return true if dimensions are available
+    */
+    bool getMatrixDimensions(qint32& p_ndim, QVector<qint32>& p_Dims) const;
+
+    //=========================================================================================================
+    /**
+    * Converts the payload of a raw data buffer (FIFFT_DAU_PACK16, FIFFT_SHORT, FIFFT_INT or FIFFT_FLOAT)
+    * into a p_iRows x p_iCols double matrix. The byte swap is fused into the conversion, i.e. the payload is
+    * touched exactly once.
+    *
+    * @param[out] p_Mat     the converted data
+    * @param[in] p_iRows    number of rows (channels)
+    * @param[in] p_iCols    number of columns (samples)
+    *
+    * @return true if succeeded, false if type or size do not match
+    */
+    bool toDoubleMatrix(MatrixXd& p_Mat, qint32 p_iRows, qint32 p_iCols) const;
+
+    //=========================================================================================================
+    /**
+    * Converts a dense two-dimensional FIFFT_FLOAT matrix tag to a double matrix. The orientation is the same as
+    * the one of FiffTag::toFloatMatrix.
+    *
+    * @param[out] p_Mat     the converted matrix
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool toFloatMatrix(MatrixXd& p_Mat) const;
+
+    //=========================================================================================================
+    /**
+    * Fused raw buffer decoding kernel. Byte swap, conversion to double and per-channel calibration of a
+    * FIFFT_DAU_PACK16, FIFFT_SHORT, FIFFT_INT or FIFFT_FLOAT data buffer are done in a single pass over the
+    * payload. Only the samples [p_iFirst, p_iFirst + p_iNSamp) are decoded and written to the columns
+    * [p_iDstCol, p_iDstCol + p_iNSamp) of p_Dst, which needs to have p_vecCals.size() rows.
+    *
+    * @param[in] p_vecCals      calibration factors, one per channel of the buffer
+    * @param[in] p_iFirst       first sample of the buffer to decode
+    * @param[in] p_iNSamp       number of samples to decode
+    * @param[out] p_Dst         destination matrix (channels x samples)
+    * @param[in] p_iDstCol      first destination column
+    *
+    * @return true if succeeded, false if type or size do not match
+    */
+    bool toCalibratedMatrix(const RowVectorXd& p_vecCals, qint32 p_iFirst, qint32 p_iNSamp, MatrixXd& p_Dst, qint32 p_iDstCol = 0) const;
+
+    //=========================================================================================================
+    /**
+    * Gathering variant of the fused raw buffer decoding kernel: only the channels listed in p_vecSel are
+    * decoded, so the work scales with p_vecSel.size() instead of the number of channels in the buffer.
+    * Row r of p_Dst receives channel p_vecSel[r], calibrated with p_vecSelCals[r].
+    *
+    * @param[in] p_iNChan       number of channels in the buffer
+    * @param[in] p_vecSel       channel selection
+    * @param[in] p_vecSelCals   calibration factors of the selected channels
+    * @param[in] p_iFirst       first sample of the buffer to decode
+    * @param[in] p_iNSamp       number of samples to decode
+    * @param[out] p_Dst         destination matrix (selected channels x samples)
+    * @param[in] p_iDstCol      first destination column
+    *
+    * @return true if succeeded, false if type or size do not match
+    */
+    bool toCalibratedMatrix(qint32 p_iNChan, const RowVectorXi& p_vecSel, const RowVectorXd& p_vecSelCals, qint32 p_iFirst, qint32 p_iNSamp, MatrixXd& p_Dst, qint32 p_iDstCol = 0) const;
+
+public:
+    fiff_int_t  kind;       /**< Tag number. */
+    fiff_int_t  type;       /**< Data type. */
+    fiff_int_t  size;       /**< Size of the data in bytes. */
+    fiff_int_t  next;       /**< Pointer to the next object. */
+    const uchar* data;      /**< Points to the big endian payload inside the mapped file or the staging buffer. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool FiffTagView::isEmpty() const
+{
+    return data == NULL;
+}
+
+} // NAMESPACE
+
+#endif // FIFF_TAG_VIEW_H
@@ -0,0 +1,417 @@
+//=============================================================================================================
+/**
+* @file     broadcastmatrixbuffer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     BroadcastMatrixBuffer class declaration
+*
+*/
+
+#ifndef BROADCASTMATRIXBUFFER_H
+#define BROADCASTMATRIXBUFFER_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "generics_global.h"
+#include "buffer.h"
+
+#include <typeinfo>
+#include <climits>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE IOBuffer
+//=============================================================================================================
+
+namespace IOBuffer
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Broadcast Matrix buffer passes the matrices of one producer to any number of consumers. Matrices are stored as
+* shared, immutable blocks; every consumer attaches as a reader with its own cursor and receives each block
+* published after it attached, without the block being copied per consumer.
+*
+* The producer never blocks. A reader which falls a whole buffer length behind loses its oldest blocks; they are
+* counted and can be polled with dropped().
+*
+* @brief The Broadcast Matrix buffer provides a template for single writer, multiple reader matrix buffers.
+*/
+template<typename _Tp>
+class BroadcastMatrixBuffer : public Buffer
+{
+public:
+    typedef QSharedPointer<BroadcastMatrixBuffer> SPtr;              /**< Shared pointer type for BroadcastMatrixBuffer. */
+    typedef QSharedPointer<const BroadcastMatrixBuffer> ConstSPtr;   /**< Const shared pointer type for BroadcastMatrixBuffer. */
+
+    typedef QSharedPointer<const Matrix<_Tp, Dynamic, Dynamic> > Block;  /**< Shared immutable block. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a BroadcastMatrixBuffer.
+    *
+    * @param [in] uiMaxNumBlocks    Number of blocks a reader can fall behind before it loses blocks.
+    */
+    explicit BroadcastMatrixBuffer(unsigned int uiMaxNumBlocks);
+
+    //=========================================================================================================
+    /**
+    * Destroys the BroadcastMatrixBuffer.
+    */
+    ~BroadcastMatrixBuffer();
+
+    //=========================================================================================================
+    /**
+    * Attaches a new reader. The reader receives all blocks pushed after this call.
+    *
+    * @return the reader id to pass to pop().
+    */
+    int attach();
+
+    //=========================================================================================================
+    /**
+    * Detaches a reader and wakes it if it waits in pop(). The id may be handed out again by attach().
+    *
+    * @param [in] iReader   the reader to detach.
+    */
+    void detach(int iReader);
+
+    //=========================================================================================================
+    /**
+    * Publishes a block to all attached readers. The block is shared, not copied.
+    *
+    * @param [in] p_block   the block to publish; it must not be modified afterwards.
+    */
+    inline void push(const Block& p_block);
+
+    //=========================================================================================================
+    /**
+    * Publishes a copy of the given matrix to all attached readers; the matrix is copied once, regardless of
+    * the number of readers.
+    *
+    * @param [in] pMatrix pointer to the matrix to publish.
+    */
+    inline void push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix);
+
+    //=========================================================================================================
+    /**
+    * Returns the next block of the given reader (first in first out). Blocks until a block is available, the
+    * timeout expired or the reader was detached.
+    *
+    * @param [in] iReader   the reader.
+    * @param [in] time      timeout in milliseconds.
+    *
+    * @return the next block, a null block on timeout or when the reader is not attached.
+    */
+    inline Block pop(int iReader, unsigned long time = ULONG_MAX);
+
+    //=========================================================================================================
+    /**
+    * Number of blocks the given reader has not popped yet.
+    *
+    * @param [in] iReader   the reader.
+    *
+    * @return the number of pending blocks.
+    */
+    quint32 pending(int iReader);
+
+    //=========================================================================================================
+    /**
+    * Number of blocks the given reader lost since the last call, because it fell a whole buffer length
+    * behind. A non zero value flags a reader which is too slow for the stream.
+    *
+    * @param [in] iReader   the reader.
+    *
+    * @return the number of dropped blocks.
+    */
+    quint32 dropped(int iReader);
+
+    //=========================================================================================================
+    /**
+    * Clears the buffer; pending blocks of all readers are discarded.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Size of the buffer in blocks.
+    */
+    inline quint32 size() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Cursor and state of one reader.
+    */
+    struct Reader
+    {
+        bool    bAttached;      /**< Whether the slot is in use.*/
+        quint64 uiCursor;       /**< Sequence number of the next block to pop.*/
+        quint32 uiDropped;      /**< Blocks lost since the last call of dropped().*/
+    };
+
+    unsigned int        m_uiMaxNumBlocks;   /**< Holds the maximal number of blocks.*/
+    QVector<Block>      m_qVecBlocks;       /**< Holds the circular block buffer.*/
+    quint64             m_uiWriteCount;     /**< Sequence number of the next block to push.*/
+    QVector<Reader>     m_qVecReaders;      /**< Holds the readers, indexed by reader id.*/
+    QMutex              m_qMutex;           /**< Guards blocks, counters and readers.*/
+    QWaitCondition      m_qWaitCondition;   /**< Readers waiting for a block.*/
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+template<typename _Tp>
+BroadcastMatrixBuffer<_Tp>::BroadcastMatrixBuffer(unsigned int uiMaxNumBlocks)
+: Buffer(typeid(_Tp).name())
+, m_uiMaxNumBlocks(uiMaxNumBlocks > 0 ? uiMaxNumBlocks : 1)
+, m_qVecBlocks(m_uiMaxNumBlocks)
+, m_uiWriteCount(0)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+BroadcastMatrixBuffer<_Tp>::~BroadcastMatrixBuffer()
+{
+
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+int BroadcastMatrixBuffer<_Tp>::attach()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    Reader t_reader;
+    t_reader.bAttached = true;
+    t_reader.uiCursor = m_uiWriteCount;
+    t_reader.uiDropped = 0;
+
+    for(int i = 0; i < m_qVecReaders.size(); ++i)
+    {
+        if(!m_qVecReaders[i].bAttached)
+        {
+            m_qVecReaders[i] = t_reader;
+            return i;
+        }
+    }
+
+    m_qVecReaders.append(t_reader);
+    return m_qVecReaders.size() - 1;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void BroadcastMatrixBuffer<_Tp>::detach(int iReader)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(iReader >= 0 && iReader < m_qVecReaders.size())
+        m_qVecReaders[iReader].bAttached = false;
+
+    m_qWaitCondition.wakeAll();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void BroadcastMatrixBuffer<_Tp>::push(const Block& p_block)
+{
+    Block t_blockOverwritten;
+
+    m_qMutex.lock();
+
+    for(int i = 0; i < m_qVecReaders.size(); ++i)
+    {
+        Reader& t_reader = m_qVecReaders[i];
+        if(t_reader.bAttached && m_uiWriteCount - t_reader.uiCursor >= m_uiMaxNumBlocks)
+        {
+            ++t_reader.uiCursor;
+            ++t_reader.uiDropped;
+        }
+    }
+
+    Block& t_slot = m_qVecBlocks[(int)(m_uiWriteCount % m_uiMaxNumBlocks)];
+    t_blockOverwritten = t_slot;
+    t_slot = p_block;
+    ++m_uiWriteCount;
+
+    m_qWaitCondition.wakeAll();
+    m_qMutex.unlock();
+
+    // the last reference of the overwritten block is released outside of the lock
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void BroadcastMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+{
+    push(Block(new Matrix<_Tp, Dynamic, Dynamic>(*pMatrix)));
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline typename BroadcastMatrixBuffer<_Tp>::Block BroadcastMatrixBuffer<_Tp>::pop(int iReader, unsigned long time)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(iReader < 0 || iReader >= m_qVecReaders.size())
+        return Block();
+
+    while(m_qVecReaders[iReader].bAttached && m_qVecReaders[iReader].uiCursor == m_uiWriteCount)
+        if(!m_qWaitCondition.wait(&m_qMutex, time))
+            break;
+
+    Reader& t_reader = m_qVecReaders[iReader];
+    if(!t_reader.bAttached || t_reader.uiCursor == m_uiWriteCount)
+        return Block();
+
+    Block t_block = m_qVecBlocks[(int)(t_reader.uiCursor % m_uiMaxNumBlocks)];
+    ++t_reader.uiCursor;
+
+    return t_block;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+quint32 BroadcastMatrixBuffer<_Tp>::pending(int iReader)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(iReader < 0 || iReader >= m_qVecReaders.size() || !m_qVecReaders[iReader].bAttached)
+        return 0;
+
+    return (quint32)(m_uiWriteCount - m_qVecReaders[iReader].uiCursor);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+quint32 BroadcastMatrixBuffer<_Tp>::dropped(int iReader)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(iReader < 0 || iReader >= m_qVecReaders.size())
+        return 0;
+
+    quint32 t_uiDropped = m_qVecReaders[iReader].uiDropped;
+    m_qVecReaders[iReader].uiDropped = 0;
+
+    return t_uiDropped;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void BroadcastMatrixBuffer<_Tp>::clear()
+{
+    QVector<Block> t_qVecBlocks(m_uiMaxNumBlocks);
+
+    m_qMutex.lock();
+    m_qVecBlocks.swap(t_qVecBlocks);
+    for(int i = 0; i < m_qVecReaders.size(); ++i)
+        m_qVecReaders[i].uiCursor = m_uiWriteCount;
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 BroadcastMatrixBuffer<_Tp>::size() const
+{
+    return m_uiMaxNumBlocks;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// TYPEDEF
+//=============================================================================================================
+
+typedef GENERICSSHARED_EXPORT BroadcastMatrixBuffer<float>                   _float_BroadcastMatrixBuffer;              /**< Defines BroadcastMatrixBuffer of float type.*/
+typedef GENERICSSHARED_EXPORT BroadcastMatrixBuffer<double>                  _double_BroadcastMatrixBuffer;             /**< Defines BroadcastMatrixBuffer of double type.*/
+
+} // NAMESPACE
+
+#endif // BROADCASTMATRIXBUFFER_H
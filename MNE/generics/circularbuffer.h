@@ -51,10 +51,23 @@
 //=============================================================================================================
 
 #include <QPair>
-#include <QSemaphore>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
 #include <QSharedPointer>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#ifndef CIRCULARBUFFER_SPIN_COUNT
+#define CIRCULARBUFFER_SPIN_COUNT 64    /**< Yields before a waiting producer or consumer parks */
+#endif
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE NAMESPACE IOBuffer
@@ -74,6 +87,9 @@ namespace IOBuffer
 /**
 * TEMPLATE CIRCULAR BUFFER
 *
+* Lock-free between one producer and one consumer thread, like CircularMatrixBuffer: each side owns one
+* counter, waiting sides yield and then park. The counters run modulo twice the capacity.
+*
 * @brief The TEMPLATE CIRCULAR BUFFER provides a template for thread safe circular buffers.
 */
 template<typename _Tp>
@@ -99,7 +115,8 @@ public:
 
     //=========================================================================================================
     /**
-    * Adds a whole array at the end buffer.
+    * Adds a whole array at the end buffer. Arrays longer than the free space are published in parts as space
+    * becomes available.
     *
     * @param [in] pArray pointer to an Array which should be apend to the end.
     * @param [in] size number of elements containing the array.
@@ -124,25 +141,62 @@ public:
 
     //=========================================================================================================
     /**
-    * Clears the buffer.
+    * Copies the first size elements (first in first out) into the given array; blocks until all of them were
+    * pushed.
+    *
+    * @param [out] pArray pointer to an Array of at least size elements.
+    * @param [in] size number of elements to pop.
+    */
+    inline void popInto(_Tp* pArray, unsigned int size);
+
+    //=========================================================================================================
+    /**
+    * Clears the buffer. Must not be called while a push or pop is in progress.
     */
     void clear();
 
 private:
     //=========================================================================================================
     /**
-    * Returns the current circular index to the corresponding given index.
+    * Waits until the ring has at least one free (bFree) or one used element.
+    *
+    * @param [in] bFree     whether to wait for a free element or for a used one.
+    * @return the number of free or used elements.
+    */
+    inline unsigned int wait(bool bFree);
+
+    //=========================================================================================================
+    /**
+    * Number of free (bFree) or used elements.
     *
-    * @param [in] index which should be mapped.
-    * @return the mapped index.
+    * @param [in] bFree     whether to count free or used elements.
+    * @return the number of elements.
     */
-    inline unsigned int mapIndex(int& index);
-    unsigned int    m_uiMaxNumElements;		/**< Holds the maximal number of buffer elements.*/
-    _Tp*            m_pBuffer;				/**< Holds the circular buffer.*/
-    int             m_iCurrentReadIndex;	/**< Holds the current read index.*/
-    int             m_iCurrentWriteIndex;	/**< Holds the current write index.*/
-    QSemaphore*     m_pFreeElements;		/**< Holds a semaphore which acquires free elements for thread safe writing. A semaphore is a generalization of a mutex.*/
-    QSemaphore*     m_pUsedElements;		/**< Holds a semaphore which acquires written semaphore for thread safe reading.*/
+    inline unsigned int available(bool bFree) const;
+
+    //=========================================================================================================
+    /**
+    * Wakes a parked producer or consumer, if any.
+    */
+    inline void wake();
+
+    //=========================================================================================================
+    /**
+    * Advances a counter, which runs modulo twice the capacity.
+    *
+    * @param [in] uiCount   counter value.
+    * @param [in] uiStep    number of elements to advance by, at most the capacity.
+    * @return the next counter value.
+    */
+    inline unsigned int next(unsigned int uiCount, unsigned int uiStep) const;
+
+    unsigned int    m_uiMaxNumElements;     /**< Holds the maximal number of buffer elements.*/
+    _Tp*            m_pBuffer;              /**< Holds the circular buffer.*/
+    QAtomicInt      m_iWriteCount;          /**< Elements pushed so far modulo 2*uiMaxNumElements, written by the producer only.*/
+    QAtomicInt      m_iReadCount;           /**< Elements popped so far modulo 2*uiMaxNumElements, written by the consumer only.*/
+    QAtomicInt      m_iParked;              /**< Number of parked threads.*/
+    QMutex          m_qMutex;               /**< Guards parking.*/
+    QWaitCondition  m_qWaitCondition;       /**< Parked producer or consumer.*/
 };
 
 
@@ -153,12 +207,11 @@ private:
 
 template<typename _Tp>
 CircularBuffer<_Tp>::CircularBuffer(unsigned int uiMaxNumElements)
-: m_uiMaxNumElements(uiMaxNumElements)
+: m_uiMaxNumElements(uiMaxNumElements > 0 ? uiMaxNumElements : 1)
 , m_pBuffer(new _Tp[m_uiMaxNumElements])
-, m_iCurrentReadIndex(-1)
-, m_iCurrentWriteIndex(-1)
-, m_pFreeElements(new QSemaphore(m_uiMaxNumElements))
-, m_pUsedElements(new QSemaphore(0))
+, m_iWriteCount(0)
+, m_iReadCount(0)
+, m_iParked(0)
 {
 
 }
@@ -169,8 +222,6 @@ CircularBuffer<_Tp>::CircularBuffer(unsigned int uiMaxNumElements)
 template<typename _Tp>
 CircularBuffer<_Tp>::~CircularBuffer()
 {
-    delete m_pFreeElements;
-    delete m_pUsedElements;
     delete [] m_pBuffer;
 }
 
@@ -180,10 +231,20 @@ CircularBuffer<_Tp>::~CircularBuffer()
 template<typename _Tp>
 inline void CircularBuffer<_Tp>::push(const _Tp* pArray, unsigned int size)
 {
-    m_pFreeElements->acquire(size);
-    for(unsigned int i = 0; i < size; ++i)
-        m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = pArray[i];
-    m_pUsedElements->release(size);
+    while(size > 0)
+    {
+        unsigned int t_uiCount = qMin(wait(true), size);
+
+        unsigned int t_uiWrite = (unsigned int)m_iWriteCount.load();
+        for(unsigned int i = 0; i < t_uiCount; ++i)
+            m_pBuffer[(t_uiWrite + i) % m_uiMaxNumElements] = pArray[i];
+
+        m_iWriteCount.fetchAndStoreOrdered((int)next(t_uiWrite, t_uiCount));
+        wake();
+
+        pArray += t_uiCount;
+        size -= t_uiCount;
+    }
 }
 
 
@@ -192,9 +253,13 @@ inline void CircularBuffer<_Tp>::push(const _Tp* pArray, unsigned int size)
 template<typename _Tp>
 inline void CircularBuffer<_Tp>::push(const _Tp& newElement)
 {
-    m_pFreeElements->acquire();
-    m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = newElement;
-    m_pUsedElements->release();
+    wait(true);
+
+    unsigned int t_uiWrite = (unsigned int)m_iWriteCount.load();
+    m_pBuffer[t_uiWrite % m_uiMaxNumElements] = newElement;
+
+    m_iWriteCount.fetchAndStoreOrdered((int)next(t_uiWrite, 1));
+    wake();
 }
 
 
@@ -203,9 +268,13 @@ inline void CircularBuffer<_Tp>::push(const _Tp& newElement)
 template<typename _Tp>
 inline _Tp CircularBuffer<_Tp>::pop()
 {
-    m_pUsedElements->acquire();
-    _Tp element = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
-    m_pFreeElements->release();
+    wait(false);
+
+    unsigned int t_uiRead = (unsigned int)m_iReadCount.load();
+    _Tp element = m_pBuffer[t_uiRead % m_uiMaxNumElements];
+
+    m_iReadCount.fetchAndStoreOrdered((int)next(t_uiRead, 1));
+    wake();
 
     return element;
 }
@@ -214,24 +283,90 @@ inline _Tp CircularBuffer<_Tp>::pop()
 //*************************************************************************************************************
 
 template<typename _Tp>
-inline unsigned int CircularBuffer<_Tp>::mapIndex(int& index)
+inline void CircularBuffer<_Tp>::popInto(_Tp* pArray, unsigned int size)
 {
-    return index = ++index % m_uiMaxNumElements;
+    while(size > 0)
+    {
+        unsigned int t_uiCount = qMin(wait(false), size);
+
+        unsigned int t_uiRead = (unsigned int)m_iReadCount.load();
+        for(unsigned int i = 0; i < t_uiCount; ++i)
+            pArray[i] = m_pBuffer[(t_uiRead + i) % m_uiMaxNumElements];
+
+        m_iReadCount.fetchAndStoreOrdered((int)next(t_uiRead, t_uiCount));
+        wake();
+
+        pArray += t_uiCount;
+        size -= t_uiCount;
+    }
 }
 
 
 //*************************************************************************************************************
 
 template<typename _Tp>
-void CircularBuffer<_Tp>::clear()
+inline unsigned int CircularBuffer<_Tp>::available(bool bFree) const
+{
+    unsigned int t_uiUsed = ((unsigned int)m_iWriteCount.loadAcquire() + 2*m_uiMaxNumElements - (unsigned int)m_iReadCount.loadAcquire()) % (2*m_uiMaxNumElements);
+    return bFree ? m_uiMaxNumElements - t_uiUsed : t_uiUsed;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline unsigned int CircularBuffer<_Tp>::next(unsigned int uiCount, unsigned int uiStep) const
+{
+    return (uiCount + uiStep) % (2*m_uiMaxNumElements);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline unsigned int CircularBuffer<_Tp>::wait(bool bFree)
+{
+    unsigned int t_uiAvailable;
+    for(int i = 0; i < CIRCULARBUFFER_SPIN_COUNT; ++i)
+    {
+        if((t_uiAvailable = available(bFree)) > 0)
+            return t_uiAvailable;
+        QThread::yieldCurrentThread();
+    }
+
+    m_qMutex.lock();
+    m_iParked.fetchAndAddOrdered(1);
+    while((t_uiAvailable = available(bFree)) == 0)
+        m_qWaitCondition.wait(&m_qMutex);
+    m_iParked.fetchAndAddOrdered(-1);
+    m_qMutex.unlock();
+
+    return t_uiAvailable;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularBuffer<_Tp>::wake()
 {
-    delete m_pFreeElements;
-    m_pFreeElements = new QSemaphore(m_uiMaxNumElements);
-    delete m_pUsedElements;
-    m_pUsedElements = new QSemaphore(0);
+    if(m_iParked.load() > 0)
+    {
+        m_qMutex.lock();
+        m_qWaitCondition.wakeAll();
+        m_qMutex.unlock();
+    }
+}
+
+
+//*************************************************************************************************************
 
-    m_iCurrentReadIndex = -1;
-    m_iCurrentWriteIndex = -1;
+template<typename _Tp>
+void CircularBuffer<_Tp>::clear()
+{
+    m_iWriteCount.fetchAndStoreOrdered(0);
+    m_iReadCount.fetchAndStoreOrdered(0);
+    wake();
 }
 
 
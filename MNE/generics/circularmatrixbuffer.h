@@ -62,10 +62,21 @@
 //=============================================================================================================
 
 #include <QPair>
-#include <QSemaphore>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
 #include <QSharedPointer>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define CIRCULARBUFFER_SPIN_COUNT 64    /**< Yields before a waiting producer or consumer parks */
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE NAMESPACE IOBuffer
@@ -85,7 +96,14 @@ using namespace Eigen;
 
 //=============================================================================================================
 /**
-* Circular Matrix buffer provides a template for thread safe circular matrix buffers.
+* Circular Matrix buffer provides a template for thread safe circular matrix buffers between one producer and
+* one consumer thread.
+*
+* The ring holds whole matrices. Producer and consumer each own one counter which the other side only reads
+* (release on publish, acquire on read), so neither push nor pop takes a lock while the ring is neither full
+* nor empty. A side which has to wait yields a few times and then parks on a condition; the other side only
+* touches the mutex when someone is parked. The counters run modulo twice the capacity, so slot and fill level
+* stay consistent for any capacity and never overflow.
 *
 * @brief The circular matrix buffer
 */
@@ -115,7 +133,7 @@ public:
 
     //=========================================================================================================
     /**
-    * Adds a whole matrix at the end buffer.
+    * Adds a whole matrix at the end buffer. Blocks while the buffer is full.
     *
     * @param [in] pMatrix pointer to a Matrix which should be apend to the end.
     */
@@ -123,7 +141,18 @@ public:
 
     //=========================================================================================================
     /**
-    * Returns the first matrix (first in first out).
+    * Evaluates a matrix expression directly into the next free slot of the buffer, no temporary matrix is
+    * constructed. Blocks while the buffer is full. Like push, an expression of rows*cols elements but other
+    * dimensions is stored in column major element order; expressions of another size are ignored.
+    *
+    * @param [in] p_matExpr matrix expression of rows x cols elements.
+    */
+    template<typename Derived>
+    inline void pushInPlace(const MatrixBase<Derived>& p_matExpr);
+
+    //=========================================================================================================
+    /**
+    * Returns the first matrix (first in first out). Blocks while the buffer is empty.
     *
     * @return the first matrix
     */
@@ -131,7 +160,16 @@ public:
 
     //=========================================================================================================
     /**
-    * Clears the buffer.
+    * Copies the first matrix (first in first out) into the given matrix, which is only reallocated when its
+    * dimensions differ. Blocks while the buffer is empty.
+    *
+    * @param [out] p_matOut matrix which receives the first matrix.
+    */
+    inline void popInto(Matrix<_Tp, Dynamic, Dynamic>& p_matOut);
+
+    //=========================================================================================================
+    /**
+    * Clears the buffer. Must not be called while a push or pop is in progress.
     */
     void clear();
 
@@ -156,22 +194,46 @@ public:
 private:
     //=========================================================================================================
     /**
-    * Returns the current circular index to the corresponding given index.
+    * Waits until the ring holds less than uiMaxNumMatrices matrices (bFree) or at least one matrix.
+    *
+    * @param [in] bFree     whether to wait for a free slot or for a used one.
+    */
+    inline void wait(bool bFree);
+
+    //=========================================================================================================
+    /**
+    * Whether the awaited condition of wait holds.
+    *
+    * @param [in] bFree     whether to check for a free slot or for a used one.
+    * @return true if the condition holds.
+    */
+    inline bool ready(bool bFree) const;
+
+    //=========================================================================================================
+    /**
+    * Wakes a parked producer or consumer, if any.
+    */
+    inline void wake();
+
+    //=========================================================================================================
+    /**
+    * Advances a counter, which runs modulo twice the capacity.
     *
-    * @param [in] index which should be mapped.
-    * @return the mapped index.
+    * @param [in] uiCount   counter value.
+    * @return the next counter value.
     */
-    inline unsigned int mapIndex(int& index);
+    inline unsigned int next(unsigned int uiCount) const;
 
     unsigned int    m_uiMaxNumMatrices;         /**< Holds the maximal number of matrices.*/
     unsigned int    m_uiRows;                   /**< Holds the number rows.*/
     unsigned int    m_uiCols;                   /**< Holds the number cols.*/
     unsigned int    m_uiMaxNumElements;         /**< Holds the maximal number of buffer elements.*/
     _Tp*            m_pBuffer;                  /**< Holds the circular buffer.*/
-    int             m_iCurrentReadIndex;        /**< Holds the current read index.*/
-    int             m_iCurrentWriteIndex;       /**< Holds the current write index.*/
-    QSemaphore*     m_pFreeElements;            /**< Holds a semaphore which acquires free elements for thread safe writing. A semaphore is a generalization of a mutex.*/
-    QSemaphore*     m_pUsedElements;            /**< Holds a semaphore which acquires written semaphore for thread safe reading.*/
+    QAtomicInt      m_iWriteCount;              /**< Matrices pushed so far modulo 2*uiMaxNumMatrices, written by the producer only.*/
+    QAtomicInt      m_iReadCount;               /**< Matrices popped so far modulo 2*uiMaxNumMatrices, written by the consumer only.*/
+    QAtomicInt      m_iParked;                  /**< Number of parked threads.*/
+    QMutex          m_qMutex;                   /**< Guards parking.*/
+    QWaitCondition  m_qWaitCondition;           /**< Parked producer or consumer.*/
 };
 
 
@@ -183,15 +245,14 @@ private:
 template<typename _Tp>
 CircularMatrixBuffer<_Tp>::CircularMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols)
 : Buffer(typeid(_Tp).name())
-, m_uiMaxNumMatrices(uiMaxNumMatrices)
+, m_uiMaxNumMatrices(uiMaxNumMatrices > 0 ? uiMaxNumMatrices : 1)
 , m_uiRows(uiRows)
 , m_uiCols(uiCols)
 , m_uiMaxNumElements(m_uiMaxNumMatrices*m_uiRows*m_uiCols)
 , m_pBuffer(new _Tp[m_uiMaxNumElements])
-, m_iCurrentReadIndex(-1)
-, m_iCurrentWriteIndex(-1)
-, m_pFreeElements(new QSemaphore(m_uiMaxNumElements))
-, m_pUsedElements(new QSemaphore(0))
+, m_iWriteCount(0)
+, m_iReadCount(0)
+, m_iParked(0)
 {
 
 }
@@ -202,8 +263,6 @@ CircularMatrixBuffer<_Tp>::CircularMatrixBuffer(unsigned int uiMaxNumMatrices, u
 template<typename _Tp>
 CircularMatrixBuffer<_Tp>::~CircularMatrixBuffer()
 {
-    delete m_pFreeElements;
-    delete m_pUsedElements;
     delete [] m_pBuffer;
 }
 
@@ -213,16 +272,48 @@ CircularMatrixBuffer<_Tp>::~CircularMatrixBuffer()
 template<typename _Tp>
 inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
 {
-    unsigned int t_size = pMatrix->size();
-    if(t_size == m_uiRows*m_uiCols)
+    unsigned int t_uiSize = m_uiRows*m_uiCols;
+    if((unsigned int)pMatrix->size() != t_uiSize)
+        return;
+
+    wait(true);
+
+    unsigned int t_uiWrite = (unsigned int)m_iWriteCount.load();
+    _Tp* t_pSlot = m_pBuffer + (t_uiWrite % m_uiMaxNumMatrices)*t_uiSize;
+    Map< Matrix<_Tp, Dynamic, 1> >(t_pSlot, t_uiSize) = Map< const Matrix<_Tp, Dynamic, 1> >(pMatrix->data(), t_uiSize);
+
+    // publish the slot; ordered, so a consumer parking concurrently is seen by wake
+    m_iWriteCount.fetchAndStoreOrdered((int)next(t_uiWrite));
+    wake();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+template<typename Derived>
+inline void CircularMatrixBuffer<_Tp>::pushInPlace(const MatrixBase<Derived>& p_matExpr)
+{
+    if((unsigned int)p_matExpr.rows() != m_uiRows || (unsigned int)p_matExpr.cols() != m_uiCols)
     {
-        m_pFreeElements->acquire(t_size);
-        for(unsigned int i = 0; i < t_size; ++i)
-            m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = pMatrix->data()[i];
-        m_pUsedElements->release(t_size);
+        // same number of elements in other dimensions -> take the elements over as push does
+        if((unsigned int)p_matExpr.size() == m_uiRows*m_uiCols)
+        {
+            Matrix<_Tp, Dynamic, Dynamic> t_matTmp(p_matExpr);
+            push(&t_matTmp);
+        }
+        return;
     }
-//    else
-//        printf("Error: Matrix not appended to CircularMatrixBuffer - wrong dimensions\n");
+
+    wait(true);
+
+    unsigned int t_uiWrite = (unsigned int)m_iWriteCount.load();
+    _Tp* t_pSlot = m_pBuffer + (t_uiWrite % m_uiMaxNumMatrices)*m_uiRows*m_uiCols;
+    Map< Matrix<_Tp, Dynamic, Dynamic> >(t_pSlot, m_uiRows, m_uiCols) = p_matExpr;
+
+    // publish the slot; ordered, so a consumer parking concurrently is seen by wake
+    m_iWriteCount.fetchAndStoreOrdered((int)next(t_uiWrite));
+    wake();
 }
 
 
@@ -231,11 +322,8 @@ inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>*
 template<typename _Tp>
 inline Matrix<_Tp, Dynamic, Dynamic> CircularMatrixBuffer<_Tp>::pop()
 {
-    m_pUsedElements->acquire(m_uiRows*m_uiCols);
-    Matrix<_Tp, Dynamic, Dynamic> matrix(m_uiRows, m_uiCols);
-    for(quint32 i = 0; i < m_uiRows*m_uiCols; ++i)
-        matrix.data()[i] = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
-    m_pFreeElements->release(m_uiRows*m_uiCols);
+    Matrix<_Tp, Dynamic, Dynamic> matrix;
+    popInto(matrix);
 
     return matrix;
 }
@@ -244,24 +332,82 @@ inline Matrix<_Tp, Dynamic, Dynamic> CircularMatrixBuffer<_Tp>::pop()
 //*************************************************************************************************************
 
 template<typename _Tp>
-inline unsigned int CircularMatrixBuffer<_Tp>::mapIndex(int& index)
+inline void CircularMatrixBuffer<_Tp>::popInto(Matrix<_Tp, Dynamic, Dynamic>& p_matOut)
 {
-    return index = ++index % m_uiMaxNumElements;
+    wait(false);
+
+    unsigned int t_uiRead = (unsigned int)m_iReadCount.load();
+    const _Tp* t_pSlot = m_pBuffer + (t_uiRead % m_uiMaxNumMatrices)*m_uiRows*m_uiCols;
+    p_matOut = Map< const Matrix<_Tp, Dynamic, Dynamic> >(t_pSlot, m_uiRows, m_uiCols);
+
+    // release the slot; ordered, so a producer parking concurrently is seen by wake
+    m_iReadCount.fetchAndStoreOrdered((int)next(t_uiRead));
+    wake();
 }
 
 
 //*************************************************************************************************************
 
 template<typename _Tp>
-void CircularMatrixBuffer<_Tp>::clear()
+inline bool CircularMatrixBuffer<_Tp>::ready(bool bFree) const
+{
+    unsigned int t_uiUsed = ((unsigned int)m_iWriteCount.loadAcquire() + 2*m_uiMaxNumMatrices - (unsigned int)m_iReadCount.loadAcquire()) % (2*m_uiMaxNumMatrices);
+    return bFree ? t_uiUsed < m_uiMaxNumMatrices : t_uiUsed > 0;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline unsigned int CircularMatrixBuffer<_Tp>::next(unsigned int uiCount) const
+{
+    return (uiCount + 1) % (2*m_uiMaxNumMatrices);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularMatrixBuffer<_Tp>::wait(bool bFree)
+{
+    for(int i = 0; i < CIRCULARBUFFER_SPIN_COUNT; ++i)
+    {
+        if(ready(bFree))
+            return;
+        QThread::yieldCurrentThread();
+    }
+
+    m_qMutex.lock();
+    m_iParked.fetchAndAddOrdered(1);
+    while(!ready(bFree))
+        m_qWaitCondition.wait(&m_qMutex);
+    m_iParked.fetchAndAddOrdered(-1);
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularMatrixBuffer<_Tp>::wake()
 {
-    delete m_pFreeElements;
-    m_pFreeElements = new QSemaphore(m_uiMaxNumElements);
-    delete m_pUsedElements;
-    m_pUsedElements = new QSemaphore(0);
+    if(m_iParked.load() > 0)
+    {
+        m_qMutex.lock();
+        m_qWaitCondition.wakeAll();
+        m_qMutex.unlock();
+    }
+}
+
 
-    m_iCurrentReadIndex = -1;
-    m_iCurrentWriteIndex = -1;
+//*************************************************************************************************************
+
+template<typename _Tp>
+void CircularMatrixBuffer<_Tp>::clear()
+{
+    m_iWriteCount.fetchAndStoreOrdered(0);
+    m_iReadCount.fetchAndStoreOrdered(0);
+    wake();
 }
 
 
@@ -64,11 +64,13 @@ win32 {
 SOURCES += \ 
     circularbuffer.cpp \
     circularmatrixbuffer.cpp \
+    broadcastmatrixbuffer.cpp \
     observerpattern.cpp \
     buffer.cpp
 
 HEADERS += generics_global.h \
     circularmatrixbuffer.h \
+    broadcastmatrixbuffer.h \
     circularbuffer.h \
     observerpattern.h \
     commandpattern.h \
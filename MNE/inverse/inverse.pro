@@ -81,6 +81,7 @@ win32 {
 SOURCES += \
     sourceestimate.cpp \
     minimumNorm/minimumnorm.cpp \
+    minimumNorm/rtminimumnorm.cpp \
     rapMusic/rapmusic.cpp
 
 HEADERS +=\
@@ -88,6 +89,7 @@ HEADERS +=\
     IInverseAlgorithm.h \
     sourceestimate.h \
     minimumNorm/minimumnorm.h \
+    minimumNorm/rtminimumnorm.h \
     rapMusic/rapmusic.h
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
@@ -71,6 +71,9 @@ using namespace INVERSELIB;
 
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString method)
 : m_inverseOperator(p_inverseOperator)
+, m_bKernelValid(false)
+, m_iCachedNave(-1)
+, m_bCachedPickNormal(false)
 {
     this->setRegularization(lambda);
     this->setMethod(method);
@@ -80,6 +83,9 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, bool dSPM, bool sLORETA)
 : m_inverseOperator(p_inverseOperator)
+, m_bKernelValid(false)
+, m_iCachedNave(-1)
+, m_bCachedPickNormal(false)
 {
     this->setRegularization(lambda);
     this->setMethod(dSPM, sLORETA);
@@ -90,68 +96,99 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 
 SourceEstimate MinimumNorm::calculateInverse(const FiffEvoked &p_fiffEvoked, bool pick_normal) const
 {
-    //
-    //   Set up the inverse according to the parameters
-    //
-    qint32 nave = p_fiffEvoked.nave;
+    QMutexLocker locker(&m_qMutexCache);
 
-    if(!m_inverseOperator.check_ch_names(p_fiffEvoked.info))
-    {
-        qWarning("Channel name check failed.");
+    if(!updateKernel(p_fiffEvoked, pick_normal))
         return SourceEstimate();
-    }
 
-    MNEInverseOperator inv = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
     //
     //   Pick the correct channels from the data
     //
-    FiffEvoked t_fiffEvoked = p_fiffEvoked.pick_channels(inv.noise_cov->names);
+    FiffEvoked t_fiffEvoked = p_fiffEvoked.pick_channels(m_invPrepared.noise_cov->names);
 
     printf("Picked %d channels from the data\n",t_fiffEvoked.info.nchan);
     printf("Computing inverse...");
 
-    MatrixXd K;
-    SparseMatrix<double> noise_norm;
-    QList<VectorXi> vertno;
-    Label label;
-    inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
-    MatrixXd sol = K * t_fiffEvoked.data; //apply imaging kernel
+    MatrixXd sol = m_matKernel * t_fiffEvoked.data; //apply imaging kernel
 
-    if (inv.source_ori == FIFFV_MNE_FREE_ORI)
+    if (m_invPrepared.source_ori == FIFFV_MNE_FREE_ORI)
     {
         printf("combining the current components...");
-        MatrixXd sol1(sol.rows()/3,sol.cols());
-        for(qint32 i = 0; i < sol.cols(); ++i)
+        MatrixXd sol1;
+        MNEMath::combine_xyz(sol, sol1);
+        sol = sol1.cwiseSqrt();
+
+        //
+        //   The noise normalization follows the combination, hence it is not part of the kernel
+        //
+        if (m_bdSPM)
+        {
+            printf("(dSPM)...");
+            sol = m_invPrepared.noisenorm*sol;
+        }
+        else if (m_bsLORETA)
         {
-            VectorXd* tmp = MNEMath::combine_xyz(sol.block(0,i,sol.rows(),1));
-            sol1.block(0,i,sol.rows()/3,1) = tmp->cwiseSqrt();
-            delete tmp;
+            printf("(sLORETA)...");
+            sol = m_invPrepared.noisenorm*sol;
         }
-        sol.resize(sol1.rows(),sol1.cols());
-        sol = sol1;
     }
+    printf("[done]\n");
+
+    //Results
+    float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
+    float tstep = 1/t_fiffEvoked.info.sfreq;
 
-    if (m_bdSPM)
+    return SourceEstimate(sol, m_qListVertices, tmin, tstep);
+}
+
+
+//*************************************************************************************************************
+
+bool MinimumNorm::updateKernel(const FiffEvoked &p_fiffEvoked, bool pick_normal) const
+{
+    qint32 nave = p_fiffEvoked.nave;
+
+    if(m_bKernelValid && m_iCachedNave == nave && m_bCachedPickNormal == pick_normal && m_qListCachedChNames == p_fiffEvoked.info.ch_names)
+        return true;
+
+    m_bKernelValid = false;
+
+    //
+    //   Set up the inverse according to the parameters
+    //
+    if(!m_inverseOperator.check_ch_names(p_fiffEvoked.info))
     {
-        printf("(dSPM)...");
-        sol = inv.noisenorm*sol;
+        qWarning("Channel name check failed.");
+        return false;
     }
-    else if (m_bsLORETA)
+
+    m_invPrepared = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
+
+    SparseMatrix<double> noise_norm;
+    QList<VectorXi> vertno;
+    Label label;
+    if(!m_invPrepared.assemble_kernel(label, m_sMethod, pick_normal, m_matKernel, noise_norm, vertno))
     {
-        printf("(sLORETA)...");
-        sol = inv.noisenorm*sol;
+        qWarning("Could not assemble the imaging kernel.");
+        return false;
     }
-    printf("[done]\n");
 
-    //Results
-    float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
-    float tstep = 1/t_fiffEvoked.info.sfreq;
+    //
+    //   With fixed orientations the noise normalization is a row scaling of the solution -> fold it into the kernel
+    //
+    if (m_invPrepared.source_ori != FIFFV_MNE_FREE_ORI && (m_bdSPM || m_bsLORETA))
+        m_matKernel = m_invPrepared.noisenorm*m_matKernel;
+
+    m_qListVertices.clear();
+    for(qint32 h = 0; h < m_invPrepared.src.size(); ++h)
+        m_qListVertices.push_back(m_invPrepared.src[h].vertno);
 
-    QList<VectorXi> t_qListVertices;
-    for(qint32 h = 0; h < inv.src.size(); ++h)
-        t_qListVertices.push_back(inv.src[h].vertno);
+    m_iCachedNave = nave;
+    m_bCachedPickNormal = pick_normal;
+    m_qListCachedChNames = p_fiffEvoked.info.ch_names;
+    m_bKernelValid = true;
 
-    return SourceEstimate(sol, t_qListVertices, tmin, tstep);
+    return true;
 }
 
 
@@ -195,6 +232,8 @@ void MinimumNorm::setMethod(QString method)
 
 void MinimumNorm::setMethod(bool dSPM, bool sLORETA)
 {
+    QMutexLocker locker(&m_qMutexCache);
+
     if(dSPM && sLORETA)
     {
         qWarning("Cant activate dSPM and sLORETA at the same time! - Activating dSPM");
@@ -213,6 +252,8 @@ void MinimumNorm::setMethod(bool dSPM, bool sLORETA)
             m_sMethod = QString("MNE");
 
     }
+
+    m_bKernelValid = false;
 }
 
 
@@ -220,5 +261,7 @@ void MinimumNorm::setMethod(bool dSPM, bool sLORETA)
 
 void MinimumNorm::setRegularization(float lambda)
 {
+    QMutexLocker locker(&m_qMutexCache);
     m_fLambda = lambda;
+    m_bKernelValid = false;
 }
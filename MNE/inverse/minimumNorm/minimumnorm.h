@@ -46,7 +46,9 @@
 
 #include <mne/mne_inverse_operator.h>
 
+#include <QMutex>
 #include <QSharedPointer>
+#include <QStringList>
 
 
 //*************************************************************************************************************
@@ -112,8 +114,9 @@ public:
 
     //=========================================================================================================
     /**
-    * Computes a L2-norm inverse solution Actual code using these principles might be different because the
-    * inverse operator is often reused across data sets.
+    * Computes a L2-norm inverse solution. The prepared inverse operator and the imaging kernel are cached and
+    * only recomputed when nave, pick_normal or the channel set of the data change, or when the method or the
+    * regularization were set anew. Repeated inverses of equally averaged data cost one matrix product.
     *
     * @param[in] p_fiffEvoked   Evoked data.
     * @param[in] pick_normal    If True, rather than pooling the orientations by taking the norm, only the
@@ -153,11 +156,32 @@ public:
     void setRegularization(float lambda);
 
 private:
+    //=========================================================================================================
+    /**
+    * Prepares the inverse operator and assembles the imaging kernel for the given parameters if they differ
+    * from the cached ones. The caller must hold m_qMutexCache.
+    *
+    * @param[in] p_fiffEvoked   Evoked data, which specifies nave and the channel set.
+    * @param[in] pick_normal    Keep only the radial component of loose orientations.
+    *
+    * @return true if the cache is valid for the given parameters, false otherwise
+    */
+    bool updateKernel(const FiffEvoked &p_fiffEvoked, bool pick_normal) const;
+
     MNEInverseOperator m_inverseOperator;   /**< The inverse operator */
     float m_fLambda;                        /**< Regularization parameter */
     QString m_sMethod;                      /**< Selected method */
     bool m_bsLORETA;                        /**< Do sLORETA method */
     bool m_bdSPM;                           /**< Do dSPM method */
+
+    mutable QMutex m_qMutexCache;               /**< Guards the cached kernel and the method parameters it is built from */
+    mutable bool m_bKernelValid;                /**< Whether the cached kernel matches the cached key */
+    mutable qint32 m_iCachedNave;               /**< nave the kernel was prepared for */
+    mutable bool m_bCachedPickNormal;           /**< pick_normal the kernel was assembled for */
+    mutable QStringList m_qListCachedChNames;   /**< Channel set of the data the kernel was checked against */
+    mutable MNEInverseOperator m_invPrepared;   /**< Cached prepared inverse operator */
+    mutable MatrixXd m_matKernel;               /**< Cached imaging kernel, includes the noise normalization for fixed orientations */
+    mutable QList<VectorXi> m_qListVertices;    /**< Source space vertices of the solution */
 };
 
 } //NAMESPACE
@@ -0,0 +1,243 @@
+//=============================================================================================================
+/**
+* @file     rtminimumnorm.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+*
+* @brief    Implementation of the RtMinimumNorm Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rtminimumnorm.h"
+
+#include <fs/label.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FSLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static const qint32 KERNEL_ROW_BLOCK = 256;    /**< Kernel rows kept in cache while they are applied to all samples of a block */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+RtMinimumNorm::RtMinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString &method, qint32 nave, bool pick_normal)
+: m_inverseOperator(p_inverseOperator)
+, m_fLambda(lambda)
+, m_sMethod(method)
+, m_iNave(nave)
+, m_bPickNormal(pick_normal)
+, m_bInitialized(false)
+, m_bCombineXyz(false)
+, m_iNumChannels(0)
+, m_iNumSources(0)
+, m_iMaxBlockSize(0)
+{
+    if(m_sMethod.compare("MNE") != 0 && m_sMethod.compare("dSPM") != 0 && m_sMethod.compare("sLORETA") != 0)
+    {
+        qWarning("Method not recognized!");
+        m_sMethod = "dSPM";
+    }
+}
+
+
+//*************************************************************************************************************
+
+RtMinimumNorm::~RtMinimumNorm()
+{
+
+}
+
+
+//*************************************************************************************************************
+
+bool RtMinimumNorm::init(const FiffInfo &p_fiffInfo, qint32 p_iMaxBlockSize)
+{
+    m_bInitialized = false;
+
+    if(p_iMaxBlockSize < 1)
+    {
+        qWarning("RtMinimumNorm: Block size has to be positive.");
+        return false;
+    }
+
+    if(!m_inverseOperator.check_ch_names(p_fiffInfo))
+    {
+        qWarning("Channel name check failed.");
+        return false;
+    }
+
+    bool dSPM = m_sMethod.compare("dSPM") == 0;
+    bool sLORETA = m_sMethod.compare("sLORETA") == 0;
+
+    MNEInverseOperator inv = m_inverseOperator.prepare_inverse_operator(m_iNave, m_fLambda, dSPM, sLORETA);
+
+    //
+    //   Resolve the channel pick once instead of picking the channels of every block
+    //
+    const QStringList& names = inv.noise_cov->names;
+    m_vecPick.resize(names.size());
+    for(qint32 i = 0; i < names.size(); ++i)
+    {
+        m_vecPick[i] = p_fiffInfo.ch_names.indexOf(names[i]);
+        if(m_vecPick[i] < 0)
+        {
+            qWarning("RtMinimumNorm: Channel %s not found in the measurement info.", names[i].toUtf8().constData());
+            return false;
+        }
+    }
+
+    SparseMatrix<double> noise_norm;
+    QList<VectorXi> vertno;
+    Label label;
+    if(!inv.assemble_kernel(label, m_sMethod, m_bPickNormal, m_matKernel, noise_norm, vertno))
+        return false;
+
+    m_bCombineXyz = inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal;
+    m_iNumSources = m_bCombineXyz ? m_matKernel.rows()/3 : m_matKernel.rows();
+
+    //
+    //   Noise normalization is diagonal: with fixed orientations it is folded into the kernel, otherwise it
+    //   scales the pooled amplitudes
+    //
+    m_vecNoiseNorm.resize(0);
+    if(dSPM || sLORETA)
+    {
+        m_vecNoiseNorm = VectorXd::Ones(m_iNumSources);
+        for (qint32 k = 0; k < inv.noisenorm.outerSize(); ++k)
+            for (SparseMatrix<double>::InnerIterator it(inv.noisenorm,k); it; ++it)
+                if(it.row() == it.col() && it.row() < m_iNumSources)
+                    m_vecNoiseNorm[it.row()] = it.value();
+
+        if(!m_bCombineXyz)
+        {
+            m_matKernel = m_vecNoiseNorm.asDiagonal()*m_matKernel;
+            m_vecNoiseNorm.resize(0);
+        }
+    }
+
+    m_iNumChannels = p_fiffInfo.nchan;
+    m_iMaxBlockSize = p_iMaxBlockSize;
+    m_matPicked.resize(m_matKernel.cols(), m_iMaxBlockSize);
+    m_matSol.resize(m_bCombineXyz ? m_matKernel.rows() : 0, m_iMaxBlockSize);
+
+    m_qListVertices.clear();
+    for(qint32 h = 0; h < inv.src.size(); ++h)
+        m_qListVertices.push_back(inv.src[h].vertno);
+
+    m_bInitialized = true;
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool RtMinimumNorm::apply(const MatrixXd &block, MatrixXd &out)
+{
+    if(!m_bInitialized || block.rows() != m_iNumChannels)
+        return false;
+
+    if(out.rows() != m_iNumSources || out.cols() != block.cols())
+        out.resize(m_iNumSources, block.cols());
+
+    qint32 nPick = m_vecPick.size();
+    qint32 nRows = m_matKernel.rows();
+
+    for(qint32 c = 0; c < block.cols(); c += m_iMaxBlockSize)
+    {
+        qint32 nsamp = qMin(m_iMaxBlockSize, (qint32)block.cols() - c);
+
+        //
+        //   Pick the channels
+        //
+        for(qint32 j = 0; j < nsamp; ++j)
+        {
+            const double* src = block.data() + (c+j)*block.outerStride();
+            double* dst = m_matPicked.data() + j*m_matPicked.outerStride();
+            for(qint32 i = 0; i < nPick; ++i)
+                dst[i] = src[m_vecPick[i]];
+        }
+
+        //
+        //   Apply the kernel as matrix-vector products over row panels of the kernel. Unlike the matrix product,
+        //   which allocates its packing buffers on every call, these write straight into the preallocated
+        //   destination; a panel stays in cache while it is applied to all samples.
+        //
+        MatrixXd& sol = m_bCombineXyz ? m_matSol : out;
+        qint32 solCol = m_bCombineXyz ? 0 : c;
+        for(qint32 r = 0; r < nRows; r += KERNEL_ROW_BLOCK)
+        {
+            qint32 nPanel = qMin(KERNEL_ROW_BLOCK, nRows - r);
+            for(qint32 j = 0; j < nsamp; ++j)
+                sol.col(solCol + j).segment(r, nPanel).noalias() = m_matKernel.middleRows(r, nPanel) * m_matPicked.col(j);
+        }
+
+        //
+        //   Pool the orientations in place of combine_xyz and normalize
+        //
+        if(m_bCombineXyz)
+        {
+            bool normalize = m_vecNoiseNorm.size() > 0;
+            for(qint32 j = 0; j < nsamp; ++j)
+            {
+                const double* s = m_matSol.data() + j*m_matSol.outerStride();
+                double* o = out.data() + (c+j)*out.outerStride();
+                for(qint32 i = 0; i < m_iNumSources; ++i, s += 3)
+                {
+                    o[i] = std::sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+                    if(normalize)
+                        o[i] *= m_vecNoiseNorm[i];
+                }
+            }
+        }
+    }
+
+    return true;
+}
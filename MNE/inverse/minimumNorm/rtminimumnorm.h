@@ -0,0 +1,190 @@
+//=============================================================================================================
+/**
+* @file     rtminimumnorm.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+*
+* @brief    RtMinimumNorm class declaration.
+*
+*/
+
+#ifndef RTMINIMUMNORM_H
+#define RTMINIMUMNORM_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../inverse_global.h"
+
+#include <mne/mne_inverse_operator.h>
+#include <fiff/fiff_info.h>
+
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE INVERSELIB
+//=============================================================================================================
+
+namespace INVERSELIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+using namespace MNELIB;
+
+
+//=============================================================================================================
+/**
+* Streaming minimum norm estimation. Prepares the inverse operator once, resolves the channel pick against the
+* measurement info and keeps the imaging kernel, the noise normalization and all work buffers preallocated.
+* apply() maps one raw block to source space without any heap allocation, as needed at acquisition rate.
+*
+* @brief Streaming minimum norm estimation for raw data blocks
+*/
+class INVERSESHARED_EXPORT RtMinimumNorm
+{
+public:
+    typedef QSharedPointer<RtMinimumNorm> SPtr;             /**< Shared pointer type for RtMinimumNorm. */
+    typedef QSharedPointer<const RtMinimumNorm> ConstSPtr;  /**< Const shared pointer type for RtMinimumNorm. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a streaming minimum norm estimation. init() has to be called before apply().
+    *
+    * @param[in] p_inverseOperator  The inverse operator
+    * @param[in] lambda             The regularization factor
+    * @param[in] method             Use mininum norm, dSPM or sLORETA. ("MNE" | "dSPM" | "sLORETA")
+    * @param[in] nave               Number of averages of the data blocks (scales the noise covariance)
+    * @param[in] pick_normal        Keep only the radial component of loose orientations
+    */
+    RtMinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString &method, qint32 nave = 1, bool pick_normal = false);
+
+    //=========================================================================================================
+    /**
+    * Destroys the RtMinimumNorm.
+    */
+    ~RtMinimumNorm();
+
+    //=========================================================================================================
+    /**
+    * Prepares the inverse operator, assembles the kernel and allocates the work buffers.
+    *
+    * @param[in] p_fiffInfo         Measurement info of the incoming blocks; the rows of a block are its channels
+    * @param[in] p_iMaxBlockSize    Maximal number of samples processed at once; larger blocks are split
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool init(const FiffInfo &p_fiffInfo, qint32 p_iMaxBlockSize);
+
+    //=========================================================================================================
+    /**
+    * True if init() succeeded.
+    *
+    * @return true if initialized
+    */
+    inline bool isInitialized() const
+    {
+        return m_bInitialized;
+    }
+
+    //=========================================================================================================
+    /**
+    * Applies the inverse to a raw data block. No heap allocation takes place when out has already the size
+    * getNumSources() x block.cols().
+    *
+    * @param[in] block      Raw data block (channels x samples), channels as in the info passed to init()
+    * @param[out] out       Source estimate (sources x samples)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool apply(const MatrixXd &block, MatrixXd &out);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of rows of the source estimate.
+    *
+    * @return the number of sources
+    */
+    inline qint32 getNumSources() const
+    {
+        return m_iNumSources;
+    }
+
+    //=========================================================================================================
+    /**
+    * Returns the vertices of the source estimate.
+    *
+    * @return the vertices of each hemisphere
+    */
+    inline const QList<VectorXi>& getVertices() const
+    {
+        return m_qListVertices;
+    }
+
+private:
+    MNEInverseOperator m_inverseOperator;   /**< The inverse operator */
+    float m_fLambda;                        /**< Regularization parameter */
+    QString m_sMethod;                      /**< Selected method */
+    qint32 m_iNave;                         /**< Number of averages */
+    bool m_bPickNormal;                     /**< Keep only the normal component */
+
+    bool m_bInitialized;                    /**< Whether init() succeeded */
+    bool m_bCombineXyz;                     /**< Whether the three orientations of a source are pooled */
+    qint32 m_iNumChannels;                  /**< Number of channels of an incoming block */
+    qint32 m_iNumSources;                   /**< Number of rows of the source estimate */
+    qint32 m_iMaxBlockSize;                 /**< Maximal number of samples per kernel product */
+
+    MatrixXd m_matKernel;                   /**< Imaging kernel; includes the noise normalization unless the orientations are pooled */
+    VectorXi m_vecPick;                     /**< Row of the incoming block for each kernel column */
+    VectorXd m_vecNoiseNorm;                /**< Noise normalization applied after pooling, empty if none */
+    MatrixXd m_matPicked;                   /**< Picked channels of the current block */
+    MatrixXd m_matSol;                      /**< Unpooled solution of the current block */
+    QList<VectorXi> m_qListVertices;        /**< Vertices of the source estimate */
+};
+
+} //NAMESPACE
+
+#endif // RTMINIMUMNORM_H
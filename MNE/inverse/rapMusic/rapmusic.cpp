@@ -41,6 +41,28 @@
 #include "rapmusic.h"
 #include "../sourceestimate.h"
 
+#include <fiff/fiff_evoked.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Eigenvalues>
+#include <Eigen/SVD>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -50,23 +72,389 @@
 using namespace INVERSELIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+typedef Matrix<double, Dynamic, Dynamic, 0, 6, 6> MatrixPair;   /**< Matrix of a grid point pair, stays on the stack */
+typedef Matrix<double, Dynamic, 1, 0, 6, 1> VectorPair;         /**< Vector of a grid point pair, stays on the stack */
+
+static const double RELATIVE_RANK_TOL = 1e-8;  /**< Relative eigenvalue below which a direction is dropped */
+static const double MIN_PAIR_SHARE = 0.1;       /**< Share of the pair direction below which a pair member is not a source */
+
+
+//=============================================================================================================
+/**
+* Returns an orthonormal basis of the column space of p_mat.
+*/
+static MatrixXd orthonormalBasis(const MatrixXd &p_mat)
+{
+    if(p_mat.cols() == 0)
+        return MatrixXd(p_mat.rows(), 0);
+
+    JacobiSVD<MatrixXd> svd(p_mat, ComputeThinU);
+    const VectorXd& sv = svd.singularValues();
+    qint32 rank = 0;
+    while(rank < sv.size() && sv[rank] > RELATIVE_RANK_TOL * sv[0])
+        ++rank;
+    return svd.matrixU().leftCols(rank);
+}
+
+
+//=============================================================================================================
+/**
+* Best pair found by a scan task
+*/
+struct RapMusicPair
+{
+    double correlation;     /**< Subspace correlation */
+    qint32 i;               /**< First grid point */
+    qint32 j;               /**< Second grid point */
+    VectorPair eta;         /**< Direction within the orthonormalized gain of the pair */
+};
+
+
+//=============================================================================================================
+/**
+* Scans the grid point pairs (i, j > i) of every p_iNumTasks-th row i, beginning with p_iTask, for the maximal
+* subspace correlation. Interleaving the rows balances the triangular work between the tasks.
+*/
+class RapMusicScanTask : public QRunnable
+{
+public:
+    RapMusicScanTask(qint32 p_iTask, qint32 p_iNumTasks, qint32 p_iNumOri, const MatrixXd &p_matQ, const VectorXi &p_vecRank, const MatrixXd &p_matB, RapMusicPair &p_Result, QSemaphore &p_Done)
+    : m_iTask(p_iTask)
+    , m_iNumTasks(p_iNumTasks)
+    , m_iNumOri(p_iNumOri)
+    , m_matQ(p_matQ)
+    , m_vecRank(p_vecRank)
+    , m_matB(p_matB)
+    , m_Result(p_Result)
+    , m_Done(p_Done)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        qint32 d = m_iNumOri;
+        qint32 nGrid = m_vecRank.size();
+        SelfAdjointEigenSolver<MatrixPair> gramSolver;
+        SelfAdjointEigenSolver<MatrixPair> corrSolver;
+
+        m_Result.correlation = -1;
+        m_Result.i = -1;
+        m_Result.j = -1;
+
+        for(qint32 i = m_iTask; i < nGrid; i += m_iNumTasks)
+        {
+            qint32 di = m_vecRank[i];
+            if(di == 0)
+                continue;
+
+            for(qint32 j = i+1; j < nGrid; ++j)
+            {
+                qint32 dj = m_vecRank[j];
+                if(dj == 0)
+                    continue;
+                qint32 k = di + dj;
+
+                //
+                //   Gram matrix of the pair; the gains of each grid point are already orthonormal
+                //
+                MatrixPair W = MatrixPair::Identity(k, k);
+                W.block(0, di, di, dj) = m_matQ.middleCols(i*d, di).transpose().lazyProduct(m_matQ.middleCols(j*d, dj));
+                W.block(di, 0, dj, di) = W.block(0, di, di, dj).transpose();
+
+                gramSolver.compute(W);
+                const VectorPair& lambda = gramSolver.eigenvalues();
+                qint32 first = 0;
+                while(first < k && lambda[first] <= RELATIVE_RANK_TOL * lambda[k-1])
+                    ++first;
+                qint32 rank = k - first;
+                if(rank == 0)
+                    continue;
+
+                MatrixPair T = gramSolver.eigenvectors().rightCols(rank);
+                for(qint32 c = 0; c < rank; ++c)
+                    T.col(c) /= std::sqrt(lambda[first+c]);
+
+                //
+                //   Projection of the signal subspace onto the pair
+                //
+                MatrixPair M(k, k);
+                M.block(0, 0, di, di)   = m_matB.middleRows(i*d, di).lazyProduct(m_matB.middleRows(i*d, di).transpose());
+                M.block(0, di, di, dj)  = m_matB.middleRows(i*d, di).lazyProduct(m_matB.middleRows(j*d, dj).transpose());
+                M.block(di, 0, dj, di)  = M.block(0, di, di, dj).transpose();
+                M.block(di, di, dj, dj) = m_matB.middleRows(j*d, dj).lazyProduct(m_matB.middleRows(j*d, dj).transpose());
+
+                MatrixPair S = T.transpose().lazyProduct(M).lazyProduct(T);
+                corrSolver.compute(S);
+                double corr = std::sqrt(std::max(corrSolver.eigenvalues()[rank-1], 0.0));
+
+                if(corr > m_Result.correlation)
+                {
+                    m_Result.correlation = corr;
+                    m_Result.i = i;
+                    m_Result.j = j;
+                    m_Result.eta = T.lazyProduct(corrSolver.eigenvectors().col(rank-1));
+                }
+            }
+        }
+
+        m_Done.release();
+    }
+
+private:
+    qint32 m_iTask;
+    qint32 m_iNumTasks;
+    qint32 m_iNumOri;
+    const MatrixXd& m_matQ;
+    const VectorXi& m_vecRank;
+    const MatrixXd& m_matB;
+    RapMusicPair& m_Result;
+    QSemaphore& m_Done;
+};
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
 RapMusic::RapMusic()
+: m_iN(0)
+, m_dThreshold(0)
+, m_iNumOri(0)
+, m_iNumGridPoints(0)
 {
 }
 
 
 //*************************************************************************************************************
 
-SourceEstimate RapMusic::calculateInverse() const
+RapMusic::RapMusic(const MNEForwardSolution &p_Fwd, qint32 p_iN, double p_dThreshold)
+: m_iN(0)
+, m_dThreshold(0)
+, m_iNumOri(0)
+, m_iNumGridPoints(0)
 {
-    SourceEstimate p_SourceEstimate;
+    this->init(p_Fwd, p_iN, p_dThreshold);
+}
+
+
+//*************************************************************************************************************
+
+bool RapMusic::init(const MNEForwardSolution &p_Fwd, qint32 p_iN, double p_dThreshold)
+{
+    m_iNumGridPoints = 0;
+
+    if(p_Fwd.isEmpty() || !p_Fwd.sol || p_Fwd.sol->data.size() == 0)
+    {
+        qWarning("RapMusic: Forward solution is empty.");
+        return false;
+    }
+    if(p_iN < 1)
+    {
+        qWarning("RapMusic: The signal subspace needs at least one dimension.");
+        return false;
+    }
+
+    m_ForwardSolution = p_Fwd;
+    m_iN = p_iN;
+    m_dThreshold = p_dThreshold;
+    m_iNumOri = m_ForwardSolution.isFixedOrient() ? 1 : 3;
+
+    const MatrixXd& G = m_ForwardSolution.sol->data;
+    m_iNumGridPoints = G.cols() / m_iNumOri;
+
+    m_vecGainNorm.resize(m_iNumGridPoints);
+    for(qint32 i = 0; i < m_iNumGridPoints; ++i)
+        m_vecGainNorm[i] = G.middleCols(i*m_iNumOri, m_iNumOri).squaredNorm();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+SourceEstimate RapMusic::calculateInverse(const FiffEvoked &p_fiffEvoked, bool pick_normal) const
+{
+    Q_UNUSED(pick_normal);
+
+    if(m_iNumGridPoints == 0)
+        return SourceEstimate();
+
+    //
+    //   Pick the channels of the forward solution from the data
+    //
+    FiffEvoked t_fiffEvoked = p_fiffEvoked.pick_channels(m_ForwardSolution.sol->row_names);
+    if(t_fiffEvoked.data.rows() != m_ForwardSolution.sol->data.rows())
+    {
+        qWarning("RapMusic: The data do not contain all channels of the forward solution.");
+        return SourceEstimate();
+    }
+
+    float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
+    float tstep = 1/t_fiffEvoked.info.sfreq;
+
+    QList<RapMusicDipole> t_qListDipoles;
+    return calculateInverse(t_fiffEvoked.data, tmin, tstep, t_qListDipoles);
+}
+
+
+//*************************************************************************************************************
+
+SourceEstimate RapMusic::calculateInverse(const MatrixXd &p_matMeasurement, float p_fTMin, float p_fTStep, QList<RapMusicDipole> &p_qListDipoles) const
+{
+    p_qListDipoles.clear();
+
+    const MatrixXd& G = m_ForwardSolution.sol->data;
+    qint32 nchan = G.rows();
+    qint32 d = m_iNumOri;
+
+    if(m_iNumGridPoints == 0 || p_matMeasurement.rows() != nchan)
+    {
+        qWarning("RapMusic: Not initialized or measurement does not match the forward solution.");
+        return SourceEstimate();
+    }
+
+    //
+    //   Signal subspace: dominant eigenvectors of the data covariance
+    //
+    qint32 r = std::min(m_iN, nchan);
+    SelfAdjointEigenSolver<MatrixXd> t_eigenSolver(p_matMeasurement * p_matMeasurement.transpose());
+    MatrixXd phi_s = t_eigenSolver.eigenvectors().rightCols(r);
+
+    MatrixXd A(nchan, 0);
+    QList<qint32> foundIdx;
+
+    QThreadPool* pool = QThreadPool::globalInstance();
+    qint32 nTasks = std::max(1, std::min(4*pool->maxThreadCount(), m_iNumGridPoints));
+
+    for(qint32 it = 0; it < r; ++it)
+    {
+        //
+        //   Project out the topographies found so far
+        //
+        MatrixXd P = MatrixXd::Identity(nchan, nchan);
+        if(A.cols() > 0)
+        {
+            MatrixXd Qa = orthonormalBasis(A);
+            P -= Qa * Qa.transpose();
+        }
+
+        MatrixXd U_s = orthonormalBasis(P * phi_s);
+        if(U_s.cols() == 0)
+            break;
+
+        MatrixXd Gp = P * G;
+
+        //
+        //   Orthonormalize the projected gain of every grid point; grid points which were projected out get rank 0
+        //
+        MatrixXd Q = MatrixXd::Zero(nchan, G.cols());
+        MatrixXd Tp = MatrixXd::Zero(d, G.cols());
+        VectorXi rank = VectorXi::Zero(m_iNumGridPoints);
+        for(qint32 i = 0; i < m_iNumGridPoints; ++i)
+        {
+            SelfAdjointEigenSolver<MatrixXd> pointSolver(Gp.middleCols(i*d, d).transpose() * Gp.middleCols(i*d, d));
+            const VectorXd& lambda = pointSolver.eigenvalues();
+            qint32 c = 0;
+            for(qint32 e = 0; e < d; ++e)
+            {
+                if(lambda[e] > RELATIVE_RANK_TOL * m_vecGainNorm[i])
+                {
+                    Tp.col(i*d + c) = pointSolver.eigenvectors().col(e) / std::sqrt(lambda[e]);
+                    ++c;
+                }
+            }
+            rank[i] = c;
+            Q.middleCols(i*d, c) = Gp.middleCols(i*d, d) * Tp.middleCols(i*d, c);
+        }
+
+        MatrixXd B = Q.transpose() * U_s;
+
+        //
+        //   Scan all grid point pairs in parallel, idle pool threads take tasks 1..nTasks-1, the caller
+        //   scans task 0 and every task the pool refuses, so this never deadlocks from inside a pool thread
+        //
+        QVector<RapMusicPair> results(nTasks);
+        QSemaphore done(0);
+        for(qint32 t = 1; t < nTasks; ++t)
+        {
+            RapMusicScanTask* task = new RapMusicScanTask(t, nTasks, d, Q, rank, B, results[t], done);
+            if(!pool->tryStart(task))
+            {
+                task->run();
+                delete task;
+            }
+        }
+        RapMusicScanTask task0(0, nTasks, d, Q, rank, B, results[0], done);
+        task0.run();
+        done.acquire(nTasks);
+
+        RapMusicPair best = results[0];
+        for(qint32 t = 1; t < nTasks; ++t)
+            if(results[t].correlation > best.correlation)
+                best = results[t];
+
+        if(best.i < 0 || best.correlation < m_dThreshold)
+            break;
+
+        //
+        //   Map the pair direction back to orientations and append the unprojected topographies. A single source
+        //   scores as well paired with any other grid point; that partner gets a negligible share of eta and is
+        //   dropped. The larger share is at least one half, so one member is always kept.
+        //
+        qint32 idx[2] = {best.i, best.j};
+        qint32 offset = 0;
+        double etaNorm = best.eta.squaredNorm();
+        for(qint32 p = 0; p < 2; ++p)
+        {
+            qint32 rk = rank[idx[p]];
+            VectorXd eta = best.eta.segment(offset, rk);
+            offset += rk;
+
+            if(eta.squaredNorm() < MIN_PAIR_SHARE * etaNorm)
+                continue;
+
+            VectorXd ori = Tp.middleCols(idx[p]*d, rk) * eta;
+            double norm = ori.norm();
+            if(norm == 0)
+                continue;
+            ori /= norm;
+
+            RapMusicDipole dipole;
+            dipole.idx = idx[p];
+            dipole.orientation = ori;
+            dipole.correlation = best.correlation;
+            p_qListDipoles.append(dipole);
+
+            A.conservativeResize(nchan, A.cols()+1);
+            A.col(A.cols()-1) = G.middleCols(idx[p]*d, d) * ori;
+            foundIdx.append(idx[p]);
+        }
+    }
+
+    //
+    //   Time courses of the found dipoles by least squares
+    //
+    MatrixXd sol = MatrixXd::Zero(m_iNumGridPoints, p_matMeasurement.cols());
+    if(A.cols() > 0)
+    {
+        JacobiSVD<MatrixXd> svd(A, ComputeThinU | ComputeThinV);
+        MatrixXd S = svd.solve(p_matMeasurement);
+        for(qint32 k = 0; k < foundIdx.size(); ++k)
+            sol.row(foundIdx[k]) += S.row(k);
+    }
+
+    QList<VectorXi> t_qListVertices;
+    for(qint32 h = 0; h < m_ForwardSolution.src.size(); ++h)
+        t_qListVertices.push_back(m_ForwardSolution.src[h].vertno);
 
-    return p_SourceEstimate;
+    return SourceEstimate(sol, t_qListVertices, p_fTMin, p_fTStep);
 }
 
 
@@ -46,6 +46,16 @@
 
 #include <mne/mne_forwardsolution.h>
 
+#include <QList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -60,29 +70,101 @@ namespace INVERSELIB
 // USED NAMESPACES
 //=============================================================================================================
 
+using namespace Eigen;
 using namespace MNELIB;
 
+
 //=============================================================================================================
 /**
-* RAP MUSIC algorithm ToDo: Paper references.
+* A dipole localized by RAP MUSIC
+*
+* @brief RAP MUSIC dipole
+*/
+struct RapMusicDipole
+{
+    qint32 idx;             /**< Grid point index within the forward solution */
+    VectorXd orientation;   /**< Unit orientation (1 component for fixed, 3 for free orientations) */
+    double correlation;     /**< Subspace correlation of the dipole pair it was found with */
+};
+
+
+//=============================================================================================================
+/**
+* Recursively applied and projected MUSIC (Mosher and Leahy, IEEE Trans. Signal Process. 47(2), 1999).
+* Each recursion scans all pairs of grid points of the forward solution for the maximal subspace correlation
+* with the signal subspace of the data, after projecting out the topographies found so far. Scanning pairs
+* localizes synchronous sources; the O(N^2) pair scan is distributed over the global thread pool.
 *
 * @brief RAP MUSIC
 */
 class INVERSESHARED_EXPORT RapMusic : public IInverseAlgorithm
 {
 public:
+    //=========================================================================================================
+    /**
+    * Default constructor. init() has to be called before an inverse can be calculated.
+    */
     RapMusic();
 
+    //=========================================================================================================
+    /**
+    * Constructs RAP MUSIC on the given forward solution.
+    *
+    * @param[in] p_Fwd          The forward solution which is scanned
+    * @param[in] p_iN           Dimension of the signal subspace, i.e. maximal number of recursions
+    * @param[in] p_dThreshold   Subspace correlation below which the recursion stops
+    */
+    RapMusic(const MNEForwardSolution &p_Fwd, qint32 p_iN = 2, double p_dThreshold = 0.5);
+
     virtual ~RapMusic(){}
 
-    virtual SourceEstimate calculateInverse() const;
+    //=========================================================================================================
+    /**
+    * Initializes RAP MUSIC on the given forward solution.
+    *
+    * @param[in] p_Fwd          The forward solution which is scanned
+    * @param[in] p_iN           Dimension of the signal subspace, i.e. maximal number of recursions
+    * @param[in] p_dThreshold   Subspace correlation below which the recursion stops
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool init(const MNEForwardSolution &p_Fwd, qint32 p_iN = 2, double p_dThreshold = 0.5);
+
+    //=========================================================================================================
+    /**
+    * Localizes the sources of the evoked data. The channels of the forward solution are picked from the data.
+    *
+    * @param[in] p_fiffEvoked   Evoked data.
+    * @param[in] pick_normal    Not used by RAP MUSIC.
+    *
+    * @return the source estimate, holding the time courses of the found dipoles
+    */
+    virtual SourceEstimate calculateInverse(const FiffEvoked &p_fiffEvoked, bool pick_normal = false) const;
+
+    //=========================================================================================================
+    /**
+    * Localizes the sources of the measurement.
+    *
+    * @param[in] p_matMeasurement   Measurement (channels of the forward solution x samples)
+    * @param[in] p_fTMin            Time of the first sample in seconds
+    * @param[in] p_fTStep           Time between two samples in seconds
+    * @param[out] p_qListDipoles    The found dipoles, one or two per recursion
+    *
+    * @return the source estimate, holding the time courses of the found dipoles
+    */
+    SourceEstimate calculateInverse(const MatrixXd &p_matMeasurement, float p_fTMin, float p_fTStep, QList<RapMusicDipole> &p_qListDipoles) const;
 
     virtual const char* getName() const;
 
     virtual const MNESourceSpace& getSourceSpace() const;
 
 private:
-    MNEForwardSolution m_ForwardSolution; /**< The Forward operator which should be scanned through*/
+    MNEForwardSolution m_ForwardSolution;   /**< The Forward operator which should be scanned through*/
+    qint32 m_iN;                            /**< Dimension of the signal subspace */
+    double m_dThreshold;                    /**< Subspace correlation threshold */
+    qint32 m_iNumOri;                       /**< Number of gain columns per grid point: 1 fixed, 3 free */
+    qint32 m_iNumGridPoints;                /**< Number of grid points */
+    VectorXd m_vecGainNorm;                 /**< Squared norm of the gain of each grid point */
 };
 
 } //NAMESPACE
@@ -130,6 +130,24 @@ public:
         return MNEMath::combine_xyz(vec);
     }
 
+    //=========================================================================================================
+    /**
+    * mne_combine_xyz for a whole solution matrix
+    *
+    * Wrapper for the MNEMath::combine_xyz static function
+    *
+    * Compute the three Cartesian components of each column together
+    *
+    * @param[in] mat    Input matrix with rows [ x1 y1 z1 ... x_n y_n z_n ]
+    * @param[out] out   Output matrix with rows [x1^2+y1^2+z1^2 ... x_n^2+y_n^2+z_n^2 ]
+    *
+    * @return true if succeeded, false otherwise
+    */
+    inline static bool combine_xyz(const MatrixXd& mat, MatrixXd& out)
+    {
+        return MNEMath::combine_xyz(mat, out);
+    }
+
     //=========================================================================================================
     /**
     * mne_block_diag - decoding part
@@ -41,6 +41,14 @@
 #include "mne_epoch_data_list.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QPair>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -70,3 +78,58 @@ MNEEpochDataList::~MNEEpochDataList()
 //            delete (*i);
 //    }
 }
+
+
+//*************************************************************************************************************
+
+MNEEpochDataList MNEEpochDataList::readEpochs(FiffRawData& raw, const MatrixXi& events, float tmin, float tmax, qint32 event, const RowVectorXi& picks)
+{
+    MNEEpochDataList data;
+
+    //
+    //    Select the desired events and set up the windows
+    //
+    QList<qint32> selected;
+    QList<QPair<fiff_int_t,fiff_int_t> > windows;
+    for (qint32 p = 0; p < events.rows(); ++p)
+    {
+        if (events(p,1) == 0 && events(p,2) == event)
+        {
+            fiff_int_t event_samp = events(p,0);
+            fiff_int_t from = event_samp + tmin*raw.info.sfreq;
+            fiff_int_t to   = event_samp + floor(tmax*raw.info.sfreq + 0.5);
+            selected.append(p);
+            windows.append(qMakePair(from, to));
+        }
+    }
+
+    if (selected.size() == 0)
+    {
+        printf("No desired events found.\n");
+        return data;
+    }
+    printf("%d matching events found\n",selected.size());
+
+    //
+    //   Read all segments at once
+    //
+    QList<MatrixXd> segments;
+    if(!raw.read_raw_segments(segments, windows, picks))
+    {
+        printf("Can't read the event data segments\n");
+        return data;
+    }
+
+    for (qint32 p = 0; p < segments.size(); ++p)
+    {
+        MNEEpochData* epoch = new MNEEpochData();
+        epoch->epoch = segments[p];
+        epoch->event = event;
+        epoch->tmin = ((float)(windows[p].first)-(float)(raw.first_samp))/raw.info.sfreq;
+        epoch->tmax = ((float)(windows[p].second)-(float)(raw.first_samp))/raw.info.sfreq;
+
+        data.append(MNEEpochData::SPtr(epoch));//List takes ownwership of the pointer - no delete need
+    }
+
+    return data;
+}
@@ -51,6 +51,14 @@
 #include "mne_epoch_data.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFF INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_raw_data.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // Qt INCLUDES
@@ -73,6 +81,8 @@ namespace MNELIB
 // USED NAMESPACES
 //=============================================================================================================
 
+using namespace FIFFLIB;
+
 
 //=============================================================================================================
 /**
@@ -98,6 +108,22 @@ public:
     */
     ~MNEEpochDataList();
 
+    //=========================================================================================================
+    /**
+    * Reads the epochs around all events of the given type. All segments are read in one pass through
+    * FiffRawData::read_raw_segments, which decodes the buffers in parallel.
+    *
+    * @param[in] raw        the raw data to read the epochs from
+    * @param[in] events     the events (sample, before, after) as read by MNE::read_events
+    * @param[in] tmin       start time of an epoch relative to its event in seconds
+    * @param[in] tmax       end time of an epoch relative to its event in seconds
+    * @param[in] event      the event type to select
+    * @param[in] picks      channel selection vector (optional)
+    *
+    * @return the epochs, empty if no matching event was found or reading failed
+    */
+    static MNEEpochDataList readEpochs(FiffRawData& raw, const MatrixXi& events, float tmin, float tmax, qint32 event, const RowVectorXi& picks = defaultRowVectorXi);
+
 };
 
 } // NAMESPACE
@@ -337,6 +337,11 @@ void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t&
         qint32 nSamples = (t_pTag->size()/4)/p_nChannels;
         data = MatrixXf(Map< MatrixXf >(t_pTag->toFloat(), p_nChannels, nSamples));
     }
+    else if(kind == FIFF_MNE_RT_DATA_BUFFER)
+    {
+        if(FiffRtCodec::decode(t_pTag->data(), t_pTag->size(), data))
+            kind = FIFF_DATA_BUFFER;
+    }
 //        else
 //            data = tag.data;
 }
@@ -350,3 +355,39 @@ void RtDataClient::setClientAlias(const QString &p_sAlias)
     t_fiffStream.write_rt_command(2, p_sAlias);//MNE_RT.MNE_RT_SET_CLIENT_ALIAS, alias);
     this->flush();
 }
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setEncoding(const QString &p_sMethod, const RowVectorXi &p_vecPicks)
+{
+    QString t_sEncoding(p_sMethod);
+    for(qint32 i = 0; i < p_vecPicks.size(); ++i)
+        t_sEncoding.append(QString(i > 0 ? ",%1" : " %1").arg(p_vecPicks[i]));
+
+    FiffStream t_fiffStream(this);
+    t_fiffStream.write_rt_command(3, t_sEncoding);//MNE_RT.MNE_RT_SET_ENCODING, encoding);
+    this->flush();
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setSubscription(const RowVectorXi &p_vecPicks, qint32 p_iDecimation)
+{
+    QString t_sSubscription = QString::number(p_iDecimation);
+    for(qint32 i = 0; i < p_vecPicks.size(); ++i)
+        t_sSubscription.append(QString(i > 0 ? ",%1" : " %1").arg(p_vecPicks[i]));
+
+    FiffStream t_fiffStream(this);
+    t_fiffStream.write_rt_command(4, t_sSubscription);//MNE_RT.MNE_RT_SET_SUBSCRIPTION, subscription);
+    this->flush();
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setSubscription(const QStringList &p_qListChNames, const FiffInfo &p_fiffInfo, qint32 p_iDecimation)
+{
+    setSubscription(FiffInfo::pick_channels(p_fiffInfo.ch_names, p_qListChNames), p_iDecimation);
+}
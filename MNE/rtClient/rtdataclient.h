@@ -54,6 +54,7 @@
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_info.h>
 #include <fiff/fiff_tag.h>
+#include <fiff/fiff_rt_codec.h>
 
 
 //*************************************************************************************************************
@@ -63,6 +64,7 @@
 
 #include <QSharedPointer>
 #include <QString>
+#include <QStringList>
 #include <QTcpSocket>
 
 
@@ -130,7 +132,8 @@ public:
 
     //=========================================================================================================
     /**
-    * Reads fiff measurement information of a data the connection
+    * Reads a raw buffer from the connection. Buffers which were encoded according to setEncoding are decoded
+    * transparently and reported as FIFF_DATA_BUFFER; channels which are not streamed are zero.
     *
     * @param[in] p_nChannels    Number of channels to reshape the received data
     * @param[out] data          The read data - ToDo change this to raw buffer data object
@@ -146,6 +149,37 @@ public:
     */
     void setClientAlias(const QString &p_sAlias);
 
+    //=========================================================================================================
+    /**
+    * Requests the encoding of the raw buffers sent to this data client, e.g. for constrained links.
+    *
+    * @param[in] p_sMethod  "float" (default), "int16" (16 bit with per channel scale) or "delta" (int16 delta
+    *                       and Rice coded)
+    * @param[in] p_vecPicks The channels to stream; empty for all channels
+    */
+    void setEncoding(const QString &p_sMethod, const RowVectorXi &p_vecPicks = RowVectorXi());
+
+    //=========================================================================================================
+    /**
+    * Subscribes to a channel selection decimated by an integer factor. mne_rt_server low-pass filters and
+    * decimates once per distinct subscription. The measurement info has to be requested after subscribing;
+    * it then describes the subscribed channels and sample frequency.
+    *
+    * @param[in] p_vecPicks     The subscribed channels, e.g. from FiffInfo::pick_channels; empty for all channels
+    * @param[in] p_iDecimation  The integer decimation factor, 1 for the full rate
+    */
+    void setSubscription(const RowVectorXi &p_vecPicks, qint32 p_iDecimation = 1);
+
+    //=========================================================================================================
+    /**
+    * Subscribes to the named channels decimated by an integer factor.
+    *
+    * @param[in] p_qListChNames The subscribed channel names
+    * @param[in] p_fiffInfo     The measurement info of the full stream to resolve the names with
+    * @param[in] p_iDecimation  The integer decimation factor, 1 for the full rate
+    */
+    void setSubscription(const QStringList &p_qListChNames, const FiffInfo &p_fiffInfo, qint32 p_iDecimation = 1);
+
 private:
     qint32 m_clientID;  /**< Corresponding client id of the data client at mne_rt_server */
 
@@ -76,10 +76,12 @@ RtAve::RtAve(quint32 p_iPreStimSamples, quint32 p_iPostStimSamples, FiffInfo::SP
 , m_iPreStimSamples(p_iPreStimSamples)
 , m_iPostStimSamples(p_iPostStimSamples)
 , m_pFiffInfo(p_pFiffInfo)
-, m_bIsRunning(false)
+, m_bIsRunning(0)
+, m_pRawMatrixBuffer(new BroadcastMatrixBuffer<double>(128))
 , m_bAutoAspect(true)
 {
     qRegisterMetaType<FiffEvoked::SPtr>("FiffEvoked::SPtr");
+    m_iReader = m_pRawMatrixBuffer->attach();
 }
 
 
@@ -95,42 +97,48 @@ RtAve::~RtAve()
 
 void RtAve::append(const MatrixXd &p_DataSegment)
 {
-//    if(m_pRawMatrixBuffer) // ToDo handle change buffersize
+    m_pRawMatrixBuffer->push(&p_DataSegment);
+}
 
-    if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(128, p_DataSegment.rows(), p_DataSegment.cols()));
 
-    m_pRawMatrixBuffer->push(&p_DataSegment);
+//*************************************************************************************************************
+
+void RtAve::setRawBuffer(const BroadcastMatrixBuffer<double>::SPtr &p_pRawMatrixBuffer)
+{
+    m_pRawMatrixBuffer->detach(m_iReader);
+
+    m_pRawMatrixBuffer = p_pRawMatrixBuffer;
+    m_iReader = m_pRawMatrixBuffer->attach();
 }
 
 
 //*************************************************************************************************************
 
-void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > &p_qListRawMatBuf, qint32 p_iStimIdx, MatrixXd &p_matPostStim)
 {
-    if(m_iPreStimSamples > 0)
+    if(m_iPostStimSamples > 0)
     {
         // middle of the assembled buffers
         qint32 t_iMidIdx = p_qListRawMatBuf.size()/2;
 
-        qint32 nrows = p_qListRawMatBuf[t_iMidIdx].second.rows();
-        qint32 ncols = p_qListRawMatBuf[t_iMidIdx].second.cols();
+        qint32 nrows = p_qListRawMatBuf[t_iMidIdx].second->rows();
+        qint32 ncols = p_qListRawMatBuf[t_iMidIdx].second->cols();
 
         //Stimulus channel row
         qint32 t_iRowIdx = m_qListStimChannelIdcs[p_iStimIdx];
 
 //        std::cout << t_iRowIdx
-//                     << ": " << p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx) << std::endl;
+//                     << ": " << p_qListRawMatBuf[t_iMidIdx].second->row(t_iRowIdx) << std::endl;
 
         qint32 nSampleCount = 0;
 
-        MatrixXd t_matPostStim(nrows, m_iPostStimSamples);
+        MatrixXd& t_matPostStim = p_matPostStim;
         qint32 t_curBufIdx = t_iMidIdx;
 
         qint32 t_iSize = 0;
 
         qint32 pos = 0;
-        p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx).maxCoeff(&pos);
+        p_qListRawMatBuf[t_iMidIdx].second->row(t_iRowIdx).maxCoeff(&pos);
 //        std::cout << "Position: " << pos << std::endl;
 
         //
@@ -143,14 +151,14 @@ void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p
             t_iSize = ncols - pos;
             if(t_iSize <= m_iPostStimSamples)
             {
-                t_matPostStim.block(0, 0, nrows, t_iSize) = p_qListRawMatBuf[t_iMidIdx].second.block(0, pos, nrows, t_iSize);
+                t_matPostStim.block(0, 0, nrows, t_iSize) = p_qListRawMatBuf[t_iMidIdx].second->block(0, pos, nrows, t_iSize);
                 nSampleCount += t_iSize;
 
 //                qDebug() << "t_matPostStim.block" << nSampleCount;
             }
             else
             {
-                t_matPostStim.block(0, 0, nrows, m_iPostStimSamples) = p_qListRawMatBuf[t_iMidIdx].second.block(0, pos, nrows, m_iPostStimSamples);
+                t_matPostStim.block(0, 0, nrows, m_iPostStimSamples) = p_qListRawMatBuf[t_iMidIdx].second->block(0, pos, nrows, m_iPostStimSamples);
                 nSampleCount = m_iPostStimSamples;
 
 //                qDebug() << "t_matPostStim.block" << nSampleCount;
@@ -166,12 +174,12 @@ void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p
 
             if(ncols <= t_iSize)
             {
-                t_matPostStim.block(0, nSampleCount, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, ncols);
+                t_matPostStim.block(0, nSampleCount, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second->block(0, 0, nrows, ncols);
                 nSampleCount += ncols;
             }
             else
             {
-                t_matPostStim.block(0, nSampleCount, nrows, t_iSize) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, t_iSize);
+                t_matPostStim.block(0, nSampleCount, nrows, t_iSize) = p_qListRawMatBuf[t_curBufIdx].second->block(0, 0, nrows, t_iSize);
                 nSampleCount = m_iPostStimSamples;
             }
 
@@ -179,42 +187,37 @@ void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p
 
 //            qDebug() << "Sample count" << nSampleCount;
         }
-
-        //
-        //Store in right post stimulus buffer vector
-        //
-        m_qListQVectorPostStimBuf[p_iStimIdx].append(t_matPostStim);
     }
 }
 
 
 //*************************************************************************************************************
 
-void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > &p_qListRawMatBuf, qint32 p_iStimIdx, MatrixXd &p_matPreStim)
 {
     if(m_iPreStimSamples > 0)
     {
         // middle of the assembled buffers
         qint32 t_iMidIdx = p_qListRawMatBuf.size()/2;
 
-        qint32 nrows = p_qListRawMatBuf[t_iMidIdx].second.rows();
-        qint32 ncols = p_qListRawMatBuf[t_iMidIdx].second.cols();
+        qint32 nrows = p_qListRawMatBuf[t_iMidIdx].second->rows();
+        qint32 ncols = p_qListRawMatBuf[t_iMidIdx].second->cols();
 
         //Stimulus channel row
         qint32 t_iRowIdx = m_qListStimChannelIdcs[p_iStimIdx];
 
 //        std::cout << t_iRowIdx
-//                     << ": " << p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx) << std::endl;
+//                     << ": " << p_qListRawMatBuf[t_iMidIdx].second->row(t_iRowIdx) << std::endl;
 
         qint32 nSampleCount = m_iPreStimSamples;
 
-        MatrixXd t_matPreStim(nrows, m_iPreStimSamples);
+        MatrixXd& t_matPreStim = p_matPreStim;
         qint32 t_curBufIdx = t_iMidIdx;
 
         qint32 t_iStart = 0;
 
         qint32 pos = 0;
-        p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx).maxCoeff(&pos);
+        p_qListRawMatBuf[t_iMidIdx].second->row(t_iRowIdx).maxCoeff(&pos);
 //        std::cout << "Position: " << pos << std::endl;
 
         //
@@ -227,14 +230,14 @@ void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_
             t_iStart = m_iPreStimSamples - pos;
             if(t_iStart >= 0)
             {
-                t_matPreStim.block(0, t_iStart, nrows, pos) = p_qListRawMatBuf[t_iMidIdx].second.block(0, 0, nrows, pos);
+                t_matPreStim.block(0, t_iStart, nrows, pos) = p_qListRawMatBuf[t_iMidIdx].second->block(0, 0, nrows, pos);
                 nSampleCount -= pos;
 
 //                qDebug() << "t_matPreStim.block" << nSampleCount;
             }
             else
             {
-                t_matPreStim.block(0, 0, nrows, m_iPreStimSamples) = p_qListRawMatBuf[t_iMidIdx].second.block(0, -t_iStart, nrows, m_iPreStimSamples);
+                t_matPreStim.block(0, 0, nrows, m_iPreStimSamples) = p_qListRawMatBuf[t_iMidIdx].second->block(0, -t_iStart, nrows, m_iPreStimSamples);
                 nSampleCount = 0;
 
 //                qDebug() << "t_matPreStim.block" << nSampleCount;
@@ -250,12 +253,12 @@ void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_
 
             if(t_iStart >= 0)
             {
-                t_matPreStim.block(0, t_iStart, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, ncols);
+                t_matPreStim.block(0, t_iStart, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second->block(0, 0, nrows, ncols);
                 nSampleCount -= ncols;
             }
             else
             {
-                t_matPreStim.block(0, 0, nrows, nSampleCount) = p_qListRawMatBuf[t_curBufIdx].second.block(0, -t_iStart, nrows, nSampleCount);
+                t_matPreStim.block(0, 0, nrows, nSampleCount) = p_qListRawMatBuf[t_curBufIdx].second->block(0, -t_iStart, nrows, nSampleCount);
                 nSampleCount = 0;
             }
 
@@ -263,21 +266,97 @@ void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_
 
 //            qDebug() << "Sample count" << nSampleCount;
         }
+    }
+}
 
-        //
-        //Store in right pre stimulus buffer vector
-        //
-        m_qListQVectorPreStimBuf[p_iStimIdx].append(t_matPreStim);
+
+//*************************************************************************************************************
+
+void RtAve::updateAverage(const QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+{
+    qint32 nrows = p_qListRawMatBuf[p_qListRawMatBuf.size()/2].second->rows();
+    qint32 pos = m_qListRingPos[p_iStimIdx];
+
+    MatrixXd& t_matPreSlot = m_qListQVectorPreStimBuf[p_iStimIdx][pos];
+    MatrixXd& t_matPostSlot = m_qListQVectorPostStimBuf[p_iStimIdx][pos];
+    MatrixXd& t_matPreSum = m_qListPreStimSum[p_iStimIdx];
+    MatrixXd& t_matPostSum = m_qListPostStimSum[p_iStimIdx];
+
+    //
+    // Slots and sums are allocated with the first epoch only
+    //
+    if(t_matPreSum.rows() != nrows)
+    {
+        t_matPreSum = MatrixXd::Zero(nrows, m_iPreStimSamples);
+        t_matPostSum = MatrixXd::Zero(nrows, m_iPostStimSamples);
+    }
+    if(t_matPreSlot.rows() != nrows)
+    {
+        t_matPreSlot = MatrixXd::Zero(nrows, m_iPreStimSamples);
+        t_matPostSlot = MatrixXd::Zero(nrows, m_iPostStimSamples);
+    }
+
+    //
+    // Evict the oldest epoch
+    //
+    if(m_qListRingFill[p_iStimIdx] == m_iNumAverages)
+    {
+        t_matPreSum -= t_matPreSlot;
+        t_matPostSum -= t_matPostSlot;
+    }
+    else
+        ++m_qListRingFill[p_iStimIdx];
+
+    //
+    // Assemble the new epoch into its slot and add it
+    //
+    this->assemblePreStimulus(p_qListRawMatBuf, p_iStimIdx, t_matPreSlot);
+    this->assemblePostStimulus(p_qListRawMatBuf, p_iStimIdx, t_matPostSlot);
+
+    t_matPreSum += t_matPreSlot;
+    t_matPostSum += t_matPostSlot;
+
+    pos = (pos + 1) % m_iNumAverages;
+    m_qListRingPos[p_iStimIdx] = pos;
+
+    //
+    // Recompute the sums once per ring cycle to keep the rounding errors of the add/subtract updates bounded
+    //
+    if(pos == 0 && m_qListRingFill[p_iStimIdx] == m_iNumAverages)
+    {
+        t_matPreSum = m_qListQVectorPreStimBuf[p_iStimIdx][0];
+        t_matPostSum = m_qListQVectorPostStimBuf[p_iStimIdx][0];
+        for(qint32 j = 1; j < m_iNumAverages; ++j)
+        {
+            t_matPreSum += m_qListQVectorPreStimBuf[p_iStimIdx][j];
+            t_matPostSum += m_qListQVectorPostStimBuf[p_iStimIdx][j];
+        }
     }
 }
 
 
+//*************************************************************************************************************
+
+bool RtAve::start()
+{
+    m_bIsRunning.fetchAndStoreOrdered(1);
+
+    QThread::start();
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 bool RtAve::stop()
 {
-    m_bIsRunning = false;
+    m_bIsRunning.fetchAndStoreOrdered(0);
+
+    // wake run() if it waits for data and attach again for a restart
+    m_pRawMatrixBuffer->detach(m_iReader);
     QThread::wait();
+    m_iReader = m_pRawMatrixBuffer->attach();
 
     return true;
 }
@@ -287,22 +366,22 @@ bool RtAve::stop()
 
 void RtAve::run()
 {
-    m_bIsRunning = true;
-
-
     //
     // Inits & Clears
     //
     quint32 t_nSamplesPerBuf = 0;
-    QList<QPair<QList<qint32>, MatrixXd> > t_qListRawMatBuf;
+    QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > t_qListRawMatBuf;
 
     FiffEvoked::SPtr evoked(new FiffEvoked());
     VectorXd mu;
     qint32 i = 0;
-    qint32 j = 0;
 
     m_qListQVectorPreStimBuf.clear();
     m_qListQVectorPostStimBuf.clear();
+    m_qListRingPos.clear();
+    m_qListRingFill.clear();
+    m_qListPreStimSum.clear();
+    m_qListPostStimSum.clear();
     m_qListPreStimAve.clear();
     m_qListPostStimAve.clear();
     m_qListStimAve.clear();
@@ -312,7 +391,7 @@ void RtAve::run()
     //
     m_qListStimChannelIdcs.clear();
     MatrixXd t_mat;
-    QVector<MatrixXd> t_qVecMat;
+    QVector<MatrixXd> t_qVecMat(m_iNumAverages);
     for(i = 0; i < m_pFiffInfo->nchan; ++i)
     {
         if(m_pFiffInfo->chs[i].kind == FIFFV_STIM_CH && (m_pFiffInfo->chs[i].ch_name != QString("STI 014")))
@@ -321,6 +400,10 @@ void RtAve::run()
 
             m_qListQVectorPreStimBuf.push_back(t_qVecMat);
             m_qListQVectorPostStimBuf.push_back(t_qVecMat);
+            m_qListRingPos.push_back(0);
+            m_qListRingFill.push_back(0);
+            m_qListPreStimSum.push_back(t_mat);
+            m_qListPostStimSum.push_back(t_mat);
             m_qListPreStimAve.push_back(t_mat);
             m_qListPostStimAve.push_back(t_mat);
             m_qListStimAve.push_back(t_mat);
@@ -370,142 +453,119 @@ void RtAve::run()
     qint32 count = 0;
 
     //Enter the main loop
-    while(m_bIsRunning)
+    while(m_bIsRunning.load())
     {
-        if(m_pRawMatrixBuffer)
+        //
+        // Acquire Data
+        //
+        BroadcastMatrixBuffer<double>::Block t_pRawSegment = m_pRawMatrixBuffer->pop(m_iReader);
+        if(!t_pRawSegment)
+            continue;
+
+        //epochs can't be assembled across lost buffers
+        if(m_pRawMatrixBuffer->dropped(m_iReader) > 0)
         {
-            //
-            // Acquire Data
-            //
-            MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
-            if(t_nSamplesPerBuf == 0)
-                t_nSamplesPerBuf = rawSegment.cols();
+            qWarning("RtAve: raw buffers dropped, averaging is too slow.");
+            t_qListRawMatBuf.clear();
+        }
 
-            ++count;
+        const MatrixXd &rawSegment = *t_pRawSegment;
+        if(t_nSamplesPerBuf == 0)
+            t_nSamplesPerBuf = rawSegment.cols();
 
-            //
-            // Detect Stimuli
-            //
-            QList<qint32> t_qListStimuli;
-            for(i = 0; i < m_qListStimChannelIdcs.size(); ++i)
-            {
-                qint32 idx = m_qListStimChannelIdcs[i];
-                RowVectorXi stimSegment = rawSegment.row(idx).cast<int>();
-                int iMax = stimSegment.maxCoeff();
+        ++count;
 
-                if(iMax > 0)
-                    t_qListStimuli.append(i);
-            }
+        //
+        // Detect Stimuli
+        //
+        QList<qint32> t_qListStimuli;
+        for(i = 0; i < m_qListStimChannelIdcs.size(); ++i)
+        {
+            qint32 idx = m_qListStimChannelIdcs[i];
+            RowVectorXi stimSegment = rawSegment.row(idx).cast<int>();
+            int iMax = stimSegment.maxCoeff();
+
+            if(iMax > 0)
+                t_qListStimuli.append(i);
+        }
 
+        //
+        // Store
+        //
+        t_qListRawMatBuf.push_back(qMakePair(t_qListStimuli, t_pRawSegment));
+
+        if(t_nSamplesPerBuf*t_qListRawMatBuf.size() > (m_iPreStimSamples+m_iPostStimSamples + (2 * t_nSamplesPerBuf)))
+        {
             //
-            // Store
+            // Average
             //
-            t_qListRawMatBuf.push_back(qMakePair(t_qListStimuli, rawSegment));
-
-            if(t_nSamplesPerBuf*t_qListRawMatBuf.size() > (m_iPreStimSamples+m_iPostStimSamples + (2 * t_nSamplesPerBuf)))
-            {
-                //
-                // Average
-                //
 //                qDebug() << t_qListRawMatBuf.size()/2;
 //                qDebug() << (float)(m_iPreStimSamples + t_nSamplesPerBuf)/((float)t_nSamplesPerBuf);
-                qint32 t_iMidIdx = t_qListRawMatBuf.size()/2;
+            qint32 t_iMidIdx = t_qListRawMatBuf.size()/2;
 
-                if(t_iMidIdx > 0 && t_qListRawMatBuf[t_iMidIdx].first.size() != 0)
+            if(t_iMidIdx > 0 && t_qListRawMatBuf[t_iMidIdx].first.size() != 0)
+            {
+                for(i = 0; i < t_qListRawMatBuf[t_iMidIdx].first.size(); ++i)
                 {
-                    for(i = 0; i < t_qListRawMatBuf[t_iMidIdx].first.size(); ++i)
+                    if(!t_qListRawMatBuf[t_iMidIdx-1].first.contains(t_qListRawMatBuf[t_iMidIdx].first[i]))//make sure that previous buffer does not conatin this stim - prevent multiple detection
                     {
-                        if(!t_qListRawMatBuf[t_iMidIdx-1].first.contains(t_qListRawMatBuf[t_iMidIdx].first[i]))//make sure that previous buffer does not conatin this stim - prevent multiple detection
-                        {
-                            qint32 t_iStimIndex = t_qListRawMatBuf[t_iMidIdx].first[i];
+                        qint32 t_iStimIndex = t_qListRawMatBuf[t_iMidIdx].first[i];
 
-                            //
-                            // assemble prestimulus
-                            //
-                            this->assemblePreStimulus(t_qListRawMatBuf, t_iStimIndex);
+                        //
+                        // store the epoch and update the running sums
+                        //
+                        this->updateAverage(t_qListRawMatBuf, t_iStimIndex);
 
+                        //if averages are available -> ring is filled
+                        if(m_qListRingFill[t_iStimIndex] == m_iNumAverages)
+                        {
                             //
-                            // assemble poststimulus
+                            // Pre- and poststimulus average
                             //
-                            this->assemblePostStimulus(t_qListRawMatBuf, t_iStimIndex);
+                            m_qListPreStimAve[t_iStimIndex] = m_qListPreStimSum[t_iStimIndex] / (double)m_iNumAverages;
+                            m_qListPostStimAve[t_iStimIndex] = m_qListPostStimSum[t_iStimIndex] / (double)m_iNumAverages;
+
+                            qDebug() << "Average" << t_iStimIndex;
 
-//                            qDebug() << "Buffers of pre-stimulus" << t_iStimIndex << ":" << m_qListQVectorPreStimBuf[t_iStimIndex].size();
                             //
-                            // Prestimulus average
+                            // concatenate pre + post stimulus to full stimulus
                             //
-                            if(m_qListQVectorPreStimBuf[t_iStimIndex].size() >= m_iNumAverages)
-                            {
-                                m_qListPreStimAve[t_iStimIndex] = m_qListQVectorPreStimBuf[t_iStimIndex][0];
-                                for(j = 1; j < m_qListQVectorPreStimBuf[t_iStimIndex].size(); ++j)
-                                    m_qListPreStimAve[t_iStimIndex] += m_qListQVectorPreStimBuf[t_iStimIndex][j];
-
-                                m_qListPreStimAve[t_iStimIndex].array() /= (double)m_iNumAverages;
-
-                                m_qListQVectorPreStimBuf[t_iStimIndex].pop_front();
-
-                                qDebug() << "Pre-stim average" << t_iStimIndex;
-                            }
+                            if(m_qListStimAve[t_iStimIndex].rows() != m_qListPreStimAve[t_iStimIndex].rows() || m_qListStimAve[t_iStimIndex].cols() != m_qListPreStimAve[t_iStimIndex].cols() + m_qListPostStimAve[t_iStimIndex].cols())
+                                m_qListStimAve[t_iStimIndex].resize(m_qListPreStimAve[t_iStimIndex].rows(), m_qListPreStimAve[t_iStimIndex].cols() + m_qListPostStimAve[t_iStimIndex].cols());
+                            // Pre
+                            m_qListStimAve[t_iStimIndex].block(0,0,m_qListPreStimAve[t_iStimIndex].rows(),m_qListPreStimAve[t_iStimIndex].cols()) = m_qListPreStimAve[t_iStimIndex];
+                            // Post
+                            m_qListStimAve[t_iStimIndex].block(0,m_qListPreStimAve[t_iStimIndex].cols(),m_qListPostStimAve[t_iStimIndex].rows(),m_qListPostStimAve[t_iStimIndex].cols()) = m_qListPostStimAve[t_iStimIndex];
 
 
-//                            qDebug() << "Buffers of post-stimulus" << t_iStimIndex << ":" << m_qListQVectorPostStimBuf[t_iStimIndex].size();
                             //
-                            // Poststimulus average
+                            // Emit evoked
                             //
-                            if(m_qListQVectorPostStimBuf[t_iStimIndex].size() >= m_iNumAverages)
-                            {
-                                m_qListPostStimAve[t_iStimIndex] = m_qListQVectorPostStimBuf[t_iStimIndex][0];
-                                for(j = 1; j < m_qListQVectorPostStimBuf[t_iStimIndex].size(); ++j)
-                                    m_qListPostStimAve[t_iStimIndex] += m_qListQVectorPostStimBuf[t_iStimIndex][j];
-
-                                m_qListPostStimAve[t_iStimIndex].array() /= (double)m_iNumAverages;
-
-                                m_qListQVectorPostStimBuf[t_iStimIndex].pop_front();
-
-                                qDebug() << "Post-stim average" << t_iStimIndex;
-                            }
-
-                            //if averages are available -> buffers are filled and first average is stored
-                            if(m_qListPreStimAve[t_iStimIndex].size() > 0)
-                            {
-                                //
-                                // concatenate pre + post stimulus to full stimulus
-                                //
-                                m_qListStimAve[t_iStimIndex].resize(m_qListPreStimAve[t_iStimIndex].rows(), m_qListPreStimAve[t_iStimIndex].cols() + m_qListPostStimAve[t_iStimIndex].cols());
-                                // Pre
-                                m_qListStimAve[t_iStimIndex].block(0,0,m_qListPreStimAve[t_iStimIndex].rows(),m_qListPreStimAve[t_iStimIndex].cols()) = m_qListPreStimAve[t_iStimIndex];
-                                // Post
-                                m_qListStimAve[t_iStimIndex].block(0,m_qListPreStimAve[t_iStimIndex].cols(),m_qListPostStimAve[t_iStimIndex].rows(),m_qListPostStimAve[t_iStimIndex].cols()) = m_qListPostStimAve[t_iStimIndex];
-
-
-                                //
-                                // Emit evoked
-                                //
-                                FiffEvoked::SPtr t_pEvokedPreStim(new FiffEvoked(t_preStimEvoked));
-                                t_pEvokedPreStim->comment = QString("Stim %1").arg(t_iStimIndex);
-                                t_pEvokedPreStim->data = m_qListPreStimAve[t_iStimIndex];
-                                emit evokedPreStim(t_pEvokedPreStim);
-
-                                FiffEvoked::SPtr t_pEvokedPostStim(new FiffEvoked(t_postStimEvoked));
-                                t_pEvokedPostStim->comment = QString("Stim %1").arg(t_iStimIndex);
-                                t_pEvokedPostStim->data = m_qListPostStimAve[t_iStimIndex];
-                                emit evokedPostStim(t_pEvokedPostStim);
-
-                                FiffEvoked::SPtr t_pEvokedStim(new FiffEvoked(t_stimEvoked));
-                                t_pEvokedStim->comment = QString("Stim %1").arg(t_iStimIndex);
-                                t_pEvokedStim->data = m_qListStimAve[t_iStimIndex];
-                                emit evokedStim(t_pEvokedStim);
-                                qDebug() << "Evoked emitted" << t_pEvokedPreStim->comment;
-                            }
+                            FiffEvoked::SPtr t_pEvokedPreStim(new FiffEvoked(t_preStimEvoked));
+                            t_pEvokedPreStim->comment = QString("Stim %1").arg(t_iStimIndex);
+                            t_pEvokedPreStim->data = m_qListPreStimAve[t_iStimIndex];
+                            emit evokedPreStim(t_pEvokedPreStim);
+
+                            FiffEvoked::SPtr t_pEvokedPostStim(new FiffEvoked(t_postStimEvoked));
+                            t_pEvokedPostStim->comment = QString("Stim %1").arg(t_iStimIndex);
+                            t_pEvokedPostStim->data = m_qListPostStimAve[t_iStimIndex];
+                            emit evokedPostStim(t_pEvokedPostStim);
+
+                            FiffEvoked::SPtr t_pEvokedStim(new FiffEvoked(t_stimEvoked));
+                            t_pEvokedStim->comment = QString("Stim %1").arg(t_iStimIndex);
+                            t_pEvokedStim->data = m_qListStimAve[t_iStimIndex];
+                            emit evokedStim(t_pEvokedStim);
+                            qDebug() << "Evoked emitted" << t_pEvokedPreStim->comment;
                         }
                     }
                 }
+            }
 
 
-                //
-                //dump oldest buffer
-                //
-                t_qListRawMatBuf.pop_front();
-            }
+            //
+            //dump oldest buffer
+            //
+            t_qListRawMatBuf.pop_front();
         }
     }
 }
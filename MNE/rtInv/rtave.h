@@ -58,7 +58,7 @@
 // Generics INCLUDES
 //=============================================================================================================
 
-#include <generics/circularmatrixbuffer.h>
+#include <generics/broadcastmatrixbuffer.h>
 
 
 //*************************************************************************************************************
@@ -68,6 +68,7 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QAtomicInt>
 #include <QSharedPointer>
 #include <QSet>
 #include <QList>
@@ -139,6 +140,24 @@ public:
     */
     void append(const MatrixXd &p_DataSegment);
 
+    //=========================================================================================================
+    /**
+    * Reads the raw data from a buffer which is shared with other consumers of the same stream; its blocks are
+    * read without being copied. Has to be called before start().
+    *
+    * @param[in] p_pRawMatrixBuffer Broadcast buffer to attach to
+    */
+    void setRawBuffer(const BroadcastMatrixBuffer<double>::SPtr &p_pRawMatrixBuffer);
+
+    //=========================================================================================================
+    /**
+    * Starts the RtAve thread. The running flag is raised before the thread starts, so a stop() issued right
+    * after start() is not overwritten by run().
+    *
+    * @return true if succeeded, false otherwise
+    */
+    virtual bool start();
+
     //=========================================================================================================
     /**
     * Stops the RtCov by stopping the producer's thread.
@@ -196,8 +215,9 @@ private:
     *
     * @param[in] p_qListRawMatBuf   List of raw buffers
     * @param[in] p_iStimIdx         Stimulus index to investigate
+    * @param[out] p_matPostStim     Epoch slot to assemble the poststimulus into
     */
-    void assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx);
+    void assemblePostStimulus(const QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > &p_qListRawMatBuf, qint32 p_iStimIdx, MatrixXd &p_matPostStim);
 
     //=========================================================================================================
     /**
@@ -205,20 +225,33 @@ private:
     *
     * @param[in] p_qListRawMatBuf   List of raw buffers
     * @param[in] p_iStimIdx         Stimulus index to investigate
+    * @param[out] p_matPreStim      Epoch slot to assemble the prestimulus into
+    */
+    void assemblePreStimulus(const QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > &p_qListRawMatBuf, qint32 p_iStimIdx, MatrixXd &p_matPreStim);
+
+    //=========================================================================================================
+    /**
+    * Stores the epoch of a new stimulus in the ring of the stimulus channel and updates the running sums:
+    * the evicted epoch is subtracted, the new one added. Once per ring cycle the sums are recomputed from the
+    * slots to bound the rounding drift.
+    *
+    * @param[in] p_qListRawMatBuf   List of raw buffers
+    * @param[in] p_iStimIdx         Stimulus index to investigate
     */
-    void assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx);
+    void updateAverage(const QList<QPair<QList<qint32>, BroadcastMatrixBuffer<double>::Block> > &p_qListRawMatBuf, qint32 p_iStimIdx);
 
     FiffInfo::SPtr  m_pFiffInfo;        /**< Holds the fiff measurement information. */
 
     QMutex      mutex;                  /**< Provides access serialization between threads*/
-    bool        m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
+    QAtomicInt  m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
 
     qint32 m_iNumAverages;              /**< Number of averages */
 
     qint32     m_iPreStimSamples;       /**< Amount of samples averaged before the stimulus. */
     qint32     m_iPostStimSamples;      /**< Amount of samples averaged after the stimulus, including the stimulus sample.*/
 
-    CircularMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;   /**< The Circular Raw Matrix Buffer. */
+    BroadcastMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;  /**< The raw buffer, possibly shared with other consumers. */
+    int m_iReader;                      /**< Reader id at m_pRawMatrixBuffer. */
 
     bool m_bAutoAspect; /**< Auto aspect detection on or off. */
 
@@ -227,8 +260,12 @@ private:
 
 //    QList<fiff_int_t>  m_qSetAspectKinds;   /**< List of aspects to average. Each aspect is averaged separetely and released stored in evoked data.*/
 
-    QList<QVector<MatrixXd> > m_qListQVectorPreStimBuf;     /**< assembles the pre stimulus data */
-    QList<QVector<MatrixXd> > m_qListQVectorPostStimBuf;    /**< assembles the post stimulus data */
+    QList<QVector<MatrixXd> > m_qListQVectorPreStimBuf;     /**< ring of the last m_iNumAverages pre stimulus epochs */
+    QList<QVector<MatrixXd> > m_qListQVectorPostStimBuf;    /**< ring of the last m_iNumAverages post stimulus epochs */
+    QList<qint32> m_qListRingPos;           /**< the ring slot which is overwritten next */
+    QList<qint32> m_qListRingFill;          /**< number of filled ring slots */
+    QList<MatrixXd> m_qListPreStimSum;      /**< running sum of the pre stimulus ring */
+    QList<MatrixXd> m_qListPostStimSum;     /**< running sum of the post stimulus ring */
 
     QList<MatrixXd> m_qListPreStimAve;     /**< the current pre stimulus average */
     QList<MatrixXd> m_qListPostStimAve;    /**< the current post stimulus average */
@@ -242,7 +279,7 @@ private:
 
 inline bool RtAve::isRunning()
 {
-    return m_bIsRunning;
+    return m_bIsRunning.load() != 0;
 }
 
 } // NAMESPACE
@@ -72,9 +72,11 @@ RtCov::RtCov(qint32 p_iMaxSamples, FiffInfo::SPtr p_pFiffInfo, QObject *parent)
 : QThread(parent)
 , m_iMaxSamples(p_iMaxSamples)
 , m_pFiffInfo(p_pFiffInfo)
-, m_bIsRunning(false)
+, m_bIsRunning(0)
+, m_pRawMatrixBuffer(new BroadcastMatrixBuffer<double>(32))
 {
     qRegisterMetaType<FiffCov::SPtr>("FiffCov::SPtr");
+    m_iReader = m_pRawMatrixBuffer->attach();
 }
 
 
@@ -90,12 +92,30 @@ RtCov::~RtCov()
 
 void RtCov::append(const MatrixXd &p_DataSegment)
 {
-//    if(m_pRawMatrixBuffer) // ToDo handle change buffersize
+    m_pRawMatrixBuffer->push(&p_DataSegment);
+}
 
-    if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(32, p_DataSegment.rows(), p_DataSegment.cols()));
 
-    m_pRawMatrixBuffer->push(&p_DataSegment);
+//*************************************************************************************************************
+
+void RtCov::setRawBuffer(const BroadcastMatrixBuffer<double>::SPtr &p_pRawMatrixBuffer)
+{
+    m_pRawMatrixBuffer->detach(m_iReader);
+
+    m_pRawMatrixBuffer = p_pRawMatrixBuffer;
+    m_iReader = m_pRawMatrixBuffer->attach();
+}
+
+
+//*************************************************************************************************************
+
+bool RtCov::start()
+{
+    m_bIsRunning.fetchAndStoreOrdered(1);
+
+    QThread::start();
+
+    return true;
 }
 
 
@@ -103,8 +123,12 @@ void RtCov::append(const MatrixXd &p_DataSegment)
 
 bool RtCov::stop()
 {
-    m_bIsRunning = false;
+    m_bIsRunning.fetchAndStoreOrdered(0);
+
+    // wake run() if it waits for data and attach again for a restart
+    m_pRawMatrixBuffer->detach(m_iReader);
     QThread::wait();
+    m_iReader = m_pRawMatrixBuffer->attach();
 
     return true;
 }
@@ -114,56 +138,55 @@ bool RtCov::stop()
 
 void RtCov::run()
 {
-    m_bIsRunning = true;
-
-
     quint32 n_samples = 0;
 
     FiffCov::SPtr cov(new FiffCov());
     VectorXd mu;
 
-    while(m_bIsRunning)
+    while(m_bIsRunning.load())
     {
-        if(m_pRawMatrixBuffer)
+        BroadcastMatrixBuffer<double>::Block t_pRawSegment = m_pRawMatrixBuffer->pop(m_iReader);
+        if(!t_pRawSegment)
+            continue;
+
+        const MatrixXd &rawSegment = *t_pRawSegment;
+
+        if(n_samples == 0)
+        {
+            mu = rawSegment.rowwise().sum();
+            cov->data = rawSegment * rawSegment.transpose();
+        }
+        else
+        {
+            mu.array() += rawSegment.rowwise().sum().array();
+            cov->data += rawSegment * rawSegment.transpose();
+        }
+        n_samples += rawSegment.cols();
+
+        if(n_samples > m_iMaxSamples)
         {
-            MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
-
-            if(n_samples == 0)
-            {
-                mu = rawSegment.rowwise().sum();
-                cov->data = rawSegment * rawSegment.transpose();
-            }
-            else
-            {
-                mu.array() += rawSegment.rowwise().sum().array();
-                cov->data += rawSegment * rawSegment.transpose();
-            }
-            n_samples += rawSegment.cols();
-
-            if(n_samples > m_iMaxSamples)
-            {
-                mu /= (float)n_samples;
-                cov->data.array() -= n_samples * (mu * mu.transpose()).array();
-                cov->data.array() /= (n_samples - 1);
-
-                cov->kind = FIFFV_MNE_NOISE_COV;
-                cov->diag = false;
-                cov->dim = cov->data.rows();
-
-                //ToDo do picks
-                cov->names = m_pFiffInfo->ch_names;
-                cov->projs = m_pFiffInfo->projs;
-                cov->bads  = m_pFiffInfo->bads;
-                cov->nfree  = n_samples;
-
-                // regularize noise covariance
-                *cov.data() = cov->regularize(*m_pFiffInfo, 0.05, 0.05, 0.1, true);
-
-                emit covCalculated(cov);
-
-                cov = FiffCov::SPtr(new FiffCov());
-                n_samples = 0;
-            }
+            mu /= (float)n_samples;
+            cov->data.array() -= n_samples * (mu * mu.transpose()).array();
+            cov->data.array() /= (n_samples - 1);
+
+            cov->kind = FIFFV_MNE_NOISE_COV;
+            cov->diag = false;
+            cov->dim = cov->data.rows();
+
+            //ToDo do picks
+            cov->names = m_pFiffInfo->ch_names;
+            cov->projs = m_pFiffInfo->projs;
+            cov->bads  = m_pFiffInfo->bads;
+            cov->nfree  = n_samples;
+
+            // regularize noise covariance
+            *cov.data() = cov->regularize(*m_pFiffInfo, 0.05, 0.05, 0.1, true);
+
+            emit covCalculated(cov);
+
+            cov = FiffCov::SPtr(new FiffCov());
+            n_samples = 0;
+        }
 
 
 //            qint32 samples = rawSegment.cols();
@@ -177,6 +200,5 @@ void RtCov::run()
 
 //            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
 
-        }
     }
 }
@@ -58,7 +58,7 @@
 // Generics INCLUDES
 //=============================================================================================================
 
-#include <generics/circularmatrixbuffer.h>
+#include <generics/broadcastmatrixbuffer.h>
 
 
 //*************************************************************************************************************
@@ -68,6 +68,7 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QAtomicInt>
 #include <QSharedPointer>
 
 
@@ -135,6 +136,24 @@ public:
     */
     void append(const MatrixXd &p_DataSegment);
 
+    //=========================================================================================================
+    /**
+    * Reads the raw data from a buffer which is shared with other consumers of the same stream; its blocks are
+    * read without being copied. Has to be called before start().
+    *
+    * @param[in] p_pRawMatrixBuffer Broadcast buffer to attach to
+    */
+    void setRawBuffer(const BroadcastMatrixBuffer<double>::SPtr &p_pRawMatrixBuffer);
+
+    //=========================================================================================================
+    /**
+    * Starts the RtCov thread. The running flag is raised before the thread starts, so a stop() issued right
+    * after start() is not overwritten by run().
+    *
+    * @return true if succeeded, false otherwise
+    */
+    virtual bool start();
+
     //=========================================================================================================
     /**
     * Stops the RtCov by stopping the producer's thread.
@@ -173,11 +192,12 @@ private:
     FiffInfo::SPtr  m_pFiffInfo;        /**< Holds the fiff measurement information. */
 
     QMutex      mutex;                  /**< Provides access serialization between threads*/
-    bool        m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
+    QAtomicInt  m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
 
     quint32      m_iMaxSamples;         /**< Maximal amount of samples received, before covariance is estimated.*/
 
-    CircularMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;   /**< The Circular Raw Matrix Buffer. */
+    BroadcastMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;  /**< The raw buffer, possibly shared with other consumers. */
+    int m_iReader;                      /**< Reader id at m_pRawMatrixBuffer. */
 };
 
 //*************************************************************************************************************
@@ -187,7 +207,7 @@ private:
 
 inline bool RtCov::isRunning()
 {
-    return m_bIsRunning;
+    return m_bIsRunning.load() != 0;
 }
 
 } // NAMESPACE
@@ -67,6 +67,8 @@ RtInvOp::RtInvOp(FiffInfo::SPtr &p_pFiffInfo, MNEForwardSolution::SPtr &p_pFwd,
 : QThread(parent)
 , m_pFiffInfo(p_pFiffInfo)
 , m_pFwd(p_pFwd)
+, m_bIsRunning(false)
+, m_iSkippedNoiseCov(0)
 {
     qRegisterMetaType<MNEInverseOperator::SPtr>("MNEInverseOperator::SPtr");
 }
@@ -85,10 +87,27 @@ RtInvOp::~RtInvOp()
 void RtInvOp::appendNoiseCov(FiffCov::SPtr p_pNoiseCov)
 {
     mutex.lock();
-    //Use here a circular buffer
-    m_vecNoiseCov.push_back(p_pNoiseCov);
 
+    if(m_pNoiseCov)
+        ++m_iSkippedNoiseCov;
+    m_pNoiseCov = p_pNoiseCov;
+
+    m_qWaitCondition.wakeAll();
+    mutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+bool RtInvOp::start()
+{
+    mutex.lock();
+    m_bIsRunning = true;
     mutex.unlock();
+
+    QThread::start();
+
+    return true;
 }
 
 
@@ -96,7 +115,11 @@ void RtInvOp::appendNoiseCov(FiffCov::SPtr p_pNoiseCov)
 
 bool RtInvOp::stop()
 {
+    mutex.lock();
     m_bIsRunning = false;
+    m_qWaitCondition.wakeAll();
+    mutex.unlock();
+
     QThread::wait();
 
     return true;
@@ -107,22 +130,32 @@ bool RtInvOp::stop()
 
 void RtInvOp::run()
 {
-    m_bIsRunning = true;
+    // Restrict forward solution as necessary for MEG
+    MNEForwardSolution t_forwardMeg = m_pFwd->pick_types(true, false);
 
-    while(m_bIsRunning)
+    while(true)
     {
-        if(m_vecNoiseCov.size() > 0)
-        {
-            // Restrict forward solution as necessary for MEG
-            MNEForwardSolution t_forwardMeg = m_pFwd->pick_types(true, false);
+        mutex.lock();
+        while(m_bIsRunning && !m_pNoiseCov)
+            m_qWaitCondition.wait(&mutex);
 
-            MNEInverseOperator::SPtr t_invOpMeg(new MNEInverseOperator(*m_pFiffInfo.data(), t_forwardMeg, *m_vecNoiseCov[0].data(), 0.2f, 0.8f));
-
-            mutex.lock();
-            m_vecNoiseCov.pop_front();
+        if(!m_bIsRunning)
+        {
             mutex.unlock();
+            break;
+        }
 
-            emit invOperatorCalculated(t_invOpMeg);
+        FiffCov::SPtr t_pNoiseCov = m_pNoiseCov;
+        m_pNoiseCov.clear();
+        if(m_iSkippedNoiseCov > 0)
+        {
+            qDebug() << "RtInvOp:" << m_iSkippedNoiseCov << "intermediate noise covariances skipped.";
+            m_iSkippedNoiseCov = 0;
         }
+        mutex.unlock();
+
+        MNEInverseOperator::SPtr t_invOpMeg(new MNEInverseOperator(*m_pFiffInfo.data(), t_forwardMeg, *t_pNoiseCov.data(), 0.2f, 0.8f, false, true, true));
+
+        emit invOperatorCalculated(t_invOpMeg);
     }
 }
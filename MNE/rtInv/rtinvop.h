@@ -67,6 +67,7 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QSharedPointer>
 
 
@@ -128,12 +129,23 @@ public:
 
     //=========================================================================================================
     /**
-    * Slot to receive incoming noise covariance estimations.
+    * Slot to receive incoming noise covariance estimations. Only the newest covariance is kept: one which
+    * arrives while another is still waiting replaces it, so the inverse operator lags at most one computation
+    * behind the latest covariance.
     *
     * @param[in] p_pNoiseCov     Noise covariance estimation
     */
     void appendNoiseCov(FiffCov::SPtr p_pNoiseCov);
 
+    //=========================================================================================================
+    /**
+    * Starts the RtInvOp thread. The running flag is raised before the thread starts, so a stop() issued right
+    * after start() is not overwritten by run().
+    *
+    * @return true if succeeded, false otherwise
+    */
+    virtual bool start();
+
     //=========================================================================================================
     /**
     * Stops the RtInv by stopping the producer's thread.
@@ -170,9 +182,11 @@ protected:
 
 private:
     QMutex      mutex;                  /**< Provides access serialization between threads. */
+    QWaitCondition m_qWaitCondition;    /**< Wakes run() when a covariance arrived or RtInv is stopped. */
     bool        m_bIsRunning;           /**< Whether RtInv is running. */
 
-    QVector<FiffCov::SPtr> m_vecNoiseCov;/**< Noise covariance matrices. */
+    FiffCov::SPtr m_pNoiseCov;          /**< Newest noise covariance not yet processed, null if none. */
+    quint32     m_iSkippedNoiseCov;     /**< Covariances replaced by a newer one before they were processed. */
 
     FiffInfo::SPtr m_pFiffInfo;         /**< The fiff measurement information. */
     MNEForwardSolution::SPtr m_pFwd;    /**< The forward solution. */
@@ -84,17 +84,34 @@ VectorXd* MNEMath::combine_xyz(const VectorXd& vec)
         return NULL;
     }
 
-    MatrixXd tmp = MatrixXd(vec.transpose());
-    SparseMatrix<double>* s = make_block_diag(tmp,3);
+    VectorXd* comb = new VectorXd(vec.size()/3);
+    *comb = Map<const MatrixXd>(vec.data(), 3, vec.size()/3).colwise().squaredNorm().transpose();
 
-    SparseMatrix<double> sC = *s*s->transpose();
-    VectorXd* comb = new VectorXd(sC.rows());
+    return comb;
+}
 
-    for(qint32 i = 0; i < sC.rows(); ++i)
-        (*comb)[i] = sC.coeff(i,i);
 
-    delete s;
-    return comb;
+//*************************************************************************************************************
+
+bool MNEMath::combine_xyz(const MatrixXd& mat, MatrixXd& out)
+{
+    if (mat.rows() % 3 != 0)
+    {
+        printf("Input must be a matrix with 3N rows");
+        return false;
+    }
+
+    qint32 n = mat.rows()/3;
+    if(out.rows() != n || out.cols() != mat.cols())
+        out.resize(n, mat.cols());
+
+    //
+    //   Column major storage -> the x, y, z components of a source are consecutive, i.e. the columns of a
+    //   3 x (n*cols) view
+    //
+    Map<RowVectorXd>(out.data(), n*mat.cols()) = Map<const MatrixXd>(mat.data(), 3, n*mat.cols()).colwise().squaredNorm();
+
+    return true;
 }
 
 
@@ -301,6 +318,65 @@ qint32 MNEMath::rank(const MatrixXd& A, double tol)
 }
 
 
+//*************************************************************************************************************
+
+void MNEMath::gram_svd(const MatrixXd& A, VectorXd& s, MatrixXd& U, MatrixXd& V, double tol)
+{
+    bool wide = A.rows() <= A.cols();
+    qint32 k = wide ? A.rows() : A.cols();
+
+    //
+    //   Gram matrix of the small dimension, only its lower triangle is computed
+    //
+    MatrixXd gram = MatrixXd::Zero(k, k);
+    if(wide)
+        gram.selfadjointView<Lower>().rankUpdate(A);
+    else
+        gram.selfadjointView<Lower>().rankUpdate(A.transpose());
+
+    SelfAdjointEigenSolver<MatrixXd> t_eigenSolver(gram);
+
+    //
+    //   Eigenvalues are ascending -> reverse them to get the singular values in the order of JacobiSVD
+    //
+    s.resize(k);
+    MatrixXd small(k, k);
+    for(qint32 i = 0; i < k; ++i)
+    {
+        double lambda = t_eigenSolver.eigenvalues()[k-1-i];
+        s[i] = lambda > 0 ? sqrt(lambda) : 0;
+        small.col(i) = t_eigenSolver.eigenvectors().col(k-1-i);
+    }
+
+    //
+    //   Singular vectors of the large dimension: A^T * U = V * S, or A * V = U * S
+    //
+    MatrixXd large = wide ? MatrixXd(A.transpose() * small) : MatrixXd(A * small);
+    double threshold = k > 0 ? tol * s[0] : 0;
+    for(qint32 i = 0; i < k; ++i)
+    {
+        if(s[i] > threshold)
+            large.col(i) /= s[i];
+        else
+        {
+            s[i] = 0;
+            large.col(i).setZero();
+        }
+    }
+
+    if(wide)
+    {
+        U = small;
+        V = large;
+    }
+    else
+    {
+        U = large;
+        V = small;
+    }
+}
+
+
 //*************************************************************************************************************
 
 MatrixXd MNEMath::rescale(const MatrixXd &data, const RowVectorXf &times, QPair<QVariant,QVariant> baseline, QString mode)
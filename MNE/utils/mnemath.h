@@ -126,6 +126,20 @@ public:
     */
     static VectorXd* combine_xyz(const VectorXd& vec);
 
+    //=========================================================================================================
+    /**
+    * mne_combine_xyz for a whole solution matrix
+    *
+    * Compute the three Cartesian components of each column together. The matrix is viewed as 3 x (n*cols)
+    * and reduced column wise, so no temporaries are created and out is only (re)allocated if its size differs.
+    *
+    * @param[in] mat    Input matrix with rows [ x1 y1 z1 ... x_n y_n z_n ]
+    * @param[out] out   Output matrix with rows [x1^2+y1^2+z1^2 ... x_n^2+y_n^2+z_n^2 ], out must not alias mat
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool combine_xyz(const MatrixXd& mat, MatrixXd& out);
+
 //    //=========================================================================================================
 //    /**
 //    * ### MNE toolbox root function ###: Implementation of the mne_block_diag function - decoding part
@@ -198,6 +212,22 @@ public:
     */
     static qint32 rank(const MatrixXd& A, double tol = 1e-8);
 
+    //=========================================================================================================
+    /**
+    * Thin singular value decomposition A = U * diag(s) * V^T computed from the eigendecomposition of the
+    * small Gram matrix, i.e. A*A^T for wide and A^T*A for tall matrices. Much faster than JacobiSVD when one
+    * dimension is a lot smaller than the other, e.g. for lead field matrices with nchan << nsource, at the
+    * price of squaring the condition number: singular values below tol times the largest one are not
+    * resolved and are set to zero together with their singular vectors of the large dimension.
+    *
+    * @param[in] A      Matrix to decompose
+    * @param[out] s     Singular values in descending order, min(rows, cols) entries
+    * @param[out] U     Left singular vectors, rows x min(rows, cols)
+    * @param[out] V     Right singular vectors, cols x min(rows, cols)
+    * @param[in] tol    relative threshold below which singular values are considered zero (optional, default = 1e-6)
+    */
+    static void gram_svd(const MatrixXd& A, VectorXd& s, MatrixXd& U, MatrixXd& V, double tol = 1e-6);
+
     //=========================================================================================================
     /**
     * ToDo: Maybe new processing class
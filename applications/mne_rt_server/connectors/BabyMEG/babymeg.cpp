@@ -91,13 +91,11 @@ using namespace UTILSLIB;
 BabyMEG::BabyMEG()
 :m_bIsRunning(false)
 , m_uiBufferSampleSize(1000)
-, m_pRawMatrixBuffer(NULL)
 , pInfo(NULL)
 {
     //BabyMEG Inits
     pInfo = new BabyMEGInfo();
     connect(pInfo, &BabyMEGInfo::fiffInfoAvailable, this, &BabyMEG::setFiffInfo);
-    connect(pInfo, &BabyMEGInfo::SendDataPackage, this, &BabyMEG::setFiffData);
 
     myClient = new BabyMEGClient(6340,this);
     myClient->SetInfo(pInfo);
@@ -234,24 +232,16 @@ void BabyMEG::setFiffData(QByteArray DATA)
     //get the first byte -- the data format
     int dformat = DATA.left(1).toInt();
 
-    DATA.remove(0,1);
+    //the samples follow the format byte; they are read in place since the block is shared with the receive pool
     qint32 rows = m_FiffInfoBabyMEG.nchan;
-    qint32 cols = (DATA.size()/dformat)/rows;
+    qint32 cols = ((DATA.size()-1)/dformat)/rows;
 
-    qDebug() << "[BabyMEG] Matrix " << rows << "x" << cols << " [Data bytes:" << dformat << "]";
-
-    MatrixXf rawData(Map<MatrixXf>( (float*)DATA.data(),rows, cols ));
+    QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new MatrixXf(Map<const MatrixXf>( (const float*)(DATA.constData()+1),rows, cols )));
 
     for(qint32 i = 0; i < rows*cols; ++i)
-        IOUtils::swap_floatp(rawData.data()+i);
-
-//    std::cout << "first ten elements \n" << rawData.block(0,0,2,10) << std::endl;
-
-    if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(64, rows, cols));
-
-    m_pRawMatrixBuffer->push(&rawData);
+        IOUtils::swap_floatp(t_pRawBuffer->data()+i);
 
+    emit remitRawBuffer(t_pRawBuffer);
 }
 
 //*************************************************************************************************************
@@ -319,15 +309,12 @@ void BabyMEG::run()
 
     while(m_bIsRunning)
     {
-        if(m_pRawMatrixBuffer)
-        {
-            QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(m_pRawMatrixBuffer->pop()));
-
-//            ++count;
-//            printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
-//            std::cout << "first 100 elements \n" << t_rawBuffer.block(0,0,1,100) << std::endl;
-
-            emit remitRawBuffer(t_pRawBuffer);
-        }
+        //
+        // The client keeps DATA requests outstanding while this queue is below its high-water mark; the timeout
+        // lets stop() end the loop when no data arrives
+        //
+        QByteArray DATA = pInfo->DeQueue(100);
+        if(!DATA.isEmpty())
+            setFiffData(DATA);
     }
 }
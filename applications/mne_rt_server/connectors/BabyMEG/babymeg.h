@@ -133,6 +133,12 @@ public:
 
 
     void setFiffInfo(FIFFLIB::FiffInfo);
+    //=========================================================================================================
+    /**
+    * Converts a DATR payload to a raw buffer and forwards it.
+    *
+    * @param[in] DATA   format byte followed by the big endian samples.
+    */
     void setFiffData(QByteArray DATA);
 
 protected:
@@ -183,7 +189,6 @@ private:
     FiffRawData         m_RawInfo;              /**< Holds the fiff raw measurement information. */
     quint32             m_uiBufferSampleSize;   /**< Sample size of the buffer */
 
-    CircularMatrixBuffer<float>::SPtr m_pRawMatrixBuffer;    /**< The Circular Raw Matrix Buffer. */
 
 };
 
@@ -79,7 +79,10 @@ BabyMEGClient::BabyMEGClient(int myPort, QObject *parent) :
     DataAcqStartFlag = false;
     numBlock = 0;
     DataACK = false;
+    m_iRequestWindow = BABYMEGCLIENT_REQUEST_WINDOW;
+    m_iOutstandingRequests = 0;
 
+    resetFrameParser();
 }
 
 //*************************************************************************************************************
@@ -87,6 +90,41 @@ BabyMEGClient::BabyMEGClient(int myPort, QObject *parent) :
 void BabyMEGClient::SetInfo(BabyMEGInfo *pInfo)
 {
     myBabyMEGInfo = pInfo;
+
+    // resume requesting when the consumer drained the queue below its high-water mark
+    connect(myBabyMEGInfo, &BabyMEGInfo::queueBelowHighWater, this, &BabyMEGClient::RequestData, Qt::QueuedConnection);
+}
+
+
+//*************************************************************************************************************
+
+void BabyMEGClient::SetRequestWindow(int n)
+{
+    m_iRequestWindow = n > 0 ? n : 1;
+    RequestData();
+}
+
+
+//*************************************************************************************************************
+
+void BabyMEGClient::RequestData()
+{
+    if (tcpSocket->state() != QAbstractSocket::ConnectedState || !SocketIsConnected)
+        return;
+
+    // keep the window of DATA requests outstanding unless the consumer falls behind
+    while (m_iOutstandingRequests < m_iRequestWindow && myBabyMEGInfo->QueueSize() < myBabyMEGInfo->g_highWater)
+    {
+        m_qMutex.lock();
+        qint64 WrtNum = tcpSocket->write("DATA", 4);
+        m_qMutex.unlock();
+        if (WrtNum != 4)
+        {
+            qDebug()<<"Error for sending a data request";
+            return;
+        }
+        ++m_iOutstandingRequests;
+    }
 }
 
 
@@ -195,9 +233,10 @@ void BabyMEGClient::ConnectToBabyMEG()
             qDebug()<< "Send the initial parameter request";
             if (tcpSocket->state()==QAbstractSocket::ConnectedState)
             {
-                buffer.clear();
+                resetFrameParser();
 //                SendCommand("INFO");
-                SendCommand("DATA");
+                m_iOutstandingRequests = 0;
+                RequestData();
             }
             return;
         }
@@ -274,191 +313,180 @@ void BabyMEGClient::SendCommandToBabyMEG()
 
 void BabyMEGClient::ReadToBuffer()
 {
+    while (tcpSocket->bytesAvailable() > 0)
+    {
+        if (m_iFrameLength < 0)
+        {
+            // frame header
+            qint64 numBytes = tcpSocket->read(m_cFrameHeader + m_iHeaderBytes, BABYMEGCLIENT_FRAME_HEADER - m_iHeaderBytes);
+            if (numBytes <= 0)
+                break;
+            m_iHeaderBytes += numBytes;
+            if (m_iHeaderBytes < BABYMEGCLIENT_FRAME_HEADER)
+                break;
 
-    QByteArray dat;
+            int tmp = qFromBigEndian<qint32>((const uchar*)m_cFrameHeader + 4);
+            if (tmp < 0)
+            {
+                qDebug()<<"[Invalid frame length: discard received data]"<<tmp;
+                tcpSocket->readAll();
+                resetFrameParser();
+                break;
+            }
 
-    int numBytes = tcpSocket->bytesAvailable();
-//    qDebug() << "1.byte available: " << numBytes;
-    if (numBytes > 0){
-        dat = tcpSocket->read(numBytes); // read all pending data
-//        qDebug()<<"[dat Size]"<<dat.size();
-        if (!dat.isEmpty()){
-            buffer.append(dat); // and append it to your own buffer
-//            qDebug()<<"[ReadToBuffer: Buffer Size]"<<buffer.size();
+            m_iFrameLength = tmp;
+            m_iFrameBytes = 0;
+            m_iFrameBlock = -1;
+
+            // DATR payloads are received into a recycled block, control frames into their own
+            if (memcmp(m_cFrameHeader, "DATR", 4) == 0)
+                m_iFrameBlock = acquireBlock(m_iFrameLength);
+            if (m_iFrameBlock < 0)
+                m_blockFrame = QByteArray(m_iFrameLength, Qt::Uninitialized);
         }
-        else
+
+        if (m_iFrameBytes < m_iFrameLength)
         {
-            qDebug()<<"[Empty dat: error]"<<tcpSocket->errorString();
+            char* t_pDst = m_iFrameBlock >= 0 ? m_qListBlockPool[m_iFrameBlock].data() : m_blockFrame.data();
+            qint64 numBytes = tcpSocket->read(t_pDst + m_iFrameBytes, m_iFrameLength - m_iFrameBytes);
+            if (numBytes <= 0)
+                break;
+            m_iFrameBytes += numBytes;
+            if (m_iFrameBytes < m_iFrameLength)
+                break;
         }
-    }
-//    qDebug()<<"read buffer is done!";
 
-    handleBuffer();
-    return;
+        // complete frame; the parser is reset before dispatching since handling may reconnect
+        QByteArray CMD(m_cFrameHeader, 4);
+        QByteArray DATA = m_iFrameBlock >= 0 ? m_qListBlockPool[m_iFrameBlock] : m_blockFrame;
+        resetFrameParser();
+
+        if (!handleFrame(CMD, DATA))
+            break;
+    }
 }
 
+
 //*************************************************************************************************************
 
-void BabyMEGClient::handleBuffer()
+void BabyMEGClient::resetFrameParser()
 {
-    if(buffer.size()>= 8){
-        QByteArray CMD = buffer.left(4);
-        QByteArray DLEN = buffer.mid(4,4);
-        int tmp = MGH_LM_Byte2Int(DLEN);
-//        qDebug() << "First 4 bytes + length" << CMD << "["<<CMD.toHex()<<"]";
-//        qDebug() << "Command[" << CMD <<"]";
-//        qDebug() << "Body Length[" << tmp << "]";
-
-        if (tmp <= (buffer.size() - 8))
-        {
-            buffer.remove(0,8);
-
-            int OPT = 0;
-
-            if (CMD == "INFO")
-                OPT = 1;
-            else if (CMD == "DATR")
-                OPT = 2;
-            else if (CMD == "COMD")
-                OPT = 3;
-            else if (CMD == "QUIT")
-                OPT = 4;
-            else if (CMD == "COMS")
-                OPT = 5;
-            else if (CMD == "QUIS")
-                OPT = 6;
-
-            switch (OPT){
-            case 1:
-                // from buffer get data package
-                {
-                QByteArray PARA = buffer.left(tmp);
-                qDebug()<<"[INFO]"<<PARA;
-                //Parse parameters from PARA string
-                myBabyMEGInfo->MGH_LM_Parse_Para(PARA);
-                buffer.remove(0,tmp);
-                qDebug()<<"INFO has been received!!!!";
-//                qDebug()<<"ACQ Start";
-//                SendCommand("DATA");
-                }
-                break;
-            case 2:
-                // read data package from buffer
-                // Ask for the next data block
+    m_iHeaderBytes = 0;
+    m_iFrameLength = -1;
+    m_iFrameBytes = 0;
+    m_iFrameBlock = -1;
+    m_blockFrame.clear();
+}
 
-                SendCommand("DATA");
-                DispatchDataPackage(tmp);
 
-                break;
-            case 3:
-                {
-                QByteArray RESP = buffer.left(tmp);
-                qDebug()<< "5.Readbytes:"<<RESP.size();
-                qDebug() << RESP;
-                }
-                buffer.remove(0,tmp);
+//*************************************************************************************************************
 
-                break;
-            case 4:  //quit
-                qDebug()<<"Quit";
-
-                SendCommand("QREL");
-                tcpSocket->disconnectFromHost();
-                if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
-                            tcpSocket->waitForDisconnected();
-                SocketIsConnected = false;
-                qDebug()<< "Disconnect Server";
-                qDebug()<< "Client is End!";
-                qDebug()<< "You can close this application or restart to connect Server.";
+int BabyMEGClient::acquireBlock(int size)
+{
+    int idx = -1;
+    for (int i = 0; i < m_qListBlockPool.size(); ++i)
+    {
+        if (m_qListBlockPool[i].isDetached())
+        {
+            idx = i;
+            break;
+        }
+    }
 
-                break;
-            case 5://command short connection
-                {
-                QByteArray RESP = buffer.left(tmp);
-                qDebug()<< "5.Readbytes:"<<RESP.size();
-                qDebug() << RESP;
-                }
-                buffer.remove(0,tmp);
-                SendCommand("QUIT");
-                break;
-            case 6:  //quit
-                qDebug()<<"Quit";
-
-                SendCommand("QREL");
-                tcpSocket->disconnectFromHost();
-                if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
-                            tcpSocket->waitForDisconnected();
-                SocketIsConnected = false;
-                qDebug()<< "Disconnect Server";
-                break;
+    if (idx < 0)
+    {
+        if (m_qListBlockPool.size() >= BABYMEGCLIENT_BLOCK_POOL)
+            return -1;
+        m_qListBlockPool.append(QByteArray());
+        idx = m_qListBlockPool.size() - 1;
+    }
 
-            default:
-                qDebug()<< "Unknow Type";
-                break;
-            }
-        }
-    }// buffer is not empty and larger than 8 bytes
+    // a detached block keeps its capacity, so equally sized DATR payloads do not reallocate
+    m_qListBlockPool[idx].resize(size);
 
+    return idx;
 }
 
+
 //*************************************************************************************************************
 
-void BabyMEGClient::DispatchDataPackage(int tmp)
+bool BabyMEGClient::handleFrame(const QByteArray &CMD, const QByteArray &DATA)
 {
+    int OPT = 0;
+
+    if (CMD == "INFO")
+        OPT = 1;
+    else if (CMD == "DATR")
+        OPT = 2;
+    else if (CMD == "COMD")
+        OPT = 3;
+    else if (CMD == "QUIT")
+        OPT = 4;
+    else if (CMD == "COMS")
+        OPT = 5;
+    else if (CMD == "QUIS")
+        OPT = 6;
+
+    switch (OPT){
+    case 1:
+        qDebug()<<"[INFO]"<<DATA;
+        //Parse parameters from PARA string
+        myBabyMEGInfo->MGH_LM_Parse_Para(DATA);
+        qDebug()<<"INFO has been received!!!!";
+        break;
+    case 2:
+        // Hand the block to the consumer queue and top up the outstanding requests
+        if (m_iOutstandingRequests > 0)
+            --m_iOutstandingRequests;
+        DispatchDataPackage(DATA);
+        RequestData();
+        break;
+    case 3:
+        qDebug()<< "5.Readbytes:"<<DATA.size();
+        qDebug() << DATA;
+        break;
+    case 4:  //quit
+        qDebug()<<"Quit";
+
+        SendCommand("QREL");
+        tcpSocket->disconnectFromHost();
+        if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
+                    tcpSocket->waitForDisconnected();
+        SocketIsConnected = false;
+        qDebug()<< "Disconnect Server";
+        qDebug()<< "Client is End!";
+        qDebug()<< "You can close this application or restart to connect Server.";
+        return false;
+    case 5://command short connection
+        qDebug()<< "5.Readbytes:"<<DATA.size();
+        qDebug() << DATA;
+        SendCommand("QUIT");
+        break;
+    case 6:  //quit
+        qDebug()<<"Quit";
 
-//    qDebug()<<"Acq data from buffer  [buffer size() =" << buffer.size()<<"]";
-    QByteArray DATA = buffer.left(tmp);
-    qDebug()<< "5.Readbytes:"<<DATA.size();
-    myBabyMEGInfo->MGH_LM_Send_DataPackage(DATA);
-//    myBabyMEGInfo->EnQueue(DATA);
-    buffer.remove(0,tmp);
-//    qDebug()<<"Rest buffer  [buffer size() =" << buffer.size()<<"]";
-    numBlock ++;
-    qDebug()<< "Next Block ..." << numBlock;
-//    DATA.clear();
+        SendCommand("QREL");
+        tcpSocket->disconnectFromHost();
+        if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
+                    tcpSocket->waitForDisconnected();
+        SocketIsConnected = false;
+        qDebug()<< "Disconnect Server";
+        return false;
 
-//    ReadNextBlock(tmp);
+    default:
+        qDebug()<< "Unknow Type";
+        break;
+    }
+
+    return true;
 }
 
 //*************************************************************************************************************
 
-void BabyMEGClient::ReadNextBlock(int tmp)
+void BabyMEGClient::DispatchDataPackage(const QByteArray &DATA)
 {
-    QByteArray CMD1;
-    QByteArray DLEN1;
-    QByteArray DATA1;
-    int tmp1;
-    while (buffer.size()>=(tmp+8))
-    { // process the extra data block to reduce the load of data buffer
-        CMD1 = buffer.left(4);
-        qDebug()<<"CMD"<< CMD1;
-        if (CMD1 == "DATR")
-        {
-            DLEN1 = buffer.mid(4,4);
-            tmp1 = MGH_LM_Byte2Int(DLEN1);
-            qDebug() << "[2]First 4 bytes + length" << CMD1 << "["<<CMD1.toHex()<<"]";
-            qDebug() << "[2]Command[" << CMD1 <<"]";
-            qDebug() << "[2]Body Length[" << tmp1 << "]";
-
-            buffer.remove(0,8);
-            DATA1 = buffer.left(tmp1);
-            myBabyMEGInfo->EnQueue(DATA1);
-            buffer.remove(0,tmp1);
-            qDebug()<<"End of DataPackeage" << buffer.left(3);
-            qDebug()<<"[2]Rest buffer  [buffer size() =" << buffer.size()<<"]";
-            numBlock ++;
-            qDebug()<< "[2]Next Block ..." << numBlock;
-        }
-        else
-        {
-            qDebug()<<"[CMD1]"<<CMD1.toHex();
-            break;
-        }
-        qDebug()<<"[ReadNextBlock:buffer size]"<<buffer.size();
-    }
-    DATA1.clear();
-    CMD1.clear();
-    DLEN1.clear();
+    myBabyMEGInfo->EnQueue(DATA);
+    numBlock ++;
 }
 
 //*************************************************************************************************************
@@ -487,7 +515,6 @@ void BabyMEGClient::SendCommand(QString s)
         tcpSocket->flush();
         tcpSocket->waitForBytesWritten();
         m_qMutex.unlock();
-        qDebug()<<"[Done: Send Command]"<<array<<"[Send bytes]"<<WrtNum;
 
         }
         else
@@ -495,8 +522,6 @@ void BabyMEGClient::SendCommand(QString s)
             qDebug()<<"Not in Connected state";
             //re-connect to server
             ConnectToBabyMEG();
-            buffer.clear();
-            SendCommand("DATA");
         }
 //    sleep(1);
 }
@@ -47,6 +47,7 @@
 #include <QMutex>
 #include <QThread>
 #include <QDataStream>
+#include <QList>
 
 
 //*************************************************************************************************************
@@ -61,6 +62,16 @@ class QTcpSocket;
 class QNetworkSession;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define BABYMEGCLIENT_FRAME_HEADER  8   /**< 4 byte command and 4 byte big endian payload length */
+#define BABYMEGCLIENT_BLOCK_POOL    8   /**< Receive blocks recycled for DATR payloads */
+#define BABYMEGCLIENT_REQUEST_WINDOW 4  /**< Default number of outstanding DATA requests */
+
+
 //=============================================================================================================
 /**
 * DECLARE CLASS BabyMEGClient
@@ -85,13 +96,40 @@ public:
     bool DataAcqStartFlag;
     BabyMEGInfo *myBabyMEGInfo;
 
-    QByteArray buffer;
     int numBlock;
     bool DataACK;
 
 private:
+    //=========================================================================================================
+    /**
+    * Discards a partially received frame, e.g. when the connection is re-established.
+    */
+    void resetFrameParser();
+
+    //=========================================================================================================
+    /**
+    * Returns a pooled block of the given size which is not referenced outside of the pool anymore, so it can
+    * be written without detaching. When all pooled blocks are still in use a new one is added while the pool
+    * holds less than BABYMEGCLIENT_BLOCK_POOL blocks.
+    *
+    * @param[in] size -- payload size in bytes
+    * @param[out] index of the block within the pool, -1 if none is free
+    */
+    int acquireBlock(int size);
+
     QTcpSocket *tcpSocket;
     QMutex m_qMutex;
+
+    char m_cFrameHeader[BABYMEGCLIENT_FRAME_HEADER];    /**< Header of the frame being received */
+    int m_iHeaderBytes;                                 /**< Received header bytes */
+    int m_iFrameLength;                                 /**< Payload length of the frame being received, -1 while reading the header */
+    int m_iFrameBytes;                                  /**< Received payload bytes */
+    int m_iFrameBlock;                                  /**< Pool index of the payload block, -1 for m_blockFrame */
+    QByteArray m_blockFrame;                            /**< Payload of control frames and of DATR frames when the pool is exhausted */
+    QList<QByteArray> m_qListBlockPool;                 /**< Recycled DATR payload blocks */
+
+    int m_iRequestWindow;                               /**< Maximum number of outstanding DATA requests */
+    int m_iOutstandingRequests;                         /**< DATA requests not yet answered by a DATR frame */
 signals:
     void DataAcq();
     void error(int socketError, const QString &message);
@@ -121,7 +159,9 @@ public slots:
     void DisplayError(int socketError, const QString &message);
     //=========================================================================================================
     /**
-    * Read data from socket to a buffer
+    * Drains all complete frames available at the socket. Header and payload of each frame are read straight
+    * from the socket into their destination, a partial frame is continued with the next readyRead. DATR
+    * payloads are received into pooled blocks which are handed on as implicitly shared references.
     *
     * @param[in] void.
     */
@@ -134,6 +174,14 @@ public slots:
     * @param[in] String s - the string will be sent to server.
     */
     void SendCommandToBabyMEGShortConnection(QByteArray s);
+    //=========================================================================================================
+    /**
+    * Sends DATA requests until the request window is outstanding. No request is sent while the consumer
+    * queue of BabyMEGInfo holds g_highWater blocks or more; requesting resumes when it drained below.
+    *
+    * @param[in] void.
+    */
+    void RequestData();
 
 // public function
 public:
@@ -174,17 +222,17 @@ public:
     */
     void SetInfo(BabyMEGInfo *pInfo);
     /**
-    * Dispatch the data package
+    * Set the number of DATA requests kept outstanding; 1 is the former stop-and-wait protocol
     *
-    * @param[in] tmp -- block size
+    * @param[in] n -- request window
     */
-    void DispatchDataPackage(int tmp);
+    void SetRequestWindow(int n);
     /**
-    * Read next data block
+    * Dispatch the data package to the queue of BabyMEGInfo
     *
-    * @param[in] tmp -- block size
+    * @param[in] DATA -- DATR payload, shared with the receive block pool
     */
-    void ReadNextBlock(int tmp);
+    void DispatchDataPackage(const QByteArray &DATA);
     /**
     * Send command with command format as string
     *
@@ -192,11 +240,13 @@ public:
     */
     void SendCommand(QString s);
     /**
-    * Handle the data buffer connecting to the TCP socket
+    * Handle one complete frame received from the TCP socket
     *
-    * @param[in] void
+    * @param[in] CMD -- the 4 byte frame command
+    * @param[in] DATA -- the frame payload
+    * @param[out] false if the connection was closed
     */
-    void handleBuffer();
+    bool handleFrame(const QByteArray &CMD, const QByteArray &DATA);
 };
 
 #endif // BABYMEGCLIENT_H
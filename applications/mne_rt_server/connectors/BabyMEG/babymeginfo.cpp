@@ -42,12 +42,13 @@
 
 BabyMEGInfo::BabyMEGInfo()
 : g_maxlen(500)
+, g_highWater(16)
 {
 }
 
 //*************************************************************************************************************
 
-void BabyMEGInfo::MGH_LM_Send_DataPackage(QByteArray DATA)
+void BabyMEGInfo::MGH_LM_Send_DataPackage(const QByteArray &DATA)
 {
 //    qDebug()<<"[BabyMEGInfo]Data Size:"<<DATA.size();
     emit SendDataPackage(DATA);
@@ -252,19 +253,34 @@ void BabyMEGInfo::EnQueue(QByteArray DataIn)
     g_queue.enqueue(DataIn);
     g_queueNotEmpty.wakeAll();
     g_mutex.unlock();
-    qDebug() << "Data In...[size="<<g_queue.size()<<"]";
 }
 //*************************************************************************************************************
 
-QByteArray BabyMEGInfo::DeQueue()
+QByteArray BabyMEGInfo::DeQueue(unsigned long time)
 {
-    QMutexLocker locker(&g_mutex);
-    if (g_queue.isEmpty()) {
-    qDebug() << "g_queue empty, waiting!";
-    g_queueNotEmpty.wait(&g_mutex);
+    g_mutex.lock();
+    if (g_queue.isEmpty())
+        g_queueNotEmpty.wait(&g_mutex, time);
+    if (g_queue.isEmpty())
+    {
+        g_mutex.unlock();
+        return QByteArray();
     }
     QByteArray val = g_queue.dequeue();
+    bool resume = g_queue.size() == g_highWater - 1;
     g_queueNotFull.wakeAll();
-    qDebug() << "Data Out...[size="<<g_queue.size()<<"]";
+    g_mutex.unlock();
+
+    if (resume)
+        emit queueBelowHighWater();
+
     return val;
 }
+
+//*************************************************************************************************************
+
+int BabyMEGInfo::QueueSize()
+{
+    QMutexLocker locker(&g_mutex);
+    return g_queue.size();
+}
@@ -85,6 +85,7 @@ public:
     //BB_QUEUE
     QQueue<QByteArray> g_queue;
     int g_maxlen;
+    int g_highWater;    /**< Queue size at which the client stops requesting data blocks */
     QMutex g_mutex;
     QWaitCondition g_queueNotFull;
     QWaitCondition g_queueNotEmpty;
@@ -97,6 +98,11 @@ public:
 signals:
     void fiffInfoAvailable(FIFFLIB::FiffInfo);
     void SendDataPackage(QByteArray DATA);
+    //=========================================================================================================
+    /**
+    * Emitted by DeQueue when the queue size drops below g_highWater
+    */
+    void queueBelowHighWater();
 
 public:
     //=========================================================================================================
@@ -133,9 +139,9 @@ public:
     /**
     * Send data package
     *
-    * @param[in] DATA - QByteArray contains MEG data.
+    * @param[in] DATA - QByteArray contains MEG data; implicitly shared with the receive block pool of the client.
     */
-    void MGH_LM_Send_DataPackage(QByteArray DATA);
+    void MGH_LM_Send_DataPackage(const QByteArray &DATA);
     //=========================================================================================================
     /**
     * Put data block into a queue
@@ -147,10 +153,17 @@ public:
     /**
     * Get data block from a queue
     *
-    * @param[in] void
-    * @param[out] Output Data Block (QByteArray)
+    * @param[in] time - maximal time to wait for a block in ms
+    * @param[out] Output Data Block (QByteArray), empty if none arrived within time
+    */
+    QByteArray DeQueue(unsigned long time = ULONG_MAX);
+    //=========================================================================================================
+    /**
+    * Number of queued data blocks
+    *
+    * @param[out] queue size
     */
-    QByteArray DeQueue();
+    int QueueSize();
 
 
 private:
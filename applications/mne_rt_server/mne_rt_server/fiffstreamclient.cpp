@@ -0,0 +1,463 @@
+//=============================================================================================================
+/**
+* @file     fiffstreamclient.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the FiffStreamClient Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiffstreamclient.h"
+#include "mne_rt_commands.h"
+#include "fiffstreamsubscription.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Fiff INCLUDES
+//=============================================================================================================
+
+#include <utils/ioutils.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtNetwork>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace RTSERVER;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffStreamClient::FiffStreamClient(qint32 id, qintptr socketDescriptor)
+: QObject(0)
+, m_iDataClientId(id)
+, m_sDataClientAlias(QString(""))
+, m_iSocketDescriptor(socketDescriptor)
+, m_pTcpSocket(new QTcpSocket(this))
+, m_iSendOffset(0)
+, m_bIsSendingRawBuffer(false)
+, m_iSendQueuePolicy(DropOldest)
+, m_iMaxQueuedBytes(FIFFSTREAMCLIENT_MAX_QUEUE_BYTES)
+, m_iQueuedBytes(0)
+, m_iHighWaterBytes(0)
+, m_iDroppedBuffers(0)
+, m_iDecimation(1)
+{
+}
+
+
+//*************************************************************************************************************
+
+FiffStreamClient::~FiffStreamClient()
+{
+    m_pTcpSocket->disconnect(this);
+    m_pTcpSocket->abort();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::init()
+{
+    if (!m_pTcpSocket->setSocketDescriptor(m_iSocketDescriptor)) {
+        emit error(m_pTcpSocket->error());
+        emit clientDisconnected(m_iDataClientId);
+        return;
+    }
+
+    printf("FiffStreamClient (assigned ID %d) accepted from\n\tIP:\t%s\n\tPort:\t%d\n\n",
+           m_iDataClientId,
+           QHostAddress(m_pTcpSocket->peerAddress()).toString().toUtf8().constData(),
+           m_pTcpSocket->peerPort());
+
+    m_pTcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    m_pFiffStreamIn = FiffStream::SPtr(new FiffStream(m_pTcpSocket));
+
+    connect(m_pTcpSocket, &QTcpSocket::readyRead, this, &FiffStreamClient::readTags);
+    connect(m_pTcpSocket, &QTcpSocket::bytesWritten, this, &FiffStreamClient::flush);
+    connect(m_pTcpSocket, &QTcpSocket::disconnected, this, &FiffStreamClient::onDisconnected);
+
+    // Data may have arrived or been queued before the notifications were connected
+    readTags();
+    flush();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::startMeas(qint32 ID)
+{
+    if(ID == m_iDataClientId)
+    {
+        qDebug() << "Activate raw buffer sending.";
+
+        QByteArray t_blockStart;
+        {
+            FiffStream t_FiffStreamOut(&t_blockStart, QIODevice::WriteOnly);
+            t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        }
+
+        m_bIsSendingRawBuffer = true;
+        enqueueBlock(t_blockStart);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::stopMeas(qint32 ID)
+{
+    if(ID == m_iDataClientId || ID == -1)
+    {
+        qDebug() << "stop raw buffer sending.";
+
+        QByteArray t_blockEnd;
+        {
+            FiffStream t_FiffStreamOut(&t_blockEnd, QIODevice::WriteOnly);
+            t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        }
+
+        m_bIsSendingRawBuffer = false;
+        enqueueBlock(t_blockEnd);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::parseCommand(FiffTag::SPtr p_pTag)
+{
+    if(p_pTag->size() >= 4)
+    {
+        qint32* t_pInt = (qint32*)p_pTag->data();
+        IOUtils::swap_intp(t_pInt);
+        qint32 t_iCmd = t_pInt[0];
+
+        if(t_iCmd == MNE_RT_SET_CLIENT_ALIAS)
+        {
+            //
+            // Set Client Alias
+            //
+            m_qMutexAlias.lock();
+            m_sDataClientAlias = QString(p_pTag->mid(4, p_pTag->size()-4));
+            m_qMutexAlias.unlock();
+            printf("FiffStreamClient (ID %d): new alias = '%s'\r\n\n", m_iDataClientId, getAlias().toUtf8().constData());
+        }
+        else if(t_iCmd == MNE_RT_GET_CLIENT_ID)
+        {
+            //
+            // Send Client ID
+            //
+            printf("FiffStreamClient (ID %d): send client ID %d\r\n\n", m_iDataClientId, m_iDataClientId);
+            writeClientId();
+        }
+        else if(t_iCmd == MNE_RT_SET_ENCODING)
+        {
+            //
+            // Request raw buffer encoding: <method> [picks]
+            //
+            QStringList t_qListArgs = QString(p_pTag->mid(4, p_pTag->size()-4)).split(" ", QString::SkipEmptyParts);
+            if(t_qListArgs.size() > 0)
+            {
+                printf("FiffStreamClient (ID %d): request encoding '%s'\r\n\n", m_iDataClientId, t_qListArgs.join(" ").toUtf8().constData());
+                emit requestEncoding(m_iDataClientId, t_qListArgs[0], t_qListArgs.size() > 1 ? t_qListArgs[1] : QString(""));
+            }
+        }
+        else if(t_iCmd == MNE_RT_SET_SUBSCRIPTION)
+        {
+            //
+            // Request channel subscription: <decimation> [picks]
+            //
+            QStringList t_qListArgs = QString(p_pTag->mid(4, p_pTag->size()-4)).split(" ", QString::SkipEmptyParts);
+            bool t_isInt = false;
+            qint32 t_iDecimation = t_qListArgs.size() > 0 ? t_qListArgs[0].toInt(&t_isInt) : 0;
+            if(t_isInt)
+            {
+                printf("FiffStreamClient (ID %d): request subscription '%s'\r\n\n", m_iDataClientId, t_qListArgs.join(" ").toUtf8().constData());
+                emit requestSubscription(m_iDataClientId, t_qListArgs.size() > 1 ? t_qListArgs[1] : QString(""), t_iDecimation);
+            }
+        }
+        else
+        {
+            printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
+        }
+    }
+    else
+    {
+        printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::sendRawBuffer(QString p_sStream, QByteArray p_blockRawBuffer)
+{
+    //
+    // The block was encoded once per stream by the server; queuing it shares the data
+    //
+    if(m_bIsSendingRawBuffer && p_sStream == m_sStream)
+        enqueueBlock(p_blockRawBuffer, true);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::setStream(qint32 ID, QString p_sStream, Eigen::RowVectorXi p_vecPicks, qint32 p_iDecimation)
+{
+    if(ID == m_iDataClientId)
+    {
+        m_sStream = p_sStream;
+        m_vecPicks = p_vecPicks;
+        m_iDecimation = p_iDecimation;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::setSendQueuePolicy(qint32 ID, qint32 p_iPolicy, qint32 p_iMaxBytes)
+{
+    if(ID == m_iDataClientId || ID == -1)
+    {
+        if(p_iPolicy >= DropOldest && p_iPolicy <= Disconnect)
+            m_iSendQueuePolicy.store(p_iPolicy);
+        if(p_iMaxBytes > 0)
+            m_iMaxQueuedBytes.store(p_iMaxBytes);
+
+        applySendQueuePolicy();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
+{
+    if(ID == m_iDataClientId)
+    {
+        QByteArray t_blockMeasInfo;
+        {
+            FiffStream t_FiffStreamOut(&t_blockMeasInfo, QIODevice::WriteOnly);
+            if(m_vecPicks.size() > 0 || m_iDecimation > 1)
+                FiffStreamSubscription::subscribedInfo(p_fiffInfo, m_vecPicks, m_iDecimation).writeToStream(&t_FiffStreamOut);
+            else
+                p_fiffInfo.writeToStream(&t_FiffStreamOut);
+        }
+
+        enqueueBlock(t_blockMeasInfo);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::writeClientId()
+{
+    QByteArray t_blockClientId;
+    {
+        FiffStream t_FiffStreamOut(&t_blockClientId, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    }
+
+    enqueueBlock(t_blockClientId);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::enqueueBlock(const QByteArray& p_blockData, bool p_bIsRawBuffer)
+{
+    FiffStreamBlock t_block;
+    t_block.data = p_blockData;
+    t_block.isRawBuffer = p_bIsRawBuffer;
+    m_qListSendBlocks.append(t_block);
+
+    qint32 t_iQueuedBytes = m_iQueuedBytes.fetchAndAddOrdered(p_blockData.size()) + p_blockData.size();
+    if(t_iQueuedBytes > m_iHighWaterBytes.load())
+        m_iHighWaterBytes.store(t_iQueuedBytes);
+
+    flush();
+
+    if(p_bIsRawBuffer)
+        applySendQueuePolicy();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::removeBlock(qint32 idx)
+{
+    m_iQueuedBytes.fetchAndAddOrdered(-m_qListSendBlocks[idx].data.size());
+    m_qListSendBlocks.removeAt(idx);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::applySendQueuePolicy()
+{
+    qint32 t_iMaxBytes = m_iMaxQueuedBytes.load();
+    if(m_iQueuedBytes.load() <= t_iMaxBytes)
+        return;
+
+    switch(m_iSendQueuePolicy.load())
+    {
+        case Disconnect:
+        {
+            printf("FiffStreamClient (ID %d): send queue exceeds %d bytes, disconnect\n\n", m_iDataClientId, t_iMaxBytes);
+            m_pTcpSocket->disconnect(this);
+            m_pTcpSocket->abort();
+            onDisconnected();
+            break;
+        }
+        case DropNewest:
+        {
+            for(qint32 i = m_qListSendBlocks.size() - 1; i >= 0 && m_iQueuedBytes.load() > t_iMaxBytes; --i)
+            {
+                //The head block may already be partially handed to the socket
+                if(m_qListSendBlocks[i].isRawBuffer && (i > 0 || m_iSendOffset == 0))
+                {
+                    removeBlock(i);
+                    m_iDroppedBuffers.fetchAndAddOrdered(1);
+                }
+            }
+            break;
+        }
+        default: //DropOldest
+        {
+            qint32 i = m_iSendOffset > 0 ? 1 : 0;
+            while(i < m_qListSendBlocks.size() && m_iQueuedBytes.load() > t_iMaxBytes)
+            {
+                if(m_qListSendBlocks[i].isRawBuffer)
+                {
+                    removeBlock(i);
+                    m_iDroppedBuffers.fetchAndAddOrdered(1);
+                }
+                else
+                    ++i;
+            }
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::flush()
+{
+    if(m_pTcpSocket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    //
+    // The socket gathers the handed over blocks in its write buffer and sends them with as few system calls as
+    // the network allows; blocks beyond the limit stay shared in the queue until bytesWritten reports progress
+    //
+    while(!m_qListSendBlocks.isEmpty() && m_pTcpSocket->bytesToWrite() < FIFFSTREAMCLIENT_SOCKET_BUFFER)
+    {
+        const QByteArray& t_blockData = m_qListSendBlocks.first().data;
+        qint64 t_iBytesWritten = m_pTcpSocket->write(t_blockData.constData() + m_iSendOffset, t_blockData.size() - m_iSendOffset);
+        if(t_iBytesWritten <= 0)
+            break;
+
+        m_iSendOffset += (qint32)t_iBytesWritten;
+        if(m_iSendOffset == t_blockData.size())
+        {
+            removeBlock(0);
+            m_iSendOffset = 0;
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::readTags()
+{
+    while(true)
+    {
+        if(!m_pPendingTag)
+        {
+            if(m_pTcpSocket->bytesAvailable() < (qint64)FIFFC_TAG_INFO_SIZE)
+                break;
+            FiffTag::read_tag_info(m_pFiffStreamIn.data(), m_pPendingTag, false);
+        }
+
+        //
+        // Wait for the next readyRead until the tag data are available
+        //
+        if(m_pTcpSocket->bytesAvailable() < m_pPendingTag->size())
+            break;
+
+        FiffTag::read_tag_data(m_pFiffStreamIn.data(), m_pPendingTag);
+
+        //
+        // Parse the tag
+        //
+        if(m_pPendingTag->kind == FIFF_MNE_RT_COMMAND)
+            parseCommand(m_pPendingTag);
+
+        m_pPendingTag.clear();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::onDisconnected()
+{
+    m_bIsSendingRawBuffer = false;
+    m_qListSendBlocks.clear();
+    m_iQueuedBytes.store(0);
+    m_iSendOffset = 0;
+
+    emit clientDisconnected(m_iDataClientId);
+}
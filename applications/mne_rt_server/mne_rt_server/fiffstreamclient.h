@@ -0,0 +1,343 @@
+//=============================================================================================================
+/**
+* @file     fiffstreamclient.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the FiffStreamClient Class.
+*
+*/
+
+#ifndef FIFFSTREAMCLIENT_H
+#define FIFFSTREAMCLIENT_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_tag.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QAtomicInt>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTSERVER
+//=============================================================================================================
+
+namespace RTSERVER
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define FIFFSTREAMCLIENT_SOCKET_BUFFER 4*1024*1024      /**< Bytes handed to the socket ahead of the network before queued blocks wait for bytesWritten */
+#define FIFFSTREAMCLIENT_MAX_QUEUE_BYTES 32*1024*1024   /**< Default bound of the raw buffer bytes queued behind the socket */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// TYPEDEFS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Queued send block. Raw buffers may be dropped by the slow consumer policy, control blocks are always sent.
+*/
+struct FiffStreamBlock
+{
+    QByteArray  data;           /**< Encoded fiff tag(s) */
+    bool        isRawBuffer;    /**< Whether the block is a droppable raw buffer */
+};
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS FiffStreamClient
+*
+* @brief The FiffStreamClient class serves one fiff data client. All clients of a FiffStreamServer live in a
+* single I/O thread and are driven by the socket readiness signals of its event loop, no client owns a thread.
+*/
+class FiffStreamClient : public QObject
+{
+    Q_OBJECT
+public:
+    //=========================================================================================================
+    /**
+    * Policy applied when the queued raw buffers exceed the queue bound, i.e. the client reads slower than the
+    * acquisition produces.
+    */
+    enum SendQueuePolicy
+    {
+        DropOldest = 0,     /**< Drop the oldest queued raw buffers */
+        DropNewest = 1,     /**< Drop the incoming raw buffers */
+        Disconnect = 2      /**< Close the connection to the client */
+    };
+
+    //=========================================================================================================
+    /**
+    * Constructs a FiffStreamClient. The socket is created here and attached to the descriptor by init(), after
+    * the client was moved to the I/O thread.
+    *
+    * @param[in] id                 The client id.
+    * @param[in] socketDescriptor   The accepted socket descriptor.
+    */
+    FiffStreamClient(qint32 id, qintptr socketDescriptor);
+
+    //=========================================================================================================
+    /**
+    * Destroys the FiffStreamClient and closes the connection.
+    */
+    ~FiffStreamClient();
+
+    //=========================================================================================================
+    /**
+    * Attaches the socket to the descriptor and connects the readiness notifications. Has to be invoked within
+    * the I/O thread.
+    */
+    Q_INVOKABLE void init();
+
+    inline qint32 getID();
+
+    inline QString getAlias();
+
+    //=========================================================================================================
+    /**
+    * Returns the send queue statistics. Safe to call from any thread.
+    *
+    * @param[out] p_iQueuedBytes        Bytes currently queued behind the socket.
+    * @param[out] p_iHighWaterBytes     Maximum of the queued bytes since the client connected.
+    * @param[out] p_iDroppedBuffers     Number of raw buffers dropped by the policy.
+    */
+    inline void getSendQueueStats(qint32& p_iQueuedBytes, qint32& p_iHighWaterBytes, qint32& p_iDroppedBuffers);
+
+    inline SendQueuePolicy getSendQueuePolicy();
+
+    inline qint32 getMaxQueuedBytes();
+
+//public slots: --> in Qt 5 not anymore declared as slot
+    void startMeas(qint32 ID);
+    void stopMeas(qint32 ID);
+    void sendMeasurementInfo(qint32 ID, FIFFLIB::FiffInfo p_fiffInfo);
+    void sendRawBuffer(QString p_sStream, QByteArray p_blockRawBuffer);
+
+    //=========================================================================================================
+    /**
+    * Sets the raw buffer stream the client receives and the subscription the sent measurement info describes.
+    *
+    * @param[in] ID             The client id.
+    * @param[in] p_sStream      Key of the stream, empty for float of all channels at full rate.
+    * @param[in] p_vecPicks     Subscribed channels; empty for all channels.
+    * @param[in] p_iDecimation  Decimation factor of the subscription.
+    */
+    void setStream(qint32 ID, QString p_sStream, Eigen::RowVectorXi p_vecPicks, qint32 p_iDecimation);
+    void setSendQueuePolicy(qint32 ID, qint32 p_iPolicy, qint32 p_iMaxBytes);
+
+signals:
+    void error(QTcpSocket::SocketError socketError);
+
+    //=========================================================================================================
+    /**
+    * Emitted when the peer closed the connection; the server removes and deletes the client.
+    *
+    * @param[in] id     The client id.
+    */
+    void clientDisconnected(qint32 id);
+
+    //=========================================================================================================
+    /**
+    * Emitted when the client requested a raw buffer encoding via MNE_RT_SET_ENCODING.
+    *
+    * @param[in] id         The client id.
+    * @param[in] p_sMethod  The requested method.
+    * @param[in] p_sPicks   The requested channels.
+    */
+    void requestEncoding(qint32 id, QString p_sMethod, QString p_sPicks);
+
+    //=========================================================================================================
+    /**
+    * Emitted when the client requested a channel subscription via MNE_RT_SET_SUBSCRIPTION.
+    *
+    * @param[in] id             The client id.
+    * @param[in] p_sPicks       The requested channels.
+    * @param[in] p_iDecimation  The requested decimation factor.
+    */
+    void requestSubscription(qint32 id, QString p_sPicks, qint32 p_iDecimation);
+
+private:
+    //=========================================================================================================
+    /**
+    * Reads all completely received tags; a tag whose data did not fully arrive yet is kept until the next
+    * readyRead.
+    */
+    void readTags();
+
+    //=========================================================================================================
+    /**
+    * Hands queued blocks to the socket until its write buffer holds FIFFSTREAMCLIENT_SOCKET_BUFFER bytes. The
+    * remainder is written when bytesWritten reports progress.
+    */
+    void flush();
+
+    void onDisconnected();
+
+    void parseCommand(FiffTag::SPtr p_pTag);
+
+    void writeClientId();
+
+    //=========================================================================================================
+    /**
+    * Appends an already encoded block to the send queue and flushes. Blocks are implicitly shared, so queuing
+    * a raw buffer block which was encoded by the server costs a reference count increment only. When the
+    * queued bytes exceed the bound afterwards, the slow consumer policy is applied.
+    *
+    * @param[in] p_blockData    encoded fiff tag(s) to send.
+    * @param[in] p_bIsRawBuffer whether the block is a raw buffer which may be dropped.
+    */
+    void enqueueBlock(const QByteArray& p_blockData, bool p_bIsRawBuffer = false);
+
+    //=========================================================================================================
+    /**
+    * Drops raw buffers or disconnects according to the policy until the queued bytes are within the bound.
+    */
+    void applySendQueuePolicy();
+
+    //=========================================================================================================
+    /**
+    * Removes the queued block at the given index and updates the queued bytes.
+    *
+    * @param[in] idx    index of the block within the queue.
+    */
+    void removeBlock(qint32 idx);
+
+    qint32 m_iDataClientId;
+    QString m_sDataClientAlias;
+    QMutex m_qMutexAlias;                   /**< Alias is read from the server thread */
+
+    qintptr m_iSocketDescriptor;
+    QTcpSocket* m_pTcpSocket;               /**< Child of this client, lives in the I/O thread */
+    FiffStream::SPtr m_pFiffStreamIn;
+    FiffTag::SPtr m_pPendingTag;            /**< Tag whose header was read but whose data is incomplete */
+
+    QList<FiffStreamBlock> m_qListSendBlocks;   /**< Blocks to send in order; raw buffer blocks are shared with all other clients */
+    qint32 m_iSendOffset;                       /**< Bytes of the first queued block already handed to the socket */
+
+    QAtomicInt m_iSendQueuePolicy;              /**< The SendQueuePolicy */
+    QAtomicInt m_iMaxQueuedBytes;               /**< Bound of the queued bytes */
+    QAtomicInt m_iQueuedBytes;                  /**< Bytes currently queued */
+    QAtomicInt m_iHighWaterBytes;               /**< Maximum of the queued bytes */
+    QAtomicInt m_iDroppedBuffers;               /**< Raw buffers dropped by the policy */
+
+    bool m_bIsSendingRawBuffer;
+    QString m_sStream;                          /**< Key of the raw buffer stream, empty for float of all channels at full rate */
+    Eigen::RowVectorXi m_vecPicks;              /**< Subscribed channels; empty for all channels */
+    qint32 m_iDecimation;                       /**< Decimation factor of the subscription */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 FiffStreamClient::getID()
+{
+    return m_iDataClientId;
+}
+
+
+//*************************************************************************************************************
+
+inline QString FiffStreamClient::getAlias()
+{
+    QMutexLocker t_locker(&m_qMutexAlias);
+    return m_sDataClientAlias;
+}
+
+
+//*************************************************************************************************************
+
+inline void FiffStreamClient::getSendQueueStats(qint32& p_iQueuedBytes, qint32& p_iHighWaterBytes, qint32& p_iDroppedBuffers)
+{
+    p_iQueuedBytes = m_iQueuedBytes.load();
+    p_iHighWaterBytes = m_iHighWaterBytes.load();
+    p_iDroppedBuffers = m_iDroppedBuffers.load();
+}
+
+
+//*************************************************************************************************************
+
+inline FiffStreamClient::SendQueuePolicy FiffStreamClient::getSendQueuePolicy()
+{
+    return (SendQueuePolicy)m_iSendQueuePolicy.load();
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 FiffStreamClient::getMaxQueuedBytes()
+{
+    return m_iMaxQueuedBytes.load();
+}
+
+} // NAMESPACE
+
+#endif //FIFFSTREAMCLIENT_H
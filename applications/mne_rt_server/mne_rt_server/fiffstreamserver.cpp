@@ -39,11 +39,19 @@
 //=============================================================================================================
 
 #include "fiffstreamserver.h"
-#include "fiffstreamthread.h"
+#include "fiffstreamclient.h"
 
 #include "mne_rt_server.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFF INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_rt_codec.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // STL INCLUDES
@@ -70,7 +78,10 @@ FiffStreamServer::FiffStreamServer(QObject *parent)
 : QTcpServer(parent)
 , m_iNextClientId(0)
 {
+    qRegisterMetaType<FIFFLIB::FiffInfo>("FIFFLIB::FiffInfo");
+    qRegisterMetaType<Eigen::RowVectorXi>("Eigen::RowVectorXi");
 
+    m_qClientIOThread.start();
 }
 
 
@@ -79,6 +90,11 @@ FiffStreamServer::FiffStreamServer(QObject *parent)
 FiffStreamServer::~FiffStreamServer()
 {
     emit closeFiffStreamServer();
+    m_qClientList.clear();
+
+    //Deferred deletes of the clients are processed when the I/O thread finishes
+    m_qClientIOThread.quit();
+    m_qClientIOThread.wait();
 }
 
 
@@ -89,7 +105,7 @@ void FiffStreamServer::comClist(Command p_command)
     //ToDo JSON
     QString t_sOutput("");
     t_sOutput.append("\tID\tAlias\r\n");
-    QMap<qint32, FiffStreamThread*>::iterator i;
+    QMap<qint32, FiffStreamClient*>::iterator i;
     for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
     {
         QString str = QString("\t%1\t%2\r\n").arg(i.key()).arg(i.value()->getAlias());
@@ -169,6 +185,126 @@ void FiffStreamServer::comStopAll(Command p_command)
 }
 
 
+//*************************************************************************************************************
+
+void FiffStreamServer::comQstat(Command p_command)
+{
+    QString t_sOutput("");
+    t_sOutput.append("\tID\tPolicy\t\tBound\t\tQueued\t\tHigh water\tDropped\r\n");
+    QMap<qint32, FiffStreamClient*>::iterator i;
+    for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
+    {
+        qint32 t_iQueuedBytes, t_iHighWaterBytes, t_iDroppedBuffers;
+        i.value()->getSendQueueStats(t_iQueuedBytes, t_iHighWaterBytes, t_iDroppedBuffers);
+
+        QString t_sPolicy;
+        switch(i.value()->getSendQueuePolicy())
+        {
+            case FiffStreamClient::DropNewest:  t_sPolicy = "drop-newest";  break;
+            case FiffStreamClient::Disconnect:  t_sPolicy = "disconnect";   break;
+            default:                            t_sPolicy = "drop-oldest";
+        }
+
+        QString str = QString("\t%1\t%2\t%3\t%4\t%5\t%6\r\n").arg(i.key()).arg(t_sPolicy, -12)
+                .arg(i.value()->getMaxQueuedBytes(), -12).arg(t_iQueuedBytes, -12).arg(t_iHighWaterBytes, -12).arg(t_iDroppedBuffers);
+        t_sOutput.append(str);
+    }
+    t_sOutput.append("\n");
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["qstat"].reply(t_sOutput);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comQpolicy(Command p_command)
+{
+    qint32 t_id = -1;
+    QString t_sOutput("");
+    QString t_sAlias(p_command.pValues()[0].toString());
+    t_sOutput.append(parseToId(t_sAlias,t_id));
+
+    QString t_sPolicy(p_command.pValues()[1].toString());
+    qint32 t_iPolicy = -1;
+    if(t_sPolicy.compare("drop-oldest", Qt::CaseInsensitive) == 0)
+        t_iPolicy = FiffStreamClient::DropOldest;
+    else if(t_sPolicy.compare("drop-newest", Qt::CaseInsensitive) == 0)
+        t_iPolicy = FiffStreamClient::DropNewest;
+    else if(t_sPolicy.compare("disconnect", Qt::CaseInsensitive) == 0)
+        t_iPolicy = FiffStreamClient::Disconnect;
+
+    qint32 t_iMaxBytes = p_command.pValues()[2].toInt();
+
+    if(t_iPolicy == -1)
+    {
+        t_sOutput.append("\twarning: unknown policy, use drop-oldest, drop-newest or disconnect\r\n\n");
+    }
+    else if(t_id != -1)
+    {
+        emit setSendQueuePolicyFiffStreamClient(t_id, t_iPolicy, t_iMaxBytes);
+
+        QString str = QString("\tFiffStreamClient (ID: %1) send queue policy set to %2").arg(t_id).arg(t_sPolicy);
+        if(t_iMaxBytes > 0)
+            str.append(QString(", bound %1 bytes").arg(t_iMaxBytes));
+        str.append("\r\n\n");
+        t_sOutput.append(str);
+    }
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["qpolicy"].reply(t_sOutput);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comEncoding(Command p_command)
+{
+    qint32 t_id = -1;
+    QString t_sOutput("");
+    QString t_sAlias(p_command.pValues()[0].toString());
+    t_sOutput.append(parseToId(t_sAlias,t_id));
+
+    QString t_sMethod(p_command.pValues()[1].toString());
+    QString t_sPicks(p_command.pValues()[2].toString());
+
+    if(t_id != -1)
+    {
+        if(setClientEncoding(t_id, t_sMethod, t_sPicks))
+        {
+            QString str = QString("\tFiffStreamClient (ID: %1) receives raw buffers as %2 of channels %3\r\n\n").arg(t_id).arg(t_sMethod).arg(t_sPicks);
+            t_sOutput.append(str);
+        }
+        else
+            t_sOutput.append("\twarning: use encoding <id> <float|int16|delta> <all|comma separated channel indices>\r\n\n");
+    }
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["encoding"].reply(t_sOutput);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comSubscribe(Command p_command)
+{
+    qint32 t_id = -1;
+    QString t_sOutput("");
+    QString t_sAlias(p_command.pValues()[0].toString());
+    t_sOutput.append(parseToId(t_sAlias,t_id));
+
+    QString t_sPicks(p_command.pValues()[1].toString());
+    bool t_isInt;
+    qint32 t_iDecimation = p_command.pValues()[2].toString().toInt(&t_isInt);
+
+    if(t_id != -1)
+    {
+        if(t_isInt && setClientSubscription(t_id, t_sPicks, t_iDecimation))
+        {
+            QString str = QString("\tFiffStreamClient (ID: %1) subscribed to channels %2 decimated by %3; request the measurement info of the subscribed stream\r\n\n").arg(t_id).arg(t_sPicks).arg(t_iDecimation);
+            t_sOutput.append(str);
+        }
+        else
+            t_sOutput.append("\twarning: use subscribe <id> <all|comma separated channel indices> <decimation factor>\r\n\n");
+    }
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["subscribe"].reply(t_sOutput);
+}
+
+
 //*************************************************************************************************************
 
 void FiffStreamServer::connectCommands()
@@ -181,6 +317,10 @@ void FiffStreamServer::connectCommands()
     QObject::connect(&t_pMNERTServer->getCommandManager()["start"], &Command::executed, this, &FiffStreamServer::comStart);
     QObject::connect(&t_pMNERTServer->getCommandManager()["stop"], &Command::executed, this, &FiffStreamServer::comStop);
     QObject::connect(&t_pMNERTServer->getCommandManager()["stop-all"], &Command::executed, this, &FiffStreamServer::comStopAll);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["qstat"], &Command::executed, this, &FiffStreamServer::comQstat);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["qpolicy"], &Command::executed, this, &FiffStreamServer::comQpolicy);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["encoding"], &Command::executed, this, &FiffStreamServer::comEncoding);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["subscribe"], &Command::executed, this, &FiffStreamServer::comSubscribe);
 
 //    t_pMNERTServer->getCommandManager().connectSlot(QString("clist"), this, &FiffStreamServer::comClist);
 //    t_pMNERTServer->getCommandManager().connectSlot(QString("measinfo"), this, &FiffStreamServer::comMeasinfo);
@@ -204,7 +344,7 @@ void FiffStreamServer::connectCommands()
 //        printf("clist\n");
 
 //        p_blockOutputInfo.append("\tID\tAlias\r\n");
-//        QMap<qint32, FiffStreamThread*>::iterator i;
+//        QMap<qint32, FiffStreamClient*>::iterator i;
 //        for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
 //        {
 //            QString str = QString("\t%1\t%2\r\n").arg(i.key()).arg(i.value()->getAlias());
@@ -318,7 +458,7 @@ QByteArray FiffStreamServer::parseToId(QString& p_sRawId, qint32& p_iParsedId)
         }
         else
         {
-            QMap<qint32, FiffStreamThread*>::iterator i;
+            QMap<qint32, FiffStreamClient*>::iterator i;
             for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
             {
                 if(i.value()->getAlias().compare(p_sRawId) == 0)
@@ -350,7 +490,7 @@ QByteArray FiffStreamServer::parseToId(QString& p_sRawId, qint32& p_iParsedId)
 
 //void FiffStreamServer::clearClients()
 //{
-//    QMap<qint32, FiffStreamThread*>::const_iterator i = m_qClientList.constBegin();
+//    QMap<qint32, FiffStreamClient*>::const_iterator i = m_qClientList.constBegin();
 //    while (i != m_qClientList.constEnd()) {
 //        if(i.value())
 //            delete i.value();
@@ -369,10 +509,171 @@ void FiffStreamServer::forwardMeasInfo(qint32 ID, FiffInfo p_fiffInfo)
 
 
 //*************************************************************************************************************
-//ToDo increase preformance --> try inline
+
 void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
 {
-    emit remitRawBuffer(m_pMatRawData);
+    if(m_qClientList.isEmpty())
+        return;
+
+    //
+    // Pick and decimate once per subscription; every subscription in use processes every buffer to keep its
+    // filter state continuous
+    //
+    QMap<QString, MatrixXf> t_qMapSubscribedData;
+    QMap<QString, FiffStreamSubscription>::iterator s;
+    for(s = m_qMapSubscriptions.begin(); s != m_qMapSubscriptions.end(); ++s)
+    {
+        MatrixXf t_matSubscribed;
+        if(s.value().process(*m_pMatRawData, t_matSubscribed))
+            t_qMapSubscribedData.insert(s.key(), t_matSubscribed);
+    }
+
+    //
+    // Encode the tag exactly once per stream (subscription and encoding) in use; each client only queues a
+    // reference to the shared block of its stream
+    //
+    QStringList t_qListStreams;
+    QMap<qint32, FiffStreamClient*>::const_iterator i;
+    for(i = m_qClientList.constBegin(); i != m_qClientList.constEnd(); ++i)
+    {
+        QString t_sStream = streamKey(i.key());
+        if(t_qListStreams.contains(t_sStream))
+            continue;
+        t_qListStreams.append(t_sStream);
+
+        const MatrixXf* t_pMatData = m_pMatRawData.data();
+        QString t_sSubscription = m_qMapClientSubscriptions.value(i.key());
+        if(!t_sSubscription.isEmpty())
+        {
+            QMap<QString, MatrixXf>::const_iterator d = t_qMapSubscribedData.constFind(t_sSubscription);
+            if(d == t_qMapSubscribedData.constEnd() || d.value().cols() == 0)
+                continue;
+            t_pMatData = &d.value();
+        }
+
+        QByteArray t_blockRawBuffer;
+        QString t_sEncoding = m_qMapClientEncodings.value(i.key());
+        if(t_sEncoding.isEmpty())
+            FiffRtCodec::encode(*t_pMatData, FiffRtCodec::Float, RowVectorXi(), t_blockRawBuffer);
+        else
+        {
+            const FiffStreamEncoding& t_encoding = m_qMapEncodings[t_sEncoding];
+            FiffRtCodec::encode(*t_pMatData, t_encoding.method, t_encoding.picks, t_blockRawBuffer);
+        }
+        emit remitRawBuffer(t_sStream, t_blockRawBuffer);
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStreamServer::setClientEncoding(qint32 ID, QString p_sMethod, QString p_sPicks)
+{
+    if(!m_qClientList.contains(ID))
+        return false;
+
+    FiffStreamEncoding t_encoding;
+    if(!FiffRtCodec::parseMethod(p_sMethod, t_encoding.method))
+        return false;
+
+    QStringList t_qListPicks;
+    if(!p_sPicks.isEmpty() && p_sPicks.compare("all", Qt::CaseInsensitive) != 0)
+        t_qListPicks = p_sPicks.split(",", QString::SkipEmptyParts);
+
+    t_encoding.picks.resize(t_qListPicks.size());
+    for(qint32 i = 0; i < t_qListPicks.size(); ++i)
+    {
+        bool t_isInt;
+        t_encoding.picks[i] = t_qListPicks[i].trimmed().toInt(&t_isInt);
+        if(!t_isInt || t_encoding.picks[i] < 0)
+            return false;
+    }
+
+    //
+    // Canonical key; float of all channels is the default block
+    //
+    QString t_sKey("");
+    if(t_encoding.method != FiffRtCodec::Float || t_encoding.picks.size() > 0)
+    {
+        t_sKey = p_sMethod.toLower() + ":";
+        for(qint32 i = 0; i < t_encoding.picks.size(); ++i)
+            t_sKey.append(QString(i > 0 ? ",%1" : "%1").arg(t_encoding.picks[i]));
+    }
+
+    QString t_sOldKey = m_qMapClientEncodings.value(ID);
+    if(t_sKey.isEmpty())
+        m_qMapClientEncodings.remove(ID);
+    else
+    {
+        m_qMapClientEncodings.insert(ID, t_sKey);
+        m_qMapEncodings.insert(t_sKey, t_encoding);
+    }
+
+    if(!t_sOldKey.isEmpty() && !m_qMapClientEncodings.values().contains(t_sOldKey))
+        m_qMapEncodings.remove(t_sOldKey);
+
+    updateClientStream(ID);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStreamServer::setClientSubscription(qint32 ID, QString p_sPicks, qint32 p_iDecimation)
+{
+    if(!m_qClientList.contains(ID))
+        return false;
+
+    FiffStreamSubscription t_subscription;
+    if(!FiffStreamSubscription::parse(p_sPicks, p_iDecimation, t_subscription))
+        return false;
+
+    QString t_sKey = t_subscription.key();
+
+    QString t_sOldKey = m_qMapClientSubscriptions.value(ID);
+    if(t_sKey.isEmpty())
+        m_qMapClientSubscriptions.remove(ID);
+    else
+    {
+        m_qMapClientSubscriptions.insert(ID, t_sKey);
+        //Clients joining a subscription in use continue its filter state
+        if(!m_qMapSubscriptions.contains(t_sKey))
+            m_qMapSubscriptions.insert(t_sKey, t_subscription);
+    }
+
+    if(!t_sOldKey.isEmpty() && !m_qMapClientSubscriptions.values().contains(t_sOldKey))
+        m_qMapSubscriptions.remove(t_sOldKey);
+
+    updateClientStream(ID);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+QString FiffStreamServer::streamKey(qint32 ID) const
+{
+    QString t_sSubscription = m_qMapClientSubscriptions.value(ID);
+    QString t_sEncoding = m_qMapClientEncodings.value(ID);
+
+    return t_sSubscription.isEmpty() ? t_sEncoding : t_sSubscription + "|" + t_sEncoding;
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::updateClientStream(qint32 ID)
+{
+    QString t_sSubscription = m_qMapClientSubscriptions.value(ID);
+    if(t_sSubscription.isEmpty())
+        emit setStreamFiffStreamClient(ID, streamKey(ID), RowVectorXi(), 1);
+    else
+    {
+        const FiffStreamSubscription& t_subscription = m_qMapSubscriptions[t_sSubscription];
+        emit setStreamFiffStreamClient(ID, streamKey(ID), t_subscription.picks(), t_subscription.decimation());
+    }
 }
 
 
@@ -380,14 +681,55 @@ void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRa
 
 void FiffStreamServer::incomingConnection(qintptr socketDescriptor)
 {
-    FiffStreamThread* t_pStreamThread = new FiffStreamThread(m_iNextClientId, socketDescriptor, this);
+    FiffStreamClient* t_pStreamClient = new FiffStreamClient(m_iNextClientId, socketDescriptor);
 
-    m_qClientList.insert(m_iNextClientId, t_pStreamThread);
+    m_qClientList.insert(m_iNextClientId, t_pStreamClient);
     ++m_iNextClientId;
 
-    //when thread has finished it gets deleted
-    connect(t_pStreamThread, SIGNAL(finished()), t_pStreamThread, SLOT(deleteLater()));
-    connect(this, SIGNAL(closeFiffStreamServer()), t_pStreamThread, SLOT(deleteLater()));
+    //
+    // All clients share one event loop; connections from the server are queued into the I/O thread
+    //
+    t_pStreamClient->moveToThread(&m_qClientIOThread);
+
+    connect(this, &FiffStreamServer::remitMeasInfo,
+            t_pStreamClient, &FiffStreamClient::sendMeasurementInfo);
+    connect(this, &FiffStreamServer::remitRawBuffer,
+            t_pStreamClient, &FiffStreamClient::sendRawBuffer);
+    connect(this, &FiffStreamServer::startMeasFiffStreamClient,
+            t_pStreamClient, &FiffStreamClient::startMeas);
+    connect(this, &FiffStreamServer::stopMeasFiffStreamClient,
+            t_pStreamClient, &FiffStreamClient::stopMeas);
+    connect(this, &FiffStreamServer::setSendQueuePolicyFiffStreamClient,
+            t_pStreamClient, &FiffStreamClient::setSendQueuePolicy);
+    connect(this, &FiffStreamServer::setStreamFiffStreamClient,
+            t_pStreamClient, &FiffStreamClient::setStream);
+    connect(t_pStreamClient, &FiffStreamClient::requestEncoding,
+            this, &FiffStreamServer::setClientEncoding);
+    connect(t_pStreamClient, &FiffStreamClient::requestSubscription,
+            this, &FiffStreamServer::setClientSubscription);
+
+    //when the peer disconnected the client gets removed and deleted
+    connect(t_pStreamClient, &FiffStreamClient::clientDisconnected,
+            this, &FiffStreamServer::removeClient);
+    connect(this, SIGNAL(closeFiffStreamServer()), t_pStreamClient, SLOT(deleteLater()));
+
+    QMetaObject::invokeMethod(t_pStreamClient, "init", Qt::QueuedConnection);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::removeClient(qint32 id)
+{
+    FiffStreamClient* t_pStreamClient = m_qClientList.take(id);
+    if(t_pStreamClient)
+        t_pStreamClient->deleteLater();
+
+    QString t_sKey = m_qMapClientEncodings.take(id);
+    if(!t_sKey.isEmpty() && !m_qMapClientEncodings.values().contains(t_sKey))
+        m_qMapEncodings.remove(t_sKey);
 
-    t_pStreamThread->start();
+    t_sKey = m_qMapClientSubscriptions.take(id);
+    if(!t_sKey.isEmpty() && !m_qMapClientSubscriptions.values().contains(t_sKey))
+        m_qMapSubscriptions.remove(t_sKey);
 }
@@ -41,7 +41,10 @@
 // MNE INCLUDES
 //=============================================================================================================
 
+#include "fiffstreamsubscription.h"
+
 #include <fiff/fiff_info.h>
+#include <fiff/fiff_rt_codec.h>
 #include <rtCommand/commandmanager.h>
 
 
@@ -50,8 +53,10 @@
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QByteArray>
 #include <QStringList>
 #include <QTcpServer>
+#include <QThread>
 
 
 //*************************************************************************************************************
@@ -76,7 +81,18 @@ using namespace RTCOMMANDLIB;
 // FORWARD DECLARATIONS
 //=============================================================================================================
 
-class FiffStreamThread;
+class FiffStreamClient;
+
+
+//=============================================================================================================
+/**
+* Raw buffer encoding requested by one or more fiff data clients
+*/
+struct FiffStreamEncoding
+{
+    FiffRtCodec::Method method; /**< Sample encoding */
+    RowVectorXi         picks;  /**< Streamed channels; empty for all channels */
+};
 
 //=============================================================================================================
 /**
@@ -88,8 +104,6 @@ class FiffStreamServer : public QTcpServer//, public ICommandParser //OLD remove
 {
     Q_OBJECT
 
-    friend class FiffStreamThread;
-
 public:
 
     FiffStreamServer(QObject *parent = 0);
@@ -104,7 +118,7 @@ public:
     /**
     * ToDo...
     */
-    inline FiffStreamThread* getClient(qint32 id);
+    inline FiffStreamClient* getClient(qint32 id);
 
     //=========================================================================================================
     /**
@@ -123,16 +137,52 @@ public:
 
 //public slots: --> in Qt 5 not anymore declared as slot
     void forwardMeasInfo(qint32 ID, FiffInfo p_fiffInfo);
+    //=========================================================================================================
+    /**
+    * Picks and decimates the raw buffer once per subscription, encodes it once per distinct stream and hands
+    * the immutable, implicitly shared blocks to all stream clients.
+    *
+    * @param[in] m_pMatRawData  The raw buffer to forward.
+    */
     void forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
 
+    //=========================================================================================================
+    /**
+    * Sets the raw buffer encoding of a fiff data client. Each distinct encoding in use is encoded once per
+    * raw buffer.
+    *
+    * @param[in] ID         The client id.
+    * @param[in] p_sMethod  "float", "int16" or "delta".
+    * @param[in] p_sPicks   Comma separated channel indices of the subscribed stream, empty or "all" for all channels.
+    *
+    * @return true if the encoding is valid.
+    */
+    bool setClientEncoding(qint32 ID, QString p_sMethod, QString p_sPicks);
+
+    //=========================================================================================================
+    /**
+    * Subscribes a fiff data client to a channel selection at an integer fraction of the sample rate. Each
+    * distinct subscription in use is picked and decimated once per raw buffer before its encoding. The client
+    * has to request the measurement info after subscribing, the sent info describes the subscribed stream.
+    *
+    * @param[in] ID             The client id.
+    * @param[in] p_sPicks       Comma separated channel indices, empty or "all" for all channels.
+    * @param[in] p_iDecimation  Integer decimation factor, 1 for the full rate.
+    *
+    * @return true if the subscription is valid.
+    */
+    bool setClientSubscription(qint32 ID, QString p_sPicks, qint32 p_iDecimation);
+
 signals:
     void requestMeasInfo(qint32 ID);
 
     void startMeasFiffStreamClient(qint32 ID);
     void stopMeasFiffStreamClient(qint32 ID);
+    void setSendQueuePolicyFiffStreamClient(qint32 ID, qint32 p_iPolicy, qint32 p_iMaxBytes);
 
     void remitMeasInfo(qint32 ID, FIFFLIB::FiffInfo p_fiffInfo);
-    void remitRawBuffer(QSharedPointer<Eigen::MatrixXf>);
+    void remitRawBuffer(QString p_sEncoding, QByteArray p_blockRawBuffer);
+    void setStreamFiffStreamClient(qint32 ID, QString p_sStream, Eigen::RowVectorXi p_vecPicks, qint32 p_iDecimation);
 
     void closeFiffStreamServer();
 
@@ -181,11 +231,77 @@ private:
     */
     void comStopAll(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Prints and sends the send queue statistics of all fiff data clients
+    *
+    * @param[in] p_command  The queue statistics command.
+    */
+    void comQstat(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the slow consumer policy and the queue bound of a fiff data client
+    *
+    * @param[in] p_command  The queue policy command.
+    */
+    void comQpolicy(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the raw buffer encoding of a fiff data client
+    *
+    * @param[in] p_command  The encoding command.
+    */
+    void comEncoding(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the channel subscription and decimation of a fiff data client
+    *
+    * @param[in] p_command  The subscribe command.
+    */
+    void comSubscribe(Command p_command);
+
     QByteArray parseToId(QString& p_sRawId, qint32& p_iParsedId);
 
-    QMap<qint32, FiffStreamThread*> m_qClientList;
+    //=========================================================================================================
+    /**
+    * Removes a disconnected client from the client list and deletes it within the I/O thread.
+    *
+    * @param[in] id     The client id.
+    */
+    void removeClient(qint32 id);
+
+    //=========================================================================================================
+    /**
+    * Key of the raw buffer stream a client receives, empty for float of all channels at full rate.
+    *
+    * @param[in] ID     The client id.
+    *
+    * @return the stream key.
+    */
+    QString streamKey(qint32 ID) const;
+
+    //=========================================================================================================
+    /**
+    * Hands the stream key and the subscription of a client to the client.
+    *
+    * @param[in] ID     The client id.
+    */
+    void updateClientStream(qint32 ID);
+
+    QMap<qint32, FiffStreamClient*> m_qClientList;
     qint32                          m_iNextClientId;
 
+    QMap<QString, FiffStreamEncoding>   m_qMapEncodings;        /**< Encodings in use other than float of all channels */
+    QMap<qint32, QString>               m_qMapClientEncodings;  /**< Encoding of each client which does not use the default */
+
+    QMap<QString, FiffStreamSubscription>   m_qMapSubscriptions;        /**< Subscriptions in use other than all channels at full rate, holding their filter state */
+    QMap<qint32, QString>                   m_qMapClientSubscriptions;  /**< Subscription of each client which does not use the default */
+
+    QThread                         m_qClientIOThread;  /**< Single event loop serving all data client sockets */
+
 };
 
 
@@ -194,11 +310,14 @@ private:
 // INLINE DEFINITIONS
 //=============================================================================================================
 
-FiffStreamThread* FiffStreamServer::getClient(qint32 id)
+FiffStreamClient* FiffStreamServer::getClient(qint32 id)
 {
     return m_qClientList[id];
 }
 
 } // NAMESPACE
 
+Q_DECLARE_METATYPE(FIFFLIB::FiffInfo); /**< Provides QT META type declaration of the FIFFLIB::FiffInfo type. For signal/slot usage.*/
+Q_DECLARE_METATYPE(Eigen::RowVectorXi); /**< Provides QT META type declaration of the Eigen::RowVectorXi type. For signal/slot usage.*/
+
 #endif //FIFFSTREAMSERVER_H
@@ -0,0 +1,214 @@
+//=============================================================================================================
+/**
+* @file     fiffstreamsubscription.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the FiffStreamSubscription Class.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiffstreamsubscription.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QStringList>
+#include <qmath.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTSERVER;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffStreamSubscription::FiffStreamSubscription()
+: m_iDecimation(1)
+, m_iPhase(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+FiffStreamSubscription::FiffStreamSubscription(const RowVectorXi& p_vecPicks, qint32 p_iDecimation)
+: m_vecPicks(p_vecPicks)
+, m_iDecimation(p_iDecimation > 1 ? p_iDecimation : 1)
+, m_iPhase(0)
+{
+    if(m_iDecimation > 1)
+    {
+        //
+        // Hamming windowed sinc, cutoff at the new Nyquist frequency, unity gain at DC
+        //
+        qint32 t_iTaps = FIFFSTREAMSUBSCRIPTION_TAPS_PER_FACTOR*m_iDecimation + 1;
+        double t_dCenter = (t_iTaps - 1)/2.0;
+        double t_dCutoff = 0.5/m_iDecimation;
+
+        m_vecFilter.resize(t_iTaps);
+        for(qint32 i = 0; i < t_iTaps; ++i)
+        {
+            double t_dX = i - t_dCenter;
+            double t_dSinc = t_dX == 0 ? 2.0*t_dCutoff : sin(2.0*M_PI*t_dCutoff*t_dX)/(M_PI*t_dX);
+            double t_dWindow = 0.54 - 0.46*cos(2.0*M_PI*i/(t_iTaps - 1));
+            m_vecFilter[i] = (float)(t_dSinc*t_dWindow);
+        }
+        m_vecFilter /= m_vecFilter.sum();
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStreamSubscription::parse(const QString& p_sPicks, qint32 p_iDecimation, FiffStreamSubscription& p_Subscription)
+{
+    if(p_iDecimation < 1)
+        return false;
+
+    QStringList t_qListPicks;
+    if(!p_sPicks.isEmpty() && p_sPicks.compare("all", Qt::CaseInsensitive) != 0)
+        t_qListPicks = p_sPicks.split(",", QString::SkipEmptyParts);
+
+    RowVectorXi t_vecPicks(t_qListPicks.size());
+    for(qint32 i = 0; i < t_qListPicks.size(); ++i)
+    {
+        bool t_isInt;
+        t_vecPicks[i] = t_qListPicks[i].trimmed().toInt(&t_isInt);
+        if(!t_isInt || t_vecPicks[i] < 0)
+            return false;
+    }
+
+    p_Subscription = FiffStreamSubscription(t_vecPicks, p_iDecimation);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+FiffInfo FiffStreamSubscription::subscribedInfo(const FiffInfo& p_fiffInfo, const RowVectorXi& p_vecPicks, qint32 p_iDecimation)
+{
+    FiffInfo t_fiffInfo = p_vecPicks.size() > 0 ? p_fiffInfo.pick_info(p_vecPicks) : p_fiffInfo;
+
+    if(p_iDecimation > 1)
+    {
+        t_fiffInfo.sfreq /= p_iDecimation;
+        if(t_fiffInfo.lowpass > t_fiffInfo.sfreq/2.0f)
+            t_fiffInfo.lowpass = t_fiffInfo.sfreq/2.0f;
+    }
+
+    return t_fiffInfo;
+}
+
+
+//*************************************************************************************************************
+
+QString FiffStreamSubscription::key() const
+{
+    if(m_vecPicks.size() == 0 && m_iDecimation == 1)
+        return QString("");
+
+    QString t_sKey(m_vecPicks.size() == 0 ? "all" : "");
+    for(qint32 i = 0; i < m_vecPicks.size(); ++i)
+        t_sKey.append(QString(i > 0 ? ",%1" : "%1").arg(m_vecPicks[i]));
+    t_sKey.append(QString("/%1").arg(m_iDecimation));
+
+    return t_sKey;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStreamSubscription::process(const MatrixXf& p_matData, MatrixXf& p_matOut)
+{
+    MatrixXf t_matPicked;
+    if(m_vecPicks.size() > 0)
+    {
+        t_matPicked.resize(m_vecPicks.size(), p_matData.cols());
+        for(qint32 i = 0; i < m_vecPicks.size(); ++i)
+        {
+            if(m_vecPicks[i] >= p_matData.rows())
+                return false;
+            t_matPicked.row(i) = p_matData.row(m_vecPicks[i]);
+        }
+    }
+    else
+        t_matPicked = p_matData;
+
+    if(m_iDecimation == 1)
+    {
+        p_matOut = t_matPicked;
+        return true;
+    }
+
+    qint32 t_iTaps = m_vecFilter.size();
+    qint32 t_iSamples = t_matPicked.cols();
+
+    //
+    // Start from silence on the first buffer or when the channel count changed
+    //
+    if(m_matHistory.rows() != t_matPicked.rows())
+    {
+        m_matHistory = MatrixXf::Zero(t_matPicked.rows(), t_iTaps - 1);
+        m_iPhase = 0;
+    }
+
+    MatrixXf t_matExtended(t_matPicked.rows(), t_iTaps - 1 + t_iSamples);
+    t_matExtended << m_matHistory, t_matPicked;
+
+    //
+    // The filter is evaluated at the retained samples only
+    //
+    qint32 t_iOut = m_iPhase < t_iSamples ? (t_iSamples - 1 - m_iPhase)/m_iDecimation + 1 : 0;
+    p_matOut.resize(t_matPicked.rows(), t_iOut);
+    for(qint32 i = 0; i < t_iOut; ++i)
+        p_matOut.col(i).noalias() = t_matExtended.middleCols(m_iPhase + i*m_iDecimation, t_iTaps) * m_vecFilter;
+
+    m_matHistory = t_matExtended.rightCols(t_iTaps - 1);
+    m_iPhase += t_iOut*m_iDecimation - t_iSamples;
+
+    return true;
+}
@@ -0,0 +1,194 @@
+//=============================================================================================================
+/**
+* @file     fiffstreamsubscription.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     declaration of the FiffStreamSubscription Class.
+*
+*/
+
+
+#ifndef FIFFSTREAMSUBSCRIPTION_H
+#define FIFFSTREAMSUBSCRIPTION_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MNE INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_info.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTSERVER
+//=============================================================================================================
+
+namespace RTSERVER
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define FIFFSTREAMSUBSCRIPTION_TAPS_PER_FACTOR 8    /**< Anti-alias FIR length per unit of the decimation factor */
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS FiffStreamSubscription
+*
+* @brief The FiffStreamSubscription class picks channels of the raw buffers and decimates them by an integer
+* factor. The anti-alias low-pass is a Hamming windowed sinc with its cutoff at the new Nyquist frequency,
+* evaluated at the retained samples only. Filter history and decimation phase are carried across buffers, so
+* the subscribed stream is continuous. The FiffStreamServer keeps one subscription per distinct selection and
+* factor and processes it once per raw buffer for all clients sharing it.
+*/
+class FiffStreamSubscription
+{
+public:
+    //=========================================================================================================
+    /**
+    * Default constructor, all channels at full rate.
+    */
+    FiffStreamSubscription();
+
+    //=========================================================================================================
+    /**
+    * Constructs a subscription.
+    *
+    * @param[in] p_vecPicks     Subscribed channel indices; empty for all channels.
+    * @param[in] p_iDecimation  Integer decimation factor >= 1.
+    */
+    FiffStreamSubscription(const RowVectorXi& p_vecPicks, qint32 p_iDecimation);
+
+    //=========================================================================================================
+    /**
+    * Parses a subscription request.
+    *
+    * @param[in] p_sPicks           Comma separated channel indices, empty or "all" for all channels.
+    * @param[in] p_iDecimation      Integer decimation factor >= 1.
+    * @param[out] p_Subscription    The parsed subscription.
+    *
+    * @return true if the request is valid.
+    */
+    static bool parse(const QString& p_sPicks, qint32 p_iDecimation, FiffStreamSubscription& p_Subscription);
+
+    //=========================================================================================================
+    /**
+    * Returns the measurement info of the subscribed stream: the picked channels and the decimated sample
+    * frequency, with the low-pass limited to the anti-alias cutoff.
+    *
+    * @param[in] p_fiffInfo     Measurement info of the full stream.
+    * @param[in] p_vecPicks     Subscribed channel indices; empty for all channels.
+    * @param[in] p_iDecimation  Integer decimation factor.
+    *
+    * @return the info of the subscribed stream.
+    */
+    static FiffInfo subscribedInfo(const FiffInfo& p_fiffInfo, const RowVectorXi& p_vecPicks, qint32 p_iDecimation);
+
+    //=========================================================================================================
+    /**
+    * Canonical key of the subscription, empty for all channels at full rate.
+    *
+    * @return the key.
+    */
+    QString key() const;
+
+    //=========================================================================================================
+    /**
+    * Picks and decimates the next raw buffer.
+    *
+    * @param[in] p_matData  Raw buffer of all channels.
+    * @param[out] p_matOut  Subscribed samples; may hold no sample when the buffer is shorter than the factor.
+    *
+    * @return false if a pick exceeds the channels of the buffer.
+    */
+    bool process(const MatrixXf& p_matData, MatrixXf& p_matOut);
+
+    inline const RowVectorXi& picks() const;
+
+    inline qint32 decimation() const;
+
+private:
+    RowVectorXi m_vecPicks;         /**< Subscribed channels; empty for all channels */
+    qint32 m_iDecimation;           /**< Decimation factor */
+    VectorXf m_vecFilter;           /**< Symmetric anti-alias FIR */
+    MatrixXf m_matHistory;          /**< Last taps-1 samples of the picked channels */
+    qint32 m_iPhase;                /**< Offset of the next retained sample within the next buffer */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline const RowVectorXi& FiffStreamSubscription::picks() const
+{
+    return m_vecPicks;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 FiffStreamSubscription::decimation() const
+{
+    return m_iDecimation;
+}
+
+} // NAMESPACE
+
+#endif // FIFFSTREAMSUBSCRIPTION_H
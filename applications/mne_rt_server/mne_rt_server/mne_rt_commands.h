@@ -51,6 +51,8 @@ namespace RTSERVER
 
 #define MNE_RT_GET_CLIENT_ID        1       /**< Request client id at mne_rt_server */
 #define MNE_RT_SET_CLIENT_ALIAS     2       /**< Set client alias at mne_rt_server */
+#define MNE_RT_SET_ENCODING         3       /**< Set raw buffer encoding "<float|int16|delta> [picks]" at mne_rt_server */
+#define MNE_RT_SET_SUBSCRIPTION     4       /**< Set channel subscription "<decimation> [picks]" at mne_rt_server */
 
 } // NAMESPACE
 
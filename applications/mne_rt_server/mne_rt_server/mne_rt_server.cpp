@@ -328,6 +328,23 @@ void MNERTServer::init()
             "           \"description\": \"Prints and sends all available connectors.\","
             "           \"parameters\": {}"
             "        },"
+            "       \"encoding\": {"
+            "           \"description\": \"Sets the raw buffer encoding (float, int16, delta) and the streamed channels of the specified FiffStreamClient.\","
+            "           \"parameters\": {"
+            "               \"id\": {"
+            "                   \"description\": \"ID/Alias\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"method\": {"
+            "                   \"description\": \"Encoding\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"picks\": {"
+            "                   \"description\": \"all or comma separated channel indices\","
+            "                   \"type\": \"QString\" "
+            "               }"
+            "           }"
+            "        },"
             "       \"help\": {"
             "           \"description\": \"Prints and sends this list.\","
             "           \"parameters\": {}"
@@ -341,6 +358,27 @@ void MNERTServer::init()
             "               }"
             "           }"
             "       },"
+            "       \"qpolicy\": {"
+            "           \"description\": \"Sets the slow consumer policy (drop-oldest, drop-newest, disconnect) and the send queue bound in bytes of the specified FiffStreamClient.\","
+            "           \"parameters\": {"
+            "               \"id\": {"
+            "                   \"description\": \"ID/Alias\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"policy\": {"
+            "                   \"description\": \"Policy\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"size\": {"
+            "                   \"description\": \"Bound in bytes, 0 keeps the current bound\","
+            "                   \"type\": \"int\" "
+            "               }"
+            "           }"
+            "        },"
+            "       \"qstat\": {"
+            "           \"description\": \"Prints and sends the send queue statistics of all FiffStreamClients.\","
+            "           \"parameters\": {}"
+            "        },"
             "       \"selcon\": {"
             "           \"description\": \"Selects a new connector, if a measurement is running it will be stopped.\","
             "           \"parameters\": {"
@@ -371,6 +409,23 @@ void MNERTServer::init()
             "       \"stop-all\": {"
             "           \"description\": \"Stops the whole acquisition process.\","
             "           \"parameters\": {}"
+            "        },"
+            "       \"subscribe\": {"
+            "           \"description\": \"Subscribes the specified FiffStreamClient to a channel selection decimated by an integer factor.\","
+            "           \"parameters\": {"
+            "               \"id\": {"
+            "                   \"description\": \"ID/Alias\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"picks\": {"
+            "                   \"description\": \"all or comma separated channel indices\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"ratio\": {"
+            "                   \"description\": \"Decimation factor\","
+            "                   \"type\": \"QString\" "
+            "               }"
+            "           }"
             "        }"
             "    }"
             "}";
@@ -74,7 +74,8 @@ SOURCES += \
     connectormanager.cpp \
     mne_rt_server.cpp \
     fiffstreamserver.cpp \
-    fiffstreamthread.cpp \
+    fiffstreamclient.cpp \
+    fiffstreamsubscription.cpp \
     commandserver.cpp \
     commandthread.cpp
 
@@ -86,7 +87,8 @@ HEADERS += \
     mne_rt_server.h \
     mne_rt_server.h \
     fiffstreamserver.h \
-    fiffstreamthread.h \
+    fiffstreamclient.h \
+    fiffstreamsubscription.h \
     commandserver.h \
     commandthread.h \
     mne_rt_commands.h
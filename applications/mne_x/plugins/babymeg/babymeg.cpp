@@ -379,7 +379,7 @@ void BabyMeg::run()
     while(true)
     {
         //pop matrix
-        matValue = m_pRawMatrixBuffer_In->pop();
+        m_pRawMatrixBuffer_In->popInto(matValue);
 
 //        std::cout << "matValue " << matValue.block(0,0,1,50) << std::endl;
 
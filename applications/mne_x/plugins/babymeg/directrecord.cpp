@@ -8,36 +8,33 @@ DirectRecord::DirectRecord()
 
 //*************************************************************************************************************
 
-bool DirectRecord::start()
+bool DirectRecord::start(const QString& p_sFileName, const FIFFLIB::FiffInfo& p_FiffInfo, qint32 p_iNumSamples)
 {
+    m_qFile.setFileName(p_sFileName);
 
-    // Start threads
-    QThread::start();
-
-    return true;
+    // Start writer thread
+    return m_rawWriter.open(m_qFile, p_FiffInfo, p_iNumSamples);
 }
 
 
 //*************************************************************************************************************
 
-bool DirectRecord::stop()
+bool DirectRecord::append(const Eigen::MatrixXf& p_matRawBuffer)
 {
-    // Stop threads
-    QThread::terminate();
-    QThread::wait();
-
-    //Clear Buffers
+    m_matBuffer = p_matRawBuffer.cast<double>();
 
-    return true;
+    return m_rawWriter.write(m_matBuffer);
 }
 
 
 //*************************************************************************************************************
 
-void DirectRecord::run()
+bool DirectRecord::stop()
 {
-    while(true)
-    {
+    // Stop writer thread
+    bool t_bSuccess = m_rawWriter.close();
+
+    printf("DirectRecord: acquisition stalled %lld times for writing, at most %.3f ms\n", m_rawWriter.stalls(), m_rawWriter.maxStallNs()*1e-6);
 
-    }
+    return t_bSuccess;
 }
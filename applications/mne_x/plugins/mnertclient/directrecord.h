@@ -33,31 +33,76 @@
 *
 */
 
+
 #ifndef DIRECTRECORD_H
 #define DIRECTRECORD_H
 
-#include <QThread>
 
-class DirectRecord : public QThread
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_raw_writer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QObject>
+#include <QFile>
+
+
+//=============================================================================================================
+/**
+* Records the incoming raw buffers to a fiff file. Writing runs on the thread of a FIFFLIB::FiffRawWriter, so
+* a slow disk does not stall the acquisition.
+*
+* @brief Direct raw data recording
+*/
+class DirectRecord : public QObject
 {
     Q_OBJECT
 public:
 
     explicit DirectRecord();
 
-    virtual bool start();
-    virtual bool stop();
-
-signals:
+    //=========================================================================================================
+    /**
+    * Starts recording.
+    *
+    * @param[in] p_sFileName    The fiff file to record to
+    * @param[in] p_FiffInfo     The measurement info of the stream
+    * @param[in] p_iNumSamples  Samples per raw buffer
+    *
+    * @return true if succeeded, false otherwise
+    */
+    virtual bool start(const QString& p_sFileName, const FIFFLIB::FiffInfo& p_FiffInfo, qint32 p_iNumSamples);
 
-//slots:
+    //=========================================================================================================
+    /**
+    * Queues a calibrated raw buffer for recording.
+    *
+    * @param[in] p_matRawBuffer     The raw buffer
+    *
+    * @return true if queued, false otherwise
+    */
+    bool append(const Eigen::MatrixXf& p_matRawBuffer);
 
-protected:
-    virtual void run();
+    //=========================================================================================================
+    /**
+    * Writes the queued buffers and finishes the file.
+    *
+    * @return true if all buffers were recorded, false otherwise
+    */
+    virtual bool stop();
 
 private:
-
-    
+    QFile m_qFile;                          /**< The recorded file. */
+    FIFFLIB::FiffRawWriter m_rawWriter;     /**< The asynchronous writer. */
+    Eigen::MatrixXd m_matBuffer;            /**< Double precision copy of the appended buffer. */
 };
 
 #endif // DIRECTRECORD_H
@@ -301,6 +301,13 @@ void SourceLab::run()
     m_pRtAve = RtAve::SPtr(new RtAve(750, 750, m_pFiffInfo));
     connect(m_pRtAve.data(), &RtAve::evokedStim, this, &SourceLab::appendEvoked);
 
+    //
+    // Share the incoming data with the rt helpers
+    //
+    m_pRawBroadcastBuffer = BroadcastMatrixBuffer<double>::SPtr(new BroadcastMatrixBuffer<double>(128));
+    m_pRtCov->setRawBuffer(m_pRawBroadcastBuffer);
+    m_pRtAve->setRawBuffer(m_pRawBroadcastBuffer);
+
     //
     // Start the rt helpers
     //
@@ -332,11 +339,11 @@ void SourceLab::run()
         if(nrows > 0) // check if init
         {
             /* Dispatch the inputs */
-            MatrixXd t_mat = m_pSourceLabBuffer->pop();
+            QSharedPointer<MatrixXd> t_pMat(new MatrixXd);
+            m_pSourceLabBuffer->popInto(*t_pMat);
 
-            //Add to covariance estimation
-            m_pRtCov->append(t_mat);
-            m_pRtAve->append(t_mat);
+            //Publish once to covariance estimation and averaging
+            m_pRawBroadcastBuffer->push(t_pMat);
 
             if(m_pMinimumNorm && m_qVecEvokedData.size() > 0)
             {
@@ -46,6 +46,7 @@
 #include <mne_x/Interfaces/IRTAlgorithm.h>
 
 #include <generics/circularmatrixbuffer.h>
+#include <generics/broadcastmatrixbuffer.h>
 
 #include <fs/annotationset.h>
 #include <fiff/fiff_info.h>
@@ -182,6 +183,7 @@ private:
     QMutex mutex;
 
     CircularMatrixBuffer<double>::SPtr m_pSourceLabBuffer;   /**< Holds incoming rt server data.*/
+    BroadcastMatrixBuffer<double>::SPtr m_pRawBroadcastBuffer;  /**< Shares the incoming data with the real-time algorithms.*/
 
     bool m_bIsRunning;      /**< If source lab is running */
     bool m_bReceiveData;    /**< If thread is ready to receive data */
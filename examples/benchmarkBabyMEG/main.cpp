@@ -0,0 +1,350 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+* @brief    Measures throughput and latency of the BabyMEG acquisition protocol over loopback against a local
+*           stand-in of the acquisition PC, for stop-and-wait and for several pipelined request windows.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <string.h>
+
+#include <utils/ioutils.h>
+
+#include "babymegclient.h"
+#include "babymeginfo.h"
+
+#include "../benchmarkhelpers.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QAtomicInt>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static QElapsedTimer    s_timer;            /**< Common monotonic clock of the stand-in server and the consumer */
+static QAtomicInt       s_iBlocksReceived;  /**< Number of blocks taken from the queue by the consumer */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// BabyMEGStandIn
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Emulates the acquisition PC: every DATA request is answered with a DATR frame of nchan x nsamp big endian
+* floats after the given link delay. The first 8 sample bytes carry the send time of the frame. QUIT is
+* answered with QUIT, QREL closes the connection.
+*/
+class BabyMEGStandIn : public QTcpServer
+{
+public:
+    BabyMEGStandIn(qint32 p_iNumChannels, qint32 p_iNumSamples, qint32 p_iDelayMs)
+    : m_iDelayMs(p_iDelayMs)
+    , m_pSocket(NULL)
+    {
+        // header and format byte, then the samples; the template is never modified
+        qint32 t_iLength = 1 + p_iNumChannels*p_iNumSamples*4;
+        m_blockHeader.append("DATR");
+        m_blockHeader.append(QByteArray(4, 0));
+        qToBigEndian<qint32>(t_iLength, (uchar*)m_blockHeader.data() + 4);
+        m_blockHeader.append('4');
+
+        m_blockSamples.resize(p_iNumChannels*p_iNumSamples*4);
+        float* t_pSamples = (float*)m_blockSamples.data();
+        for(qint32 i = 0; i < m_blockSamples.size()/4; ++i)
+        {
+            t_pSamples[i] = (float)(i % 1000)*1e-15f;
+            IOUtils::swap_floatp(t_pSamples + i);
+        }
+
+        m_timer.setInterval(1);
+        connect(&m_timer, &QTimer::timeout, this, &BabyMEGStandIn::sendDue);
+    }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor)
+    {
+        delete m_pSocket;
+        m_pSocket = new QTcpSocket(this);
+        m_pSocket->setSocketDescriptor(socketDescriptor);
+        m_pSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_listDue.clear();
+        connect(m_pSocket, &QTcpSocket::readyRead, this, &BabyMEGStandIn::readCommands);
+    }
+
+private:
+    void readCommands()
+    {
+        while(m_pSocket->bytesAvailable() >= 4)
+        {
+            QByteArray t_blockCmd = m_pSocket->read(4);
+            if(t_blockCmd == "DATA")
+            {
+                if(m_iDelayMs > 0)
+                {
+                    m_listDue.append(s_timer.elapsed() + m_iDelayMs);
+                    if(!m_timer.isActive())
+                        m_timer.start();
+                }
+                else
+                    sendBlock();
+            }
+            else if(t_blockCmd == "QUIT")
+                m_pSocket->write(QByteArray("QUIT\0\0\0\0", 8));
+            else if(t_blockCmd == "QREL")
+                m_pSocket->disconnectFromHost();
+        }
+    }
+
+    void sendDue()
+    {
+        qint64 t_iNow = s_timer.elapsed();
+        while(!m_listDue.isEmpty() && m_listDue.first() <= t_iNow)
+        {
+            m_listDue.removeFirst();
+            sendBlock();
+        }
+        if(m_listDue.isEmpty())
+            m_timer.stop();
+    }
+
+    void sendBlock()
+    {
+        qint64 t_iSendNs = s_timer.nsecsElapsed();
+        m_pSocket->write(m_blockHeader);
+        m_pSocket->write((const char*)&t_iSendNs, 8);
+        m_pSocket->write(m_blockSamples.constData() + 8, m_blockSamples.size() - 8);
+    }
+
+    qint32 m_iDelayMs;
+    QByteArray m_blockHeader;
+    QByteArray m_blockSamples;
+    QTcpSocket* m_pSocket;
+    QList<qint64> m_listDue;
+    QTimer m_timer;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// StandInThread
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Runs the stand-in server in its own event loop, as the acquisition PC is a separate machine.
+*/
+class StandInThread : public QThread
+{
+public:
+    StandInThread(qint32 p_iNumChannels, qint32 p_iNumSamples, qint32 p_iDelayMs)
+    : m_iNumChannels(p_iNumChannels)
+    , m_iNumSamples(p_iNumSamples)
+    , m_iDelayMs(p_iDelayMs)
+    {
+    }
+
+    void run()
+    {
+        BabyMEGStandIn t_standIn(m_iNumChannels, m_iNumSamples, m_iDelayMs);
+        t_standIn.listen(QHostAddress::LocalHost, 0);
+        m_iPort.storeRelease(t_standIn.serverPort());
+        exec();
+    }
+
+    QAtomicInt m_iPort;
+
+private:
+    qint32 m_iNumChannels;
+    qint32 m_iNumSamples;
+    qint32 m_iDelayMs;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// ConsumerThread
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Takes the blocks from the queue of BabyMEGInfo and converts them like the BabyMEG connector does.
+*/
+class ConsumerThread : public QThread
+{
+public:
+    ConsumerThread(BabyMEGInfo* p_pInfo, qint32 p_iNumChannels, qint32 p_iNumBlocks)
+    : m_pInfo(p_pInfo)
+    , m_iNumChannels(p_iNumChannels)
+    , m_iNumBlocks(p_iNumBlocks)
+    {
+    }
+
+    void run()
+    {
+        m_vecLatencies.reserve(m_iNumBlocks);
+        while((qint32)m_vecLatencies.size() < m_iNumBlocks)
+        {
+            QByteArray DATA = m_pInfo->DeQueue(1000);
+            if(DATA.isEmpty())
+                break;
+
+            qint64 t_iSendNs;
+            memcpy(&t_iSendNs, DATA.constData() + 1, 8);
+
+            qint32 cols = ((DATA.size()-1)/4)/m_iNumChannels;
+            MatrixXf t_matRaw(Map<const MatrixXf>((const float*)(DATA.constData()+1), m_iNumChannels, cols));
+            for(qint32 i = 0; i < m_iNumChannels*cols; ++i)
+                IOUtils::swap_floatp(t_matRaw.data()+i);
+
+            m_vecLatencies.push_back((s_timer.nsecsElapsed() - t_iSendNs) * 1e-3);
+            s_iBlocksReceived.fetchAndAddOrdered(1);
+        }
+    }
+
+    std::vector<double> m_vecLatencies;
+
+private:
+    BabyMEGInfo* m_pInfo;
+    qint32 m_iNumChannels;
+    qint32 m_iNumBlocks;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [nchan] [nsamp] [nblocks] [link delay in ms]
+    //
+    qint32 nchan    = argc > 1 ? QString(argv[1]).toInt() : 464;
+    qint32 nsamp    = argc > 2 ? QString(argv[2]).toInt() : 100;
+    qint32 nblocks  = argc > 3 ? QString(argv[3]).toInt() : 2000;
+    qint32 delay    = argc > 4 ? QString(argv[4]).toInt() : 1;
+
+    s_timer.start();
+
+    printf("Acquiring %d blocks of %d x %d floats over loopback, stand-in link delay 0 and %d ms\n\n", nblocks, nchan, nsamp, delay);
+
+    qint32 delays[] = {0, delay};
+    qint32 windows[] = {1, 2, 4, 8};
+    for(qint32 d = 0; d < 2; ++d)
+    {
+        StandInThread t_standIn(nchan, nsamp, delays[d]);
+        t_standIn.start();
+        while(t_standIn.m_iPort.loadAcquire() == 0)
+            QThread::msleep(1);
+
+        for(qint32 w = 0; w < 4; ++w)
+        {
+            s_iBlocksReceived.fetchAndStoreOrdered(0);
+
+            BabyMEGInfo* t_pInfo = new BabyMEGInfo();
+            BabyMEGClient* t_pClient = new BabyMEGClient(t_standIn.m_iPort.loadAcquire());
+            t_pClient->SetInfo(t_pInfo);
+            t_pClient->SetRequestWindow(windows[w]);
+
+            ConsumerThread t_consumer(t_pInfo, nchan, nblocks);
+            t_consumer.start();
+
+            qint64 t_iStartNs = s_timer.nsecsElapsed();
+            t_pClient->ConnectToBabyMEG();
+
+            while(!t_consumer.isFinished())
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+            double t_dWall = (s_timer.nsecsElapsed() - t_iStartNs) * 1e-9;
+
+            t_pClient->DisConnectBabyMEG();
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+            delete t_pClient;
+            delete t_pInfo;
+
+            qint32 t_iBlocks = s_iBlocksReceived.loadAcquire();
+            printf("delay %d ms, window %d: %8.1f blocks/s %8.1f MB/s  ", delays[d], windows[w],
+                   t_iBlocks/t_dWall, t_iBlocks*(double)nchan*nsamp*4/t_dWall/1e6);
+            report("latency", t_consumer.m_vecLatencies);
+        }
+        printf("\n");
+
+        t_standIn.quit();
+        t_standIn.wait();
+    }
+
+    return 0;
+}
@@ -0,0 +1,431 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Measures producer/consumer throughput of CircularMatrixBuffer and CircularBuffer against the former
+*           semaphore based implementation.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+
+#include <generics/circularbuffer.h>
+#include <generics/circularmatrixbuffer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QThread>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace IOBuffer;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define BENCHMARK_CHANNELS  366     /**< Channels of a Neuromag raw buffer */
+#define BENCHMARK_SAMPLES   100     /**< Samples per raw buffer */
+#define BENCHMARK_SLOTS     10      /**< Matrices the ring holds */
+#define BENCHMARK_MATRICES  20000   /**< Matrices passed per run */
+#define BENCHMARK_ELEMENTS  20000000 /**< Elements passed per element run */
+#define BENCHMARK_CHUNK     1000    /**< Elements per element push/pop */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Semaphore reference
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The former CircularMatrixBuffer: one semaphore acquire and release per matrix and one modulo per element.
+* The chunked popInto is added, so the element runs compare both buffers with the same chunk size.
+*/
+template<typename _Tp>
+class SemaphoreMatrixBuffer
+{
+public:
+    SemaphoreMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols)
+    : m_uiRows(uiRows)
+    , m_uiCols(uiCols)
+    , m_uiMaxNumElements(uiMaxNumMatrices*uiRows*uiCols)
+    , m_pBuffer(new _Tp[m_uiMaxNumElements])
+    , m_iCurrentReadIndex(-1)
+    , m_iCurrentWriteIndex(-1)
+    , m_pFreeElements(new QSemaphore(m_uiMaxNumElements))
+    , m_pUsedElements(new QSemaphore(0))
+    {
+    }
+
+    ~SemaphoreMatrixBuffer()
+    {
+        delete m_pFreeElements;
+        delete m_pUsedElements;
+        delete [] m_pBuffer;
+    }
+
+    void push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+    {
+        unsigned int t_size = pMatrix->size();
+        m_pFreeElements->acquire(t_size);
+        for(unsigned int i = 0; i < t_size; ++i)
+            m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = pMatrix->data()[i];
+        m_pUsedElements->release(t_size);
+    }
+
+    Matrix<_Tp, Dynamic, Dynamic> pop()
+    {
+        m_pUsedElements->acquire(m_uiRows*m_uiCols);
+        Matrix<_Tp, Dynamic, Dynamic> matrix(m_uiRows, m_uiCols);
+        for(quint32 i = 0; i < m_uiRows*m_uiCols; ++i)
+            matrix.data()[i] = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
+        m_pFreeElements->release(m_uiRows*m_uiCols);
+        return matrix;
+    }
+
+    void push(const _Tp* pArray, unsigned int size)
+    {
+        m_pFreeElements->acquire(size);
+        for(unsigned int i = 0; i < size; ++i)
+            m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = pArray[i];
+        m_pUsedElements->release(size);
+    }
+
+    _Tp pop(int)
+    {
+        m_pUsedElements->acquire();
+        _Tp element = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
+        m_pFreeElements->release();
+        return element;
+    }
+
+    void popInto(_Tp* pArray, unsigned int size)
+    {
+        m_pUsedElements->acquire(size);
+        for(unsigned int i = 0; i < size; ++i)
+            pArray[i] = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
+        m_pFreeElements->release(size);
+    }
+
+private:
+    unsigned int mapIndex(int& index)
+    {
+        int aux = index;
+        return index = ++aux % m_uiMaxNumElements;
+    }
+
+    unsigned int    m_uiRows;
+    unsigned int    m_uiCols;
+    unsigned int    m_uiMaxNumElements;
+    _Tp*            m_pBuffer;
+    int             m_iCurrentReadIndex;
+    int             m_iCurrentWriteIndex;
+    QSemaphore*     m_pFreeElements;
+    QSemaphore*     m_pUsedElements;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Threads
+//=============================================================================================================
+
+enum Mode
+{
+    SemaphoreCopy,      /**< SemaphoreMatrixBuffer push/pop */
+    RingCopy,           /**< CircularMatrixBuffer push/pop */
+    RingInPlace,        /**< CircularMatrixBuffer pushInPlace/popInto */
+    SemaphoreElements,  /**< SemaphoreMatrixBuffer element push/popInto */
+    RingElements,       /**< CircularBuffer push/popInto */
+    RingInPlaceCheck,   /**< CircularMatrixBuffer pushInPlace/popInto, checks order and content */
+    RingElementsCheck   /**< CircularBuffer push/popInto, checks order and content */
+};
+
+
+//=============================================================================================================
+/**
+* Sequence number of element n in the check runs; wraps before floats lose integer precision.
+*/
+inline float sequenceValue(qint64 n)
+{
+    return (float)(n % (1 << 24));
+}
+
+
+//=============================================================================================================
+/**
+* Producer side of a run.
+*/
+class Producer : public QThread
+{
+public:
+    Producer(Mode mode, SemaphoreMatrixBuffer<float>* pSem, CircularMatrixBuffer<float>* pRing, CircularBuffer<float>* pElements)
+    : m_mode(mode), m_pSem(pSem), m_pRing(pRing), m_pElements(pElements) {}
+
+protected:
+    void run()
+    {
+        MatrixXf t_mat = MatrixXf::Random(BENCHMARK_CHANNELS, BENCHMARK_SAMPLES);
+        VectorXf t_vecCal = VectorXf::Constant(BENCHMARK_CHANNELS, 1e-13f);
+        VectorXf t_vecChunk = VectorXf::Random(BENCHMARK_CHUNK);
+
+        switch(m_mode)
+        {
+        case SemaphoreCopy:
+            for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+            {
+                MatrixXf t_matScaled = t_vecCal.asDiagonal() * t_mat;
+                m_pSem->push(&t_matScaled);
+            }
+            break;
+        case RingCopy:
+            for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+            {
+                MatrixXf t_matScaled = t_vecCal.asDiagonal() * t_mat;
+                m_pRing->push(&t_matScaled);
+            }
+            break;
+        case RingInPlace:
+            for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+                m_pRing->pushInPlace(t_vecCal.asDiagonal() * t_mat);
+            break;
+        case SemaphoreElements:
+            for(int i = 0; i < BENCHMARK_ELEMENTS; i += BENCHMARK_CHUNK)
+                m_pSem->push(t_vecChunk.data(), BENCHMARK_CHUNK);
+            break;
+        case RingElements:
+            for(int i = 0; i < BENCHMARK_ELEMENTS; i += BENCHMARK_CHUNK)
+                m_pElements->push(t_vecChunk.data(), BENCHMARK_CHUNK);
+            break;
+        case RingInPlaceCheck:
+            // matrix i holds i in every element but the first column, which holds its row
+            for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+            {
+                t_mat.setConstant(sequenceValue(i));
+                for(int r = 0; r < BENCHMARK_CHANNELS; ++r)
+                    t_mat(r,0) = (float)r;
+                m_pRing->pushInPlace(t_mat);
+            }
+            break;
+        case RingElementsCheck:
+            for(int i = 0; i < BENCHMARK_ELEMENTS; i += BENCHMARK_CHUNK)
+            {
+                for(int k = 0; k < BENCHMARK_CHUNK; ++k)
+                    t_vecChunk[k] = sequenceValue(i+k);
+                m_pElements->push(t_vecChunk.data(), BENCHMARK_CHUNK);
+            }
+            break;
+        }
+    }
+
+private:
+    Mode m_mode;
+    SemaphoreMatrixBuffer<float>* m_pSem;
+    CircularMatrixBuffer<float>* m_pRing;
+    CircularBuffer<float>* m_pElements;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Runs one producer/consumer pair and prints the throughput. The check runs also compare every received
+* element with the one the producer sent at that position.
+*
+* @param[in] mode   the buffer and API to measure
+* @param[in] name   label of the run
+*
+* @return false if a check run received an element out of order or corrupted, true otherwise
+*/
+bool runBenchmark(Mode mode, const char* name)
+{
+    SemaphoreMatrixBuffer<float> t_sem(BENCHMARK_SLOTS, BENCHMARK_CHANNELS, BENCHMARK_SAMPLES);
+    CircularMatrixBuffer<float> t_ring(BENCHMARK_SLOTS, BENCHMARK_CHANNELS, BENCHMARK_SAMPLES);
+    CircularBuffer<float> t_elements(BENCHMARK_SLOTS*BENCHMARK_CHANNELS*BENCHMARK_SAMPLES);
+
+    Producer t_producer(mode, &t_sem, &t_ring, &t_elements);
+
+    QElapsedTimer t_timer;
+    t_timer.start();
+    t_producer.start();
+
+    double t_dSum = 0;
+    qint64 t_iElements = 0;
+    qint64 t_iErrors = 0;
+    MatrixXf t_mat;
+    VectorXf t_vecChunk(BENCHMARK_CHUNK);
+
+    switch(mode)
+    {
+    case SemaphoreCopy:
+        for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+        {
+            t_mat = t_sem.pop();
+            t_dSum += t_mat(0,0);
+        }
+        t_iElements = (qint64)BENCHMARK_MATRICES*BENCHMARK_CHANNELS*BENCHMARK_SAMPLES;
+        break;
+    case RingCopy:
+        for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+        {
+            t_mat = t_ring.pop();
+            t_dSum += t_mat(0,0);
+        }
+        t_iElements = (qint64)BENCHMARK_MATRICES*BENCHMARK_CHANNELS*BENCHMARK_SAMPLES;
+        break;
+    case RingInPlace:
+        for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+        {
+            t_ring.popInto(t_mat);
+            t_dSum += t_mat(0,0);
+        }
+        t_iElements = (qint64)BENCHMARK_MATRICES*BENCHMARK_CHANNELS*BENCHMARK_SAMPLES;
+        break;
+    case SemaphoreElements:
+        for(int i = 0; i < BENCHMARK_ELEMENTS; i += BENCHMARK_CHUNK)
+        {
+            t_sem.popInto(t_vecChunk.data(), BENCHMARK_CHUNK);
+            t_dSum += t_vecChunk[0];
+        }
+        t_iElements = BENCHMARK_ELEMENTS;
+        break;
+    case RingElements:
+        for(int i = 0; i < BENCHMARK_ELEMENTS; i += BENCHMARK_CHUNK)
+        {
+            t_elements.popInto(t_vecChunk.data(), BENCHMARK_CHUNK);
+            t_dSum += t_vecChunk[0];
+        }
+        t_iElements = BENCHMARK_ELEMENTS;
+        break;
+    case RingInPlaceCheck:
+        for(int i = 0; i < BENCHMARK_MATRICES; ++i)
+        {
+            t_ring.popInto(t_mat);
+            t_dSum += t_mat(0,0);
+            for(int r = 0; r < BENCHMARK_CHANNELS; ++r)
+                if(t_mat(r,0) != (float)r)
+                    ++t_iErrors;
+            t_iErrors += (t_mat.rightCols(BENCHMARK_SAMPLES-1).array() != sequenceValue(i)).count();
+        }
+        t_iElements = (qint64)BENCHMARK_MATRICES*BENCHMARK_CHANNELS*BENCHMARK_SAMPLES;
+        break;
+    case RingElementsCheck:
+        for(int i = 0; i < BENCHMARK_ELEMENTS; i += BENCHMARK_CHUNK)
+        {
+            t_elements.popInto(t_vecChunk.data(), BENCHMARK_CHUNK);
+            t_dSum += t_vecChunk[0];
+            for(int k = 0; k < BENCHMARK_CHUNK; ++k)
+                if(t_vecChunk[k] != sequenceValue(i+k))
+                    ++t_iErrors;
+        }
+        t_iElements = BENCHMARK_ELEMENTS;
+        break;
+    }
+
+    t_producer.wait();
+    double t_dSeconds = t_timer.nsecsElapsed()*1e-9;
+
+    double t_dBytes = (double)t_iElements*sizeof(float);
+    printf("%-40s %10.3f s %12.0f elements/s %8.3f GB/s (checksum %g)\n", name, t_dSeconds,
+           t_iElements/t_dSeconds, t_dBytes/t_dSeconds*1e-9, t_dSum);
+    if(mode == SemaphoreCopy || mode == RingCopy || mode == RingInPlace || mode == RingInPlaceCheck)
+        printf("%-40s %12.0f matrices/s\n", "", BENCHMARK_MATRICES/t_dSeconds);
+    if(mode == RingInPlaceCheck || mode == RingElementsCheck)
+    {
+        if(t_iErrors > 0)
+            printf("%-40s FIFO check FAILED: %lld elements out of order or corrupted\n", "", (long long)t_iErrors);
+        else
+            printf("%-40s FIFO check passed\n", "");
+    }
+
+    return t_iErrors == 0;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    printf("%d x %d float matrices, %d slots\n\n", BENCHMARK_CHANNELS, BENCHMARK_SAMPLES, BENCHMARK_SLOTS);
+
+    runBenchmark(SemaphoreCopy, "semaphore push/pop");
+    runBenchmark(RingCopy, "ring push/pop");
+    runBenchmark(RingInPlace, "ring pushInPlace/popInto");
+
+    printf("\n%d float elements, chunks of %d\n\n", BENCHMARK_ELEMENTS, BENCHMARK_CHUNK);
+
+    runBenchmark(SemaphoreElements, "semaphore element push/popInto");
+    runBenchmark(RingElements, "ring element push/popInto");
+
+    printf("\nFIFO order and content across the producer and consumer thread\n\n");
+
+    bool t_bOk = runBenchmark(RingInPlaceCheck, "ring pushInPlace/popInto check");
+    t_bOk = runBenchmark(RingElementsCheck, "ring element push/popInto check") && t_bOk;
+
+    return t_bOk ? 0 : 1;
+}
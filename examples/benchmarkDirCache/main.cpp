@@ -0,0 +1,172 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Benchmarks reopening a large synthetic raw file without directory pointer, with and without the
+*           directory cache.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <math.h>
+
+#include <fiff/fiff.h>
+
+#include "../benchmarkhelpers.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Opens the file p_iNOpen times and reports the time per open.
+*
+* @param[in] p_qFile        the file to open
+* @param[in] p_iNOpen       number of opens
+* @param[out] p_iNEntries   number of directory entries of the last open
+*
+* @return the mean time per open in ms, -1 if an open failed
+*/
+double timeOpen(QFile& p_qFile, qint32 p_iNOpen, qint32& p_iNEntries)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for(qint32 i = 0; i < p_iNOpen; ++i)
+    {
+        FiffStream::SPtr t_pStream(new FiffStream(&p_qFile));
+        FiffDirTree t_Tree;
+        QList<FiffDirEntry> t_Dir;
+        if(!t_pStream->open(t_Tree, t_Dir))
+            return -1;
+        p_iNEntries = t_Dir.size();
+        p_qFile.close();
+    }
+    return timer.nsecsElapsed()*1e-6/p_iNOpen;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [hours] [nchan] [nopen]
+    //
+    float hours     = argc > 1 ? QString(argv[1]).toFloat() : 1.0f;
+    qint32 nchan    = argc > 2 ? QString(argv[2]).toInt() : 16;
+    qint32 nopen    = argc > 3 ? QString(argv[3]).toInt() : 10;
+
+    float sfreq     = 1000.0f;
+    qint32 bufsize  = 100;
+    qint32 nbuffers = (qint32)ceil(hours*3600.0f*sfreq/bufsize);
+
+    QFile t_fileRaw(QDir::tempPath() + "/mne_benchmark_dir_cache.fif");
+
+    printf("Writing synthetic raw file %s (%d channels, %d buffers of %d samples)...\n",
+           t_fileRaw.fileName().toUtf8().constData(), nchan, nbuffers, bufsize);
+    if(!writeSyntheticRaw(t_fileRaw, nchan, sfreq, bufsize, nbuffers))
+    {
+        printf("Could not write synthetic raw file.\n");
+        return -1;
+    }
+
+    //
+    //   Scan of all tag headers on every open
+    //
+    qint32 nentScan = 0;
+    FiffDirCache::setEnabled(false);
+    double msScan = timeOpen(t_fileRaw, nopen, nentScan);
+
+    //
+    //   First open builds the cache entry, the following ones reuse it
+    //
+    qint32 nentFirst = 0, nentCached = 0;
+    FiffDirCache::setEnabled(true);
+    double msFirst = timeOpen(t_fileRaw, 1, nentFirst);
+    double msCached = timeOpen(t_fileRaw, nopen, nentCached);
+
+    t_fileRaw.remove();
+
+    if(msScan < 0 || msFirst < 0 || msCached < 0 || nentScan != nentCached)
+    {
+        printf("Could not open synthetic raw file consistently.\n");
+        return -1;
+    }
+
+    printf("\nPer open time (%d tags, %d opens):\n", nentScan, nopen);
+    printf("\ttag scan       %10.3f ms\n", msScan);
+    printf("\tfirst cached   %10.3f ms\n", msFirst);
+    printf("\tcache hit      %10.3f ms\n", msCached);
+    printf("\tspeedup        %10.1f x\n", msScan/msCached);
+    printf("\t(%lld hits, %lld misses)\n", FiffDirCache::hits(), FiffDirCache::misses());
+
+    return 0;
+}
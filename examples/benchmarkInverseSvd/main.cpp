@@ -0,0 +1,205 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Compares the JacobiSVD and the Gram matrix decomposition of make_inverse_operator in run time and
+*           against each other in singular values, eigen fields and source estimates.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <math.h>
+
+#include <fiff/fiff.h>
+#include <mne/mne.h>
+#include <inverse/minimumNorm/minimumnorm.h>
+#include <inverse/sourceestimate.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Compares an inverse operator made by the Gram matrix decomposition with the JacobiSVD reference.
+*
+* @param[in] p_sName        name of the compared operator
+* @param[in] p_invJacobi    operator made with JacobiSVD
+* @param[in] p_invGram      operator made with MNEMath::gram_svd
+* @param[in] p_evoked       evoked data to compute source estimates of
+* @param[in] p_fLambda2     regularization parameter
+* @param[in] p_sMethod      inverse method
+*
+* @return the largest relative deviation
+*/
+double compare(const char* p_sName, const MNEInverseOperator& p_invJacobi, const MNEInverseOperator& p_invGram, const FiffEvoked& p_evoked, float p_fLambda2, const QString& p_sMethod)
+{
+    //
+    //   Resolved singular values and their fields; singular vectors are unique up to the sign
+    //
+    const VectorXd& singJacobi = p_invJacobi.sing;
+    const VectorXd& singGram = p_invGram.sing;
+    qint32 rank = 0;
+    double errSing = 0;
+    double errFields = 0;
+    for(qint32 i = 0; i < singGram.size(); ++i)
+    {
+        if(singGram[i] <= 0)
+            continue;
+        ++rank;
+        errSing = qMax(errSing, fabs(singGram[i] - singJacobi[i]) / singJacobi[i]);
+        double dot = p_invGram.eigen_fields->data.row(i).dot(p_invJacobi.eigen_fields->data.row(i));
+        errFields = qMax(errFields, 1.0 - fabs(dot));
+    }
+
+    //
+    //   Source estimates
+    //
+    MinimumNorm minimumNormJacobi(p_invJacobi, p_fLambda2, p_sMethod);
+    MinimumNorm minimumNormGram(p_invGram, p_fLambda2, p_sMethod);
+    SourceEstimate stcJacobi = minimumNormJacobi.calculateInverse(p_evoked);
+    SourceEstimate stcGram = minimumNormGram.calculateInverse(p_evoked);
+    double errStc = (stcGram.data - stcJacobi.data).norm() / stcJacobi.data.norm();
+
+    printf("\t%-5s rank %d of %d: singular values %.2e, eigen fields %.2e, %s source estimate %.2e (max. rel. error)\n",
+           p_sName, rank, (qint32)singJacobi.size(), errSing, errFields, p_sMethod.toLatin1().constData(), errStc);
+
+    return qMax(errSing, qMax(errFields, errStc));
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [method] [tolerance]
+    //
+    QString method  = argc > 1 ? QString(argv[1]) : QString("dSPM");
+    double tol      = argc > 2 ? QString(argv[2]).toDouble() : 1e-6;
+
+    QFile t_fileFwdMeeg("./MNE-sample-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+    QFile t_fileCov("./MNE-sample-data/MEG/sample/sample_audvis-cov.fif");
+    QFile t_fileEvoked("./MNE-sample-data/MEG/sample/sample_audvis-ave.fif");
+
+    float snr = 3.0f;
+    float lambda2 = pow(1.0f / snr, 2.0f);
+
+    QPair<QVariant, QVariant> baseline(QVariant(), 0);
+    FiffEvoked evoked(t_fileEvoked, 0, baseline);
+    if(evoked.isEmpty())
+    {
+        printf("Could not read evoked file.\n");
+        return -1;
+    }
+
+    MNEForwardSolution t_forwardMeeg(t_fileFwdMeeg, false, true);
+    MNEForwardSolution t_forwardMeg = t_forwardMeeg.pick_types(true, false);
+
+    FiffCov noise_cov(t_fileCov);
+    noise_cov = noise_cov.regularize(evoked.info, 0.05, 0.05, 0.1, true);
+
+    //
+    //   Make each operator with both decompositions
+    //
+    QElapsedTimer timer;
+
+    timer.start();
+    MNEInverseOperator invMegJacobi(evoked.info, t_forwardMeg, noise_cov, 0.2f, 0.8f, false, true, false);
+    qint64 msMegJacobi = timer.elapsed();
+
+    timer.start();
+    MNEInverseOperator invMegGram(evoked.info, t_forwardMeg, noise_cov, 0.2f, 0.8f, false, true, true);
+    qint64 msMegGram = timer.elapsed();
+
+    timer.start();
+    MNEInverseOperator invMeegJacobi(evoked.info, t_forwardMeeg, noise_cov, 0.2f, 0.8f, false, true, false);
+    qint64 msMeegJacobi = timer.elapsed();
+
+    timer.start();
+    MNEInverseOperator invMeegGram(evoked.info, t_forwardMeeg, noise_cov, 0.2f, 0.8f, false, true, true);
+    qint64 msMeegGram = timer.elapsed();
+
+    printf("\nmake_inverse_operator (%d sources):\n", t_forwardMeeg.nsource);
+    printf("\tMEG   JacobiSVD %8lld ms  Gram %8lld ms\n", msMegJacobi, msMegGram);
+    printf("\tM/EEG JacobiSVD %8lld ms  Gram %8lld ms\n", msMeegJacobi, msMeegGram);
+
+    printf("\nGram decomposition against JacobiSVD:\n");
+    double err = compare("MEG", invMegJacobi, invMegGram, evoked, lambda2, method);
+    err = qMax(err, compare("M/EEG", invMeegJacobi, invMeegGram, evoked, lambda2, method));
+
+    if(err > tol)
+    {
+        printf("\nDeviation %.2e exceeds the tolerance %.2e.\n", err, tol);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Measures the RAP MUSIC localization time vs. number of grid points and number of dipoles.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+
+#include <fiff/fiff.h>
+#include <mne/mne.h>
+#include <inverse/rapMusic/rapmusic.h>
+#include <inverse/sourceestimate.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QThreadPool>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Creates a forward solution with a random gain matrix.
+*
+* @param[in] p_iNChan       number of channels
+* @param[in] p_iNGrid       number of grid points
+* @param[in] p_bFixed       fixed (1 column per grid point) or free orientations (3 columns)
+*
+* @return the synthetic forward solution
+*/
+MNEForwardSolution syntheticForward(qint32 p_iNChan, qint32 p_iNGrid, bool p_bFixed)
+{
+    qint32 nori = p_bFixed ? 1 : 3;
+
+    QStringList rowNames, colNames;
+    for(qint32 k = 0; k < p_iNChan; ++k)
+        rowNames << QString("SYN %1").arg(k+1, 4, 10, QChar('0'));
+    for(qint32 k = 0; k < p_iNGrid*nori; ++k)
+        colNames << QString::number(k);
+
+    MNEForwardSolution fwd;
+    fwd.source_ori = p_bFixed ? FIFFV_MNE_FIXED_ORI : FIFFV_MNE_FREE_ORI;
+    fwd.nchan = p_iNChan;
+    fwd.nsource = p_iNGrid;
+    fwd.sol = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(p_iNChan, p_iNGrid*nori, rowNames, colNames, MatrixXd::Random(p_iNChan, p_iNGrid*nori)));
+
+    return fwd;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [nchan] [free]
+    //
+    qint32 nchan    = argc > 1 ? QString(argv[1]).toInt() : 306;
+    bool fixed      = argc > 2 ? QString(argv[2]) != "free" : true;
+    qint32 nsamp    = 200;
+
+    qint32 gridSizes[] = {250, 500, 1000, 2000, 4000};
+    qint32 dipoleCounts[] = {1, 2, 4};
+    qint32 ngrids = sizeof(gridSizes)/sizeof(gridSizes[0]);
+    qint32 ncounts = sizeof(dipoleCounts)/sizeof(dipoleCounts[0]);
+
+    printf("RAP MUSIC benchmark: %d channels, %s orientations, %d threads\n", nchan, fixed ? "fixed" : "free", QThreadPool::globalInstance()->maxThreadCount());
+    printf("%10s %10s %12s %10s\n", "grid", "dipoles", "time [ms]", "found");
+
+    srand(42);
+    QElapsedTimer timer;
+    for(qint32 g = 0; g < ngrids; ++g)
+    {
+        MNEForwardSolution fwd = syntheticForward(nchan, gridSizes[g], fixed);
+        qint32 nori = fixed ? 1 : 3;
+
+        for(qint32 c = 0; c < ncounts; ++c)
+        {
+            qint32 ndip = dipoleCounts[c];
+
+            //
+            //   Simulate ndip dipoles at distinct random grid points with independent time courses
+            //
+            QList<qint32> trueIdx;
+            while(trueIdx.size() < ndip)
+            {
+                qint32 idx = rand() % gridSizes[g];
+                if(!trueIdx.contains(idx))
+                    trueIdx.append(idx);
+            }
+
+            MatrixXd data = 0.01*MatrixXd::Random(nchan, nsamp);
+            for(qint32 k = 0; k < ndip; ++k)
+            {
+                VectorXd ori = VectorXd::Random(nori).normalized();
+                RowVectorXd course(nsamp);
+                for(qint32 t = 0; t < nsamp; ++t)
+                    course[t] = sin(0.05*(k+1)*t + k);
+                data += fwd.sol->data.middleCols(trueIdx[k]*nori, nori) * ori * course;
+            }
+
+            RapMusic rapMusic(fwd, ndip, 0.5);
+            QList<RapMusicDipole> dipoles;
+
+            timer.start();
+            SourceEstimate stc = rapMusic.calculateInverse(data, 0.0f, 0.001f, dipoles);
+            double ms = timer.nsecsElapsed()/1000000.0;
+
+            qint32 found = 0;
+            for(qint32 k = 0; k < dipoles.size(); ++k)
+                if(trueIdx.contains(dipoles[k].idx))
+                    ++found;
+
+            printf("%10d %10d %12.1f %7d/%d\n", gridSizes[g], ndip, ms, found, ndip);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Micro benchmark of the fused raw buffer decoding kernel against the separate swap, cast and calibrate path.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <vector>
+#include <string.h>
+
+#include <fiff/fiff.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Creates a big endian FIFF_DATA_BUFFER tag (header + payload) of the given type, as it is stored in a file.
+*
+* @param[in] p_iType    FIFFT_DAU_PACK16, FIFFT_INT or FIFFT_FLOAT
+* @param[in] p_iNChan   number of channels
+* @param[in] p_iNSamp   number of samples
+*
+* @return the raw tag
+*/
+QByteArray makeRawTag(fiff_int_t p_iType, qint32 p_iNChan, qint32 p_iNSamp)
+{
+    qint32 elsize = p_iType == FIFFT_DAU_PACK16 ? 2 : 4;
+    qint32 size = p_iNChan*p_iNSamp*elsize;
+    QByteArray tag(16 + size, 0);
+    uchar* p = (uchar*)tag.data();
+    qToBigEndian<qint32>(FIFF_DATA_BUFFER, p);
+    qToBigEndian<qint32>(p_iType, p + 4);
+    qToBigEndian<qint32>(size, p + 8);
+    qToBigEndian<qint32>(FIFFV_NEXT_SEQ, p + 12);
+    p += 16;
+
+    for(qint32 i = 0; i < p_iNChan*p_iNSamp; ++i)
+    {
+        if(p_iType == FIFFT_DAU_PACK16)
+            qToBigEndian<qint16>((qint16)(i % 2000 - 1000), p + 2*i);
+        else if(p_iType == FIFFT_INT)
+            qToBigEndian<qint32>(i % 200000 - 100000, p + 4*i);
+        else
+        {
+            float f = 1e-3f*(i % 2000);
+            quint32 u;
+            memcpy(&u, &f, 4);
+            qToBigEndian<quint32>(u, p + 4*i);
+        }
+    }
+    return tag;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* The decoding path of read_raw_segment before the fused kernel: copy the tag, swap it in place, cast the whole
+* buffer to double, calibrate it with a sparse product and copy the picked samples.
+*/
+void decodeSeparate(const QByteArray& p_RawTag, qint32 p_iNChan, qint32 p_iNSamp, const SparseMatrix<double>& p_Cal, MatrixXd& p_Data)
+{
+    FiffTag::SPtr t_pTag(new FiffTag());
+    t_pTag->type = qFromBigEndian<qint32>((const uchar*)p_RawTag.constData() + 4);
+    t_pTag->resize(p_RawTag.size() - 16);
+    memcpy(t_pTag->data(), p_RawTag.constData() + 16, t_pTag->size());
+    FiffTag::convert_tag_data(t_pTag, FIFFV_BIG_ENDIAN, FIFFV_NATIVE_ENDIAN);
+
+    MatrixXd one;
+    if (t_pTag->type == FIFFT_DAU_PACK16)
+        one = p_Cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(), p_iNChan, p_iNSamp)).cast<double>();
+    else if(t_pTag->type == FIFFT_INT)
+        one = p_Cal*(Map< MatrixXi >( t_pTag->toInt(), p_iNChan, p_iNSamp)).cast<double>();
+    else
+        one = p_Cal*(Map< MatrixXf >( t_pTag->toFloat(), p_iNChan, p_iNSamp)).cast<double>();
+
+    p_Data.block(0, 0, p_iNChan, p_iNSamp) = one;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    qint32 nsamp = 2000;
+    qint32 nrep = argc > 1 ? QString(argv[1]).toInt() : 200;
+
+    QList<qint32> layouts;
+    layouts << 306 << 1000;
+    QList<fiff_int_t> types;
+    types << FIFFT_DAU_PACK16 << FIFFT_INT << FIFFT_FLOAT;
+    QStringList typeNames;
+    typeNames << "DAU_PACK16" << "INT" << "FLOAT";
+
+    printf("%-6s %-10s %14s %14s %8s\n", "nchan", "type", "separate [us]", "fused [us]", "speedup");
+
+    for(qint32 l = 0; l < layouts.size(); ++l)
+    {
+        qint32 nchan = layouts[l];
+
+        RowVectorXd cals = RowVectorXd::LinSpaced(nchan, 1e-13, 1e-12);
+        typedef Eigen::Triplet<double> T;
+        std::vector<T> tripletList;
+        tripletList.reserve(nchan);
+        for(qint32 i = 0; i < nchan; ++i)
+            tripletList.push_back(T(i, i, cals[i]));
+        SparseMatrix<double> cal(nchan, nchan);
+        cal.setFromTriplets(tripletList.begin(), tripletList.end());
+
+        MatrixXd dataSeparate(nchan, nsamp);
+        MatrixXd dataFused(nchan, nsamp);
+
+        for(qint32 t = 0; t < types.size(); ++t)
+        {
+            QByteArray rawTag = makeRawTag(types[t], nchan, nsamp);
+
+            QElapsedTimer timer;
+            timer.start();
+            for(qint32 rep = 0; rep < nrep; ++rep)
+                decodeSeparate(rawTag, nchan, nsamp, cal, dataSeparate);
+            double usSeparate = timer.nsecsElapsed()/1000.0/nrep;
+
+            FiffTagView view;
+            timer.start();
+            for(qint32 rep = 0; rep < nrep; ++rep)
+            {
+                view.setTag((const uchar*)rawTag.constData(), rawTag.size());
+                view.toCalibratedMatrix(cals, 0, nsamp, dataFused);
+            }
+            double usFused = timer.nsecsElapsed()/1000.0/nrep;
+
+            if((dataSeparate - dataFused).cwiseAbs().maxCoeff() > 1e-12*dataSeparate.cwiseAbs().maxCoeff())
+            {
+                printf("Fused and separate decoding differ for %s with %d channels!\n", typeNames[t].toUtf8().constData(), nchan);
+                return -1;
+            }
+
+            printf("%-6d %-10s %14.1f %14.1f %7.2fx\n", nchan, typeNames[t].toUtf8().constData(), usSeparate, usFused, usSeparate/usFused);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Records a simulated high channel count stream in real time and reports the worst-case producer
+*           stall of the synchronous write_raw_buffer and of the asynchronous FiffRawWriter.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+
+#include <fiff/fiff.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QFile>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Creates the measurement info of a synthetic stream.
+*
+* @param[in] p_iNChan       number of channels
+* @param[in] p_fSFreq       sampling frequency
+*
+* @return the measurement info
+*/
+FiffInfo syntheticInfo(qint32 p_iNChan, float p_fSFreq)
+{
+    FiffInfo info;
+    info.sfreq = p_fSFreq;
+    info.nchan = p_iNChan;
+    for(qint32 k = 0; k < p_iNChan; ++k)
+    {
+        FiffChInfo ch;
+        ch.scanno = k+1;
+        ch.logno = k+1;
+        ch.kind = FIFFV_MEG_CH;
+        ch.range = 1.0f;
+        ch.cal = 1.0f;
+        ch.ch_name = QString("SYN %1").arg(k+1, 4, 10, QChar('0'));
+        info.chs.append(ch);
+        info.ch_names.append(ch.ch_name);
+    }
+    return info;
+}
+
+
+//=============================================================================================================
+/**
+* Records p_iNBuffers buffers paced at the acquisition rate. With p_iNumBuffers == 0 the buffers are written
+* synchronously by write_raw_buffer, otherwise they are handed to a FiffRawWriter with p_iNumBuffers slots.
+*
+* @param[in] p_sFileName    the file to record to
+* @param[in] p_info         the measurement info
+* @param[in] p_iBufSize     number of samples per buffer
+* @param[in] p_iNBuffers    number of buffers to record
+* @param[in] p_iNumBuffers  writer slots, 0 for synchronous writing
+* @param[in] p_iSync        fsync every p_iSync buffers, 0 never
+*/
+void record(const QString& p_sFileName, const FiffInfo& p_info, qint32 p_iBufSize, qint32 p_iNBuffers, qint32 p_iNumBuffers, qint32 p_iSync)
+{
+    QFile t_qFile(p_sFileName);
+
+    qint64 t_iPeriodNs = (qint64)(1e9*p_iBufSize/p_info.sfreq);
+
+    MatrixXd buf = MatrixXd::Random(p_info.nchan, p_iBufSize) * 1e-12;
+
+    MatrixXd cals;
+    FiffStream::SPtr outfid;
+    FiffRawWriter writer(p_iNumBuffers > 0 ? p_iNumBuffers : 2);
+    writer.setSyncInterval(p_iSync);
+
+    bool t_bOpen;
+    if(p_iNumBuffers == 0)
+    {
+        outfid = FiffStream::start_writing_raw(t_qFile, p_info, cals);
+        t_bOpen = !outfid.isNull();
+    }
+    else
+        t_bOpen = writer.open(t_qFile, p_info, p_iBufSize);
+
+    if(!t_bOpen)
+    {
+        printf("Could not open %s.\n", p_sFileName.toLatin1().constData());
+        return;
+    }
+
+    qint64 t_iMaxNs = 0;
+    qint64 t_iTotalNs = 0;
+    qint32 t_iLate = 0;
+
+    QElapsedTimer t_timerClock;
+    QElapsedTimer t_timerCall;
+    t_timerClock.start();
+
+    for(qint32 b = 0; b < p_iNBuffers; ++b)
+    {
+        //
+        //   Acquisition of buffer b completes at its deadline
+        //
+        qint64 t_iDeadlineNs = (b+1)*t_iPeriodNs;
+        qint64 t_iNowNs = t_timerClock.nsecsElapsed();
+        if(t_iNowNs < t_iDeadlineNs)
+            QThread::usleep((t_iDeadlineNs - t_iNowNs)/1000);
+        else
+            ++t_iLate;
+
+        buf(0,0) = b;
+
+        t_timerCall.start();
+        if(p_iNumBuffers == 0)
+        {
+            outfid->write_raw_buffer(buf, cals);
+            if(p_iSync > 0 && (b+1) % p_iSync == 0)
+            {
+                t_qFile.flush();
+#ifdef Q_OS_WIN
+                _commit(t_qFile.handle());
+#else
+                fsync(t_qFile.handle());
+#endif
+            }
+        }
+        else
+            writer.write(buf);
+        qint64 t_iCallNs = t_timerCall.nsecsElapsed();
+
+        t_iMaxNs = qMax(t_iMaxNs, t_iCallNs);
+        t_iTotalNs += t_iCallNs;
+    }
+
+    if(p_iNumBuffers == 0)
+        outfid->finish_writing_raw();
+    else
+        writer.close();
+
+    double t_dMB = (double)t_qFile.size()/(1024.0*1024.0);
+    t_qFile.remove();
+
+    if(p_iNumBuffers == 0)
+        printf("synchronous        ");
+    else
+        printf("FiffRawWriter (%d)  ", p_iNumBuffers);
+    printf("%8.1f MB  worst stall %8.3f ms  mean %7.3f ms  late buffers %4d", t_dMB, t_iMaxNs*1e-6, t_iTotalNs*1e-6/p_iNBuffers, t_iLate);
+    if(p_iNumBuffers > 0)
+        printf("  (writer: %lld buffers, %lld stalls)", writer.buffersWritten(), writer.stalls());
+    printf("\n");
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [seconds] [nchan] [sfreq] [buffer size in samples] [fsync interval in buffers]
+    //
+    float seconds   = argc > 1 ? QString(argv[1]).toFloat() : 10.0f;
+    qint32 nchan    = argc > 2 ? QString(argv[2]).toInt() : 1000;
+    float sfreq     = argc > 3 ? QString(argv[3]).toFloat() : 5000.0f;
+    qint32 nsamp    = argc > 4 ? QString(argv[4]).toInt() : 100;
+    qint32 nsync    = argc > 5 ? QString(argv[5]).toInt() : 0;
+
+    FiffInfo info = syntheticInfo(nchan, sfreq);
+    qint32 nbuffers = (qint32)(seconds*sfreq)/nsamp;
+
+    printf("Recording %d channels at %.0f Hz, %d buffers of %d samples (%.3f ms each), fsync every %d buffers\n\n",
+           nchan, sfreq, nbuffers, nsamp, 1000.0f*nsamp/sfreq, nsync);
+
+    QString t_sFileName("./benchmarkRawRecorder_raw.fif");
+
+    record(t_sFileName, info, nsamp, nbuffers, 0, nsync);
+    record(t_sFileName, info, nsamp, nbuffers, 2, nsync);
+    record(t_sFileName, info, nsamp, nbuffers, 3, nsync);
+
+    return 0;
+}
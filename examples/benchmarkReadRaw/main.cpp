@@ -0,0 +1,168 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Benchmarks random access reads of 1 s windows across a large synthetic raw file.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+
+#include <fiff/fiff.h>
+
+#include "../benchmarkhelpers.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [hours] [nchan] [nwindows] [mapped]
+    //
+    float hours     = argc > 1 ? QString(argv[1]).toFloat() : 3.0f;
+    qint32 nchan    = argc > 2 ? QString(argv[2]).toInt() : 16;
+    qint32 nwindows = argc > 3 ? QString(argv[3]).toInt() : 200;
+    bool mapped     = argc > 4 ? QString(argv[4]) == "mapped" : false;
+
+    float sfreq     = 1000.0f;
+    qint32 bufsize  = 100;
+    qint32 nbuffers = (qint32)ceil(hours*3600.0f*sfreq/bufsize);
+
+    QFile t_fileRaw(QDir::tempPath() + "/mne_benchmark_read_raw.fif");
+
+    printf("Writing synthetic raw file %s (%d channels, %d buffers of %d samples)...\n",
+           t_fileRaw.fileName().toUtf8().constData(), nchan, nbuffers, bufsize);
+    if(!writeSyntheticRaw(t_fileRaw, nchan, sfreq, bufsize, nbuffers))
+    {
+        printf("Could not write synthetic raw file.\n");
+        return -1;
+    }
+
+    FiffRawData raw(t_fileRaw);
+    if(raw.isEmpty())
+    {
+        printf("Could not read synthetic raw file.\n");
+        return -1;
+    }
+
+    if(mapped && !raw.file->map_file())
+    {
+        printf("Could not map synthetic raw file.\n");
+        return -1;
+    }
+
+    //
+    //   Read random 1 s windows and time each of them
+    //
+    qint32 winsamp = (qint32)sfreq;
+    qint32 range = raw.last_samp - raw.first_samp - winsamp;
+    std::vector<double> latencies;
+    latencies.reserve(nwindows);
+
+    MatrixXd data, times;
+    QElapsedTimer timer;
+    qsrand(42);
+    for(qint32 w = 0; w < nwindows; ++w)
+    {
+        qint32 from = raw.first_samp + (qint32)(((double)qrand()/RAND_MAX)*range);
+        qint32 to = from + winsamp - 1;
+
+        timer.start();
+        if(!raw.read_raw_segment(data, times, from, to))
+        {
+            printf("Could not read raw segment.\n");
+            return -1;
+        }
+        latencies.push_back(timer.nsecsElapsed()/1000.0);
+
+        //
+        //   Each buffer holds its own index -> check the first and last sample of the window
+        //
+        if(data(0,0) != (from - raw.first_samp)/bufsize || data(0,winsamp-1) != (to - raw.first_samp)/bufsize)
+        {
+            printf("Wrong data read at %d ... %d.\n", from, to);
+            return -1;
+        }
+    }
+
+    //
+    //   Report
+    //
+    printf("\nPer window latency (%d windows of %d samples over %.1f h):\n", nwindows, winsamp, hours);
+    report(mapped ? "mapped" : "stream", latencies);
+
+    if(mapped)
+        raw.file->unmap_file();
+    t_fileRaw.close();
+    t_fileRaw.remove();
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Measures stream bytes/s and encode/decode CPU time of the real-time raw buffer encodings on the
+*           sample_audvis raw file.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <vector>
+
+#include <fiff/fiff.h>
+#include <fiff/fiff_rt_codec.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Decodes a complete tag as RtDataClient::readRawBuffer does.
+*
+* @param[in] p_blockTag     the encoded tag
+* @param[in] p_nChannels    number of channels of a FIFF_DATA_BUFFER
+* @param[out] p_matData     the decoded raw buffer
+*
+* @return true if decoded successfully
+*/
+bool decodeTag(const QByteArray& p_blockTag, qint32 p_nChannels, MatrixXf& p_matData)
+{
+    const uchar* t_pTag = (const uchar*)p_blockTag.constData();
+    fiff_int_t kind = qFromBigEndian<qint32>(t_pTag);
+    fiff_int_t size = qFromBigEndian<qint32>(t_pTag + 8);
+
+    if(kind == FIFF_DATA_BUFFER)
+    {
+        qint32 nSamples = (size/4)/p_nChannels;
+        p_matData.resize(p_nChannels, nSamples);
+        for(qint32 i = 0; i < p_nChannels*nSamples; ++i)
+        {
+            quint32 t_iVal = qFromBigEndian<quint32>(t_pTag + 16 + 4*i);
+            memcpy(p_matData.data() + i, &t_iVal, sizeof(float));
+        }
+        return true;
+    }
+    return FiffRtCodec::decode(p_blockTag.constData() + 16, size, p_matData);
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [buffer size in samples] [seconds]
+    //
+    qint32 nsamp    = argc > 1 ? QString(argv[1]).toInt() : 100;
+    float seconds   = argc > 2 ? QString(argv[2]).toFloat() : 60.0f;
+
+    QFile t_fileRaw("./MNE-sample-data/MEG/sample/sample_audvis_raw.fif");
+
+    FiffRawData raw(t_fileRaw);
+    if(raw.isEmpty())
+    {
+        printf("Could not read raw file.\n");
+        return -1;
+    }
+
+    //
+    //   Read the raw buffers the way the FiffSimulator connector streams them
+    //
+    qint32 nbuffers = (qint32)(seconds*raw.info.sfreq)/nsamp;
+    nbuffers = qMin(nbuffers, (raw.last_samp - raw.first_samp + 1)/nsamp);
+
+    QList<MatrixXf> t_qListBuffers;
+    MatrixXd data, times;
+    for(qint32 b = 0; b < nbuffers; ++b)
+    {
+        fiff_int_t from = raw.first_samp + b*nsamp;
+        if(!raw.read_raw_segment(data, times, from, from + nsamp - 1))
+            break;
+        t_qListBuffers.append(data.cast<float>());
+    }
+    nbuffers = t_qListBuffers.size();
+    qint32 nchan = raw.info.nchan;
+
+    //
+    //   Channel subset: MEG gradiometers and magnetometers
+    //
+    RowVectorXi t_vecMegPicks = raw.info.pick_types(true, false, false);
+
+    printf("%d buffers of %d x %d samples at %.1f Hz\n\n", nbuffers, nchan, nsamp, raw.info.sfreq);
+    printf("\t%-8s %-8s %12s %8s %14s %14s %12s\n", "method", "channels", "bytes/s", "ratio", "encode us/buf", "decode us/buf", "max rel err");
+
+    double t_dBuffersPerSecond = raw.info.sfreq / nsamp;
+    double t_dFloatBytes = 0;
+
+    const char* methodNames[] = {"float", "int16", "delta"};
+    for(qint32 p = 0; p < 2; ++p)
+    {
+        RowVectorXi t_vecPicks = p == 0 ? RowVectorXi() : t_vecMegPicks;
+
+        for(qint32 m = FiffRtCodec::Float; m <= FiffRtCodec::DeltaRice; ++m)
+        {
+            QList<QByteArray> t_qListBlocks;
+            QElapsedTimer t_timer;
+
+            t_timer.start();
+            for(qint32 b = 0; b < nbuffers; ++b)
+            {
+                QByteArray t_blockTag;
+                FiffRtCodec::encode(t_qListBuffers[b], (FiffRtCodec::Method)m, t_vecPicks, t_blockTag);
+                t_qListBlocks.append(t_blockTag);
+            }
+            double t_dEncodeUs = t_timer.nsecsElapsed()*1e-3/nbuffers;
+
+            MatrixXf t_matDecoded;
+            double t_dMaxRelErr = 0;
+            double t_dDecodeNs = 0;
+            qint64 t_iBytes = 0;
+            for(qint32 b = 0; b < nbuffers; ++b)
+            {
+                t_timer.restart();
+                if(!decodeTag(t_qListBlocks[b], nchan, t_matDecoded))
+                {
+                    printf("Decoding failed.\n");
+                    return -1;
+                }
+                t_dDecodeNs += t_timer.nsecsElapsed();
+                t_iBytes += t_qListBlocks[b].size();
+
+                //
+                //   Error relative to the channel range within the buffer, for the streamed channels only
+                //
+                qint32 t_iNumPicks = t_vecPicks.size() > 0 ? t_vecPicks.size() : nchan;
+                for(qint32 i = 0; i < t_iNumPicks; ++i)
+                {
+                    qint32 ch = t_vecPicks.size() > 0 ? t_vecPicks[i] : i;
+                    float t_fMax = t_qListBuffers[b].row(ch).cwiseAbs().maxCoeff();
+                    if(t_fMax > 0)
+                        t_dMaxRelErr = qMax(t_dMaxRelErr, (double)((t_matDecoded.row(ch) - t_qListBuffers[b].row(ch)).cwiseAbs().maxCoeff() / t_fMax));
+                }
+            }
+
+            double t_dBytesPerSecond = (double)t_iBytes / nbuffers * t_dBuffersPerSecond;
+            if(p == 0 && m == FiffRtCodec::Float)
+                t_dFloatBytes = t_dBytesPerSecond;
+
+            printf("\t%-8s %-8s %12.0f %8.3f %14.1f %14.1f %12.2e\n", methodNames[m], p == 0 ? "all" : "meg",
+                   t_dBytesPerSecond, t_dBytesPerSecond/t_dFloatBytes, t_dEncodeUs, t_dDecodeNs*1e-3/nbuffers, t_dMaxRelErr);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Measures the per block latency of the streaming minimum norm inverse at 1 kHz block sizes.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+#include <fiff/fiff.h>
+#include <mne/mne.h>
+#include <inverse/minimumNorm/minimumnorm.h>
+#include <inverse/minimumNorm/rtminimumnorm.h>
+#include <inverse/sourceestimate.h>
+
+#include "../benchmarkhelpers.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [method] [nblocks]
+    //
+    QString method  = argc > 1 ? QString(argv[1]) : QString("dSPM");
+    qint32 nblocks  = argc > 2 ? QString(argv[2]).toInt() : 500;
+
+    QFile t_fileRaw("./MNE-sample-data/MEG/sample/sample_audvis_raw.fif");
+    QFile t_fileInv("./MNE-sample-data/MEG/sample/sample_audvis-meg-eeg-oct-6-meg-eeg-inv.fif");
+
+    float snr = 3.0f;
+    float lambda2 = pow(1.0f / snr, 2.0f);
+
+    FiffRawData raw(t_fileRaw);
+    if(raw.isEmpty())
+    {
+        printf("Could not read raw file.\n");
+        return -1;
+    }
+
+    MNEInverseOperator inv(t_fileInv);
+
+    //
+    //   Block sizes of a 1 kHz acquisition
+    //
+    qint32 blockSizes[] = {1, 10, 20, 50, 100, 200};
+    qint32 nsizes = sizeof(blockSizes)/sizeof(blockSizes[0]);
+    qint32 maxBlockSize = blockSizes[nsizes-1];
+
+    RtMinimumNorm rtMinimumNorm(inv, lambda2, method);
+    if(!rtMinimumNorm.init(raw.info, maxBlockSize))
+    {
+        printf("Could not initialize the streaming inverse.\n");
+        return -1;
+    }
+
+    MinimumNorm minimumNorm(inv, lambda2, method);
+
+    MatrixXd data, times;
+    if(!raw.read_raw_segment(data, times, raw.first_samp, raw.first_samp + nblocks + maxBlockSize))
+    {
+        printf("Could not read raw data.\n");
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    for(qint32 s = 0; s < nsizes; ++s)
+    {
+        qint32 nsamp = blockSizes[s];
+        std::vector<double> latStream, latEvoked;
+        latStream.reserve(nblocks);
+        latEvoked.reserve(nblocks);
+
+        MatrixXd block(raw.info.nchan, nsamp);
+        MatrixXd out(rtMinimumNorm.getNumSources(), nsamp);
+
+        FiffEvoked evoked;
+        evoked.info = raw.info;
+        evoked.nave = 1;
+        evoked.first = 0;
+        evoked.last = nsamp-1;
+
+        double maxRelErr = 0;
+        for(qint32 b = 0; b < nblocks; ++b)
+        {
+            block = data.block(0, b, raw.info.nchan, nsamp);
+
+            //
+            //   Any heap allocation of Eigen inside apply() trips an assertion (EIGEN_RUNTIME_NO_MALLOC, see .pro)
+            //
+            Eigen::internal::set_is_malloc_allowed(false);
+            timer.start();
+            rtMinimumNorm.apply(block, out);
+            latStream.push_back(timer.nsecsElapsed()/1000.0);
+            Eigen::internal::set_is_malloc_allowed(true);
+
+            //
+            //   Reference: evoked based path including the channel picking of every block
+            //
+            evoked.data = block;
+            timer.start();
+            SourceEstimate stc = minimumNorm.calculateInverse(evoked);
+            latEvoked.push_back(timer.nsecsElapsed()/1000.0);
+
+            double relErr = (stc.data - out).norm() / stc.data.norm();
+            if(relErr > maxRelErr)
+                maxRelErr = relErr;
+        }
+
+        printf("\nBlock of %d samples (%.0f ms budget at %.0f Hz), %d sources, max rel. error %g:\n",
+               nsamp, 1000.0f*nsamp/raw.info.sfreq, raw.info.sfreq, rtMinimumNorm.getNumSources(), maxRelErr);
+        report("streaming", latStream);
+        report("evoked", latEvoked);
+    }
+
+    return 0;
+}
@@ -0,0 +1,344 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     April, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Measures end-to-end raw buffer latency and CPU use of the mne_rt_server data server over loopback
+*           for 1, 10 and 50 data clients.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <time.h>
+
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_tag.h>
+#include <fiff/fiff_constants.h>
+
+#include "fiffstreamserver.h"
+#include "mne_rt_commands.h"
+
+#include "../benchmarkhelpers.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QAtomicInt>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace RTSERVER;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+static QElapsedTimer    s_timer;            /**< Common monotonic clock of producer and receivers */
+static QAtomicInt       s_iIdsReceived;     /**< Number of clients which received their client id */
+static QAtomicInt       s_iBuffersReceived; /**< Number of raw buffers received by all clients */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// BenchmarkClient
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* A fiff data client which records the arrival time of each raw buffer. The first value of each buffer carries
+* its sequence number.
+*/
+class BenchmarkClient : public QObject
+{
+public:
+    BenchmarkClient(quint16 p_iPort, qint32 p_iNumBuffers)
+    : m_iId(-1)
+    , m_vecRecvNs(p_iNumBuffers, -1)
+    {
+        m_socket.connectToHost(QHostAddress(QHostAddress::LocalHost), p_iPort);
+        m_socket.waitForConnected();
+        m_pFiffStream = FiffStream::SPtr(new FiffStream(&m_socket));
+
+        connect(&m_socket, &QTcpSocket::readyRead, this, &BenchmarkClient::readTags);
+
+        //Request the client id, the answer arrives with the next readyRead
+        QString t_sCommand("");
+        m_pFiffStream->write_rt_command(MNE_RT_GET_CLIENT_ID, t_sCommand);
+    }
+
+    void readTags()
+    {
+        while(true)
+        {
+            if(!m_pPendingTag)
+            {
+                if(m_socket.bytesAvailable() < (qint64)FIFFC_TAG_INFO_SIZE)
+                    break;
+                FiffTag::read_tag_info(m_pFiffStream.data(), m_pPendingTag, false);
+            }
+            if(m_socket.bytesAvailable() < m_pPendingTag->size())
+                break;
+            FiffTag::read_tag_data(m_pFiffStream.data(), m_pPendingTag);
+
+            if(m_pPendingTag->kind == FIFF_DATA_BUFFER)
+            {
+                qint32 t_iSeq = (qint32)m_pPendingTag->toFloat()[0];
+                if(t_iSeq >= 0 && t_iSeq < m_vecRecvNs.size())
+                    m_vecRecvNs[t_iSeq] = s_timer.nsecsElapsed();
+                s_iBuffersReceived.fetchAndAddOrdered(1);
+            }
+            else if(m_pPendingTag->kind == FIFF_MNE_RT_CLIENT_ID)
+            {
+                m_iId = *m_pPendingTag->toInt();
+                s_iIdsReceived.fetchAndAddOrdered(1);
+            }
+            m_pPendingTag.clear();
+        }
+    }
+
+    qint32 m_iId;
+    QVector<qint64> m_vecRecvNs;
+
+private:
+    QTcpSocket m_socket;
+    FiffStream::SPtr m_pFiffStream;
+    FiffTag::SPtr m_pPendingTag;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// ReceiverThread
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Runs all benchmark clients in one event loop, separate from the server.
+*/
+class ReceiverThread : public QThread
+{
+public:
+    ReceiverThread(quint16 p_iPort, qint32 p_iNumClients, qint32 p_iNumBuffers)
+    : m_iPort(p_iPort)
+    , m_iNumClients(p_iNumClients)
+    , m_iNumBuffers(p_iNumBuffers)
+    {
+    }
+
+    void run()
+    {
+        for(qint32 i = 0; i < m_iNumClients; ++i)
+            m_qListClients.append(new BenchmarkClient(m_iPort, m_iNumBuffers));
+
+        exec();
+
+        //Keep the clients for the evaluation; the sockets are closed when the clients are deleted
+        for(qint32 i = 0; i < m_qListClients.size(); ++i)
+        {
+            m_qListRecvNs.append(m_qListClients[i]->m_vecRecvNs);
+            delete m_qListClients[i];
+        }
+    }
+
+    QList<BenchmarkClient*> m_qListClients;
+    QList<QVector<qint64> > m_qListRecvNs;
+
+private:
+    quint16 m_iPort;
+    qint32 m_iNumClients;
+    qint32 m_iNumBuffers;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Waits while processing the events of the calling thread until the counter reaches the given value.
+*
+* @param[in] p_iCounter     the counter to wait for
+* @param[in] p_iValue       the value to reach
+* @param[in] p_iTimeoutMs   timeout in milliseconds
+*
+* @return true if the value was reached within the timeout
+*/
+bool waitFor(QAtomicInt& p_iCounter, int p_iValue, qint64 p_iTimeoutMs)
+{
+    QElapsedTimer t_timer;
+    t_timer.start();
+    while(p_iCounter.loadAcquire() < p_iValue)
+    {
+        if(t_timer.elapsed() > p_iTimeoutMs)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+        QThread::usleep(200);
+    }
+    return true;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    //   Benchmark parameters: [nchan] [nsamp] [period in ms] [nbuffers]
+    //
+    qint32 nchan    = argc > 1 ? QString(argv[1]).toInt() : 315;
+    qint32 nsamp    = argc > 2 ? QString(argv[2]).toInt() : 100;
+    qint32 period   = argc > 3 ? QString(argv[3]).toInt() : 10;
+    qint32 nbuffers = argc > 4 ? QString(argv[4]).toInt() : 500;
+
+    FiffStreamServer t_server;
+    if(!t_server.listen(QHostAddress::LocalHost, 0))
+    {
+        printf("Could not start the data server.\n");
+        return -1;
+    }
+
+    printf("Streaming %d buffers of %d x %d floats every %d ms over loopback\n\n", nbuffers, nchan, nsamp, period);
+
+    s_timer.start();
+
+    qint32 numClients[] = {1, 10, 50};
+    for(qint32 c = 0; c < 3; ++c)
+    {
+        qint32 nclients = numClients[c];
+        s_iIdsReceived.fetchAndStoreOrdered(0);
+        s_iBuffersReceived.fetchAndStoreOrdered(0);
+
+        ReceiverThread t_receivers(t_server.serverPort(), nclients, nbuffers);
+        t_receivers.start();
+
+        if(!waitFor(s_iIdsReceived, nclients, 10000))
+        {
+            printf("%d clients: not all clients were accepted\n", nclients);
+            t_receivers.quit();
+            t_receivers.wait();
+            continue;
+        }
+
+        for(qint32 i = 0; i < nclients; ++i)
+            emit t_server.startMeasFiffStreamClient(t_receivers.m_qListClients[i]->m_iId);
+
+        //
+        // Stream
+        //
+        std::vector<qint64> t_vecSendNs(nbuffers);
+        clock_t t_cpuStart = clock();
+        qint64 t_iWallStart = s_timer.nsecsElapsed();
+
+        for(qint32 b = 0; b < nbuffers; ++b)
+        {
+            QSharedPointer<MatrixXf> t_pRawBuffer(new MatrixXf(MatrixXf::Random(nchan, nsamp)));
+            (*t_pRawBuffer)(0,0) = (float)b;
+
+            t_vecSendNs[b] = s_timer.nsecsElapsed();
+            t_server.forwardRawBuffer(t_pRawBuffer);
+
+            QCoreApplication::processEvents();
+            qint64 t_iNext = t_iWallStart + (qint64)(b+1)*period*1000000;
+            qint64 t_iRemaining = t_iNext - s_timer.nsecsElapsed();
+            if(t_iRemaining > 0)
+                QThread::usleep((unsigned long)(t_iRemaining/1000));
+        }
+
+        bool t_bComplete = waitFor(s_iBuffersReceived, nclients*nbuffers, 10000);
+
+        // clock() measures the CPU time of the whole process, i.e. server and benchmark clients
+        double t_dCpu = (double)(clock() - t_cpuStart) / CLOCKS_PER_SEC;
+        double t_dWall = (s_timer.nsecsElapsed() - t_iWallStart) * 1e-9;
+
+        for(qint32 i = 0; i < nclients; ++i)
+            emit t_server.stopMeasFiffStreamClient(t_receivers.m_qListClients[i]->m_iId);
+
+        t_receivers.quit();
+        t_receivers.wait();
+
+        //
+        // Evaluate
+        //
+        std::vector<double> t_vecLatencies;
+        t_vecLatencies.reserve(nclients*nbuffers);
+        for(qint32 i = 0; i < t_receivers.m_qListRecvNs.size(); ++i)
+            for(qint32 b = 0; b < nbuffers; ++b)
+                if(t_receivers.m_qListRecvNs[i][b] >= 0)
+                    t_vecLatencies.push_back((t_receivers.m_qListRecvNs[i][b] - t_vecSendNs[b]) * 1e-3);
+
+        printf("%d client(s)%s\n", nclients, t_bComplete ? "" : " (incomplete, buffers were lost)");
+        report("latency", t_vecLatencies);
+        printf("\tcpu        %.1f %% of one core (%.2f s cpu in %.2f s wall)\n\n", 100.0*t_dCpu/t_dWall, t_dCpu, t_dWall);
+
+        //Let the server remove the disconnected clients
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+    }
+
+    return 0;
+}
@@ -1,14 +1,14 @@
 //=============================================================================================================
 /**
-* @file     fiffstreamthread.h
+* @file     benchmarkhelpers.h
 * @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
 *           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
 * @version  1.0
-* @date     July, 2012
+* @date     April, 2013
 *
 * @section  LICENSE
 *
-* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
 *
 * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
 * the following conditions are met:
@@ -29,20 +29,23 @@
 * POSSIBILITY OF SUCH DAMAGE.
 *
 *
-* @brief     implementation of the FiffStreamThread Class.
+* @brief    Helpers shared by the benchmark examples.
 *
 */
 
-#ifndef FIFFSTREAMTHREAD_H
-#define FIFFSTREAMTHREAD_H
+#ifndef BENCHMARKHELPERS_H
+#define BENCHMARKHELPERS_H
 
 //*************************************************************************************************************
 //=============================================================================================================
 // INCLUDES
 //=============================================================================================================
 
-#include <fiff/fiff_stream.h>
-#include <fiff/fiff_info.h>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+
+#include <fiff/fiff.h>
 
 
 //*************************************************************************************************************
@@ -50,90 +53,90 @@
 // QT INCLUDES
 //=============================================================================================================
 
-#include <QThread>
-#include <QTcpSocket>
-#include <QMutex>
-#include <QSharedPointer>
+#include <QFile>
+#include <QString>
 
 
 //*************************************************************************************************************
 //=============================================================================================================
-// DEFINE NAMESPACE RTSERVER
+// Methods
 //=============================================================================================================
 
-namespace RTSERVER
-{
-
-//*************************************************************************************************************
-//=============================================================================================================
-// USED NAMESPACES
-//=============================================================================================================
-
-using namespace FIFFLIB;
-
-
-//*************************************************************************************************************
-//=============================================================================================================
-// FORWARD DECLARATIONS
 //=============================================================================================================
-
-class FiffStreamThread : public QThread
+/**
+* Writes a synthetic raw file with p_iNChan channels, consisting of p_iNBuffers data buffers of p_iBufSize samples.
+* All samples of buffer b have the value b.
+*
+* @param[in] p_qFile        the file to write to
+* @param[in] p_iNChan       number of channels
+* @param[in] p_fSFreq       sampling frequency
+* @param[in] p_iBufSize     number of samples per buffer
+* @param[in] p_iNBuffers    number of buffers
+*
+* @return true if succeeded, false otherwise
+*/
+inline bool writeSyntheticRaw(QFile& p_qFile, qint32 p_iNChan, float p_fSFreq, qint32 p_iBufSize, qint32 p_iNBuffers)
 {
-    Q_OBJECT
-public:
-    FiffStreamThread(qint32 id, int socketDescriptor, QObject *parent);
-
-    ~FiffStreamThread();
-
-    void run();
-
-    inline qint32 getID();
-
-    inline QString getAlias();
-
-//    void deactivateRawBufferSending();
-
-
-    void parseCommand(QSharedPointer<FiffTag> p_pTag);
-
-    void writeClientId();
-
-signals:
-    void error(QTcpSocket::SocketError socketError);
-
-private:
-    qint32 m_iDataClientId;
-    QString m_sDataClientAlias;
-
-    int m_iSocketDescriptor;
-
-    QMutex m_qMutex;
-    QByteArray m_qSendBlock;
-
-    bool m_bIsSendingRawBuffer;
-
-    bool m_bIsRunning;
-
-//private slots: --> in Qt 5 not anymore declared as slot
-    void startMeas(qint32 ID);
-    void stopMeas(qint32 ID);
-    void sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo);
-    void sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
-};
+    FIFFLIB::FiffInfo info;
+    info.sfreq = p_fSFreq;
+    info.nchan = p_iNChan;
+    for(qint32 k = 0; k < p_iNChan; ++k)
+    {
+        FIFFLIB::FiffChInfo ch;
+        ch.scanno = k+1;
+        ch.logno = k+1;
+        ch.kind = FIFFV_MEG_CH;
+        ch.range = 1.0f;
+        ch.cal = 1.0f;
+        ch.ch_name = QString("SYN %1").arg(k+1, 4, 10, QChar('0'));
+        info.chs.append(ch);
+        info.ch_names.append(ch.ch_name);
+    }
+
+    Eigen::MatrixXd cals;
+    FIFFLIB::FiffStream::SPtr outfid = FIFFLIB::FiffStream::start_writing_raw(p_qFile, info, cals);
+    if(!outfid)
+        return false;
+
+    Eigen::MatrixXd buf(p_iNChan, p_iBufSize);
+    for(qint32 b = 0; b < p_iNBuffers; ++b)
+    {
+        buf.setConstant(b);
+        outfid->write_raw_buffer(buf, cals);
+    }
+    outfid->finish_writing_raw();
+    p_qFile.close();
+
+    return true;
+}
 
 
-inline qint32 FiffStreamThread::getID()
-{
-    return m_iDataClientId;
-}
 
+//*************************************************************************************************************
 
-inline QString FiffStreamThread::getAlias()
+//=============================================================================================================
+/**
+* Prints mean, median, p99 and max of the given latencies in microseconds.
+*
+* @param[in] p_sName        name of the measured path
+* @param[in] p_vecLatencies the latencies in microseconds
+*/
+inline void report(const char* p_sName, std::vector<double> p_vecLatencies)
 {
-    return m_sDataClientAlias;
+    if(p_vecLatencies.empty())
+    {
+        printf("\t%-10s no samples received\n", p_sName);
+        return;
+    }
+
+    std::sort(p_vecLatencies.begin(), p_vecLatencies.end());
+    double mean = 0;
+    for(size_t i = 0; i < p_vecLatencies.size(); ++i)
+        mean += p_vecLatencies[i];
+    mean /= p_vecLatencies.size();
+
+    printf("\t%-10s mean %9.1f us  median %9.1f us  p99 %9.1f us  max %9.1f us\n", p_sName, mean,
+           p_vecLatencies[p_vecLatencies.size()/2], p_vecLatencies[(size_t)(0.99*(p_vecLatencies.size()-1))], p_vecLatencies.back());
 }
 
-
-} // NAMESPACE
-
-#endif //FIFFSTREAMTHREAD_H
+#endif // BENCHMARKHELPERS_H
@@ -43,7 +43,18 @@ SUBDIRS += \
     readFwd \
     readEpochs \
     computeInverse \
-    makeInverseOperator
+    makeInverseOperator \
+    benchmarkReadRaw \
+    benchmarkRawDecode \
+    benchmarkRtInverse \
+    benchmarkRapMusic \
+    benchmarkRtServer \
+    benchmarkRtEncoding \
+    benchmarkBabyMEG \
+    benchmarkCircularBuffer \
+    benchmarkRawRecorder \
+    benchmarkDirCache \
+    benchmarkInverseSvd
 
 contains(MNECPP_CONFIG, isGui) {
     qtHaveModule(3d) {
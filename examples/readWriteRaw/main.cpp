@@ -115,10 +115,6 @@ int main(int argc, char *argv[])
         }
     }
     //
-    MatrixXd cals;
-
-    FiffStream::SPtr outfid = Fiff::start_writing_raw(t_fileOut,raw.info, cals, picks);
-    //
     //   Set up the reading parameters
     //
     fiff_int_t from = raw.first_samp;
@@ -131,10 +127,17 @@ int main(int argc, char *argv[])
     //quantum     = to - from + 1;
     //
     //
+    //   The writer thread writes a segment while the next one is read
+    //
+    FiffRawWriter writer;
+    if(!writer.open(t_fileOut, raw.info, quantum, picks, from))
+    {
+        printf("cannot open output file\n");
+        return -1;
+    }
+    //
     //   Read and write all the data
     //
-    bool first_buffer = true;
-
     fiff_int_t first, last;
     MatrixXd data;
     MatrixXd times;
@@ -156,17 +159,12 @@ int main(int argc, char *argv[])
         //   You can add your own miracle here
         //
         printf("Writing...");
-        if (first_buffer)
-        {
-           if (first > 0)
-               outfid->write_int(FIFF_FIRST_SAMPLE,&first);
-           first_buffer = false;
-        }
-        outfid->write_raw_buffer(data,cals);
-        printf("[done]\n");
+        writer.write(data);
+        printf("[queued]\n");
     }
 
-    outfid->finish_writing_raw();
+    writer.close();
+    printf("Reading stalled %lld times for writing, at most %.3f ms\n", writer.stalls(), writer.maxStallNs()*1e-6);
 
     printf("Finished\n");
 